@@ -16,30 +16,19 @@
 #include "util.hpp"
 
 MandelNodeProcessor::MandelNodeProcessor():
-    NCNodeDataProcessor(),
+    NCTypedNodeProcessor(),
     mandel_data()
     {}
 
-void MandelNodeProcessor::nc_init(std::vector<uint8_t> data, [[maybe_unused]] NCNodeID node_id) {
-    mandel_data = MandelData(data);
+void MandelNodeProcessor::nc_typed_init(MandelData data, [[maybe_unused]] NCNodeID node_id) {
+    mandel_data = data;
     spdlog::get("mandel_logger")->debug("Initial data received: {}", mandel_data);
 }
 
-[[nodiscard]] std::vector<uint8_t> MandelNodeProcessor::nc_process_data(std::vector<uint8_t> data) {
-    std::vector<uint8_t> result;
+[[nodiscard]] std::vector<uint32_t> MandelNodeProcessor::nc_process_typed_data(uint32_t current_row) {
+    std::vector<uint32_t> result;
     std::chrono::milliseconds compute_time(50);
 
-    if (data.size() != UINT32_SIZE) {
-        // Size does not match, we expect 4 bytes.
-        std::this_thread::sleep_for(compute_time);
-        return result;
-    }
-
-    uint32_t i;
-    uint32_t current_iter;
-    uint32_t current_row = 0;
-    std::memcpy(&current_row, data.data(), UINT32_SIZE);
-
     if (current_row >= mandel_data.height) {
         // Out of bounds, larger than image height:
         std::this_thread::sleep_for(compute_time);
@@ -50,10 +39,11 @@ void MandelNodeProcessor::nc_init(std::vector<uint8_t> data, [[maybe_unused]] NC
 
     std::vector<uint32_t> line(mandel_data.width);
     const std::float64_t im_start = mandel_data.im1 + (std::float64_t(current_row) * mandel_data.im_step);
-    std::complex<std::float64_t> c, z;
 
-    for (i = 0; i < mandel_data.width; i++) {
-        current_iter = 0;
+    // The pixels of one line are independent, use the other cores of the node:
+    nc_parallel_for(0, mandel_data.width, [this, &line, im_start] (uint64_t i) {
+        uint32_t current_iter = 0;
+        std::complex<std::float64_t> c, z;
         c.real(mandel_data.re1 + (std::float64_t(i) * mandel_data.re_step));
         c.imag(im_start);
         z.real(c.real());
@@ -69,10 +59,9 @@ void MandelNodeProcessor::nc_init(std::vector<uint8_t> data, [[maybe_unused]] NC
             current_iter++;
         }
         line[i] = current_iter;
-    }
+    });
 
-    result.resize(mandel_data.width * UINT32_SIZE);
-    std::memcpy(result.data(), line.data(), result.size());
+    result = std::move(line);
 
     // Simulate some heavy computations:
     std::this_thread::sleep_for(compute_time);
@@ -11,15 +11,16 @@
 #define FILE_MANDEL_NODE_HPP_INCLUDED
 
 // Local includes:
-#include "nodcru2/nc_node.hpp"
+#include "nodcru2/nc_typed_processor.hpp"
 #include "util.hpp"
 
 using namespace nodcru2;
 
-class MandelNodeProcessor: public NCNodeDataProcessor {
+// Init data, row number and line of iterations are serialized by the framework:
+class MandelNodeProcessor: public NCTypedNodeProcessor<MandelData, uint32_t, std::vector<uint32_t>> {
     public:
-        void nc_init(std::vector<uint8_t>, NCNodeID) override;
-        [[nodiscard]] std::vector<uint8_t> nc_process_data(std::vector<uint8_t>) override;
+        void nc_typed_init(MandelData, NCNodeID) override;
+        [[nodiscard]] std::vector<uint32_t> nc_process_typed_data(uint32_t) override;
 
         MandelNodeProcessor();
 
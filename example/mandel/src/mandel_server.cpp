@@ -11,6 +11,9 @@
 #include <iostream>
 #include <fstream>
 #include <stdfloat>
+#include <limits>
+#include <algorithm>
+#include <tuple>
 
 // Internal includes:
 #include "mandel_server.hpp"
@@ -19,23 +22,17 @@
 MandelServerProcessor::MandelServerProcessor(MandelData mandel_data):
     NCServerDataProcessor(),
     mandel_data_intern(mandel_data),
-    mandel_job(mandel_data.height),
-    mandel_image(mandel_data.width * mandel_data.height),
-    node_map()
-    {}
-
-[[nodiscard]] std::vector<uint8_t> MandelServerProcessor::nc_get_init_data() {
-    return mandel_data_intern.to_vector();
-}
-
-[[nodiscard]] bool MandelServerProcessor::nc_is_job_done() {
-    for (auto job: mandel_job) {
-        if (job != JobStatus::Done) {
-            return false;
-        }
+    mandel_tasks(mandel_data.height),
+    mandel_image(mandel_data.width * mandel_data.height)
+    {
+        // The server checks this counter instead of calling nc_is_job_done():
+        nc_set_remaining_work(mandel_data.height);
+        // Idle nodes compute the last outstanding rows again, the first result wins:
+        mandel_tasks.nc_enable_speculation(8);
     }
 
-    return true;
+[[nodiscard]] std::vector<uint8_t> MandelServerProcessor::nc_get_init_data() {
+    return MandelDataSerializer().nc_serialize(mandel_data_intern);
 }
 
 void MandelServerProcessor::nc_save_data() {
@@ -69,53 +66,87 @@ void MandelServerProcessor::nc_save_data() {
 void MandelServerProcessor::nc_node_timeout(NCNodeID node_id) {
     spdlog::get("mandel_logger")->debug("Node timeout: {}", node_id);
 
-    if (node_map.contains(node_id)) {
-        uint32_t i = node_map[node_id];
-        if (mandel_job[i] == JobStatus::Processing) {
-            // Give another node a chance to process this job / line:
-            mandel_job[i] = JobStatus::UnProcessed;
-        } else {
-            spdlog::get("mandel_logger")->debug("Job at {} not processing.", i);
-        }
-        node_map.erase(node_id);
-    } else {
-        spdlog::get("mandel_logger")->debug("Timeout node {} not found in map.", node_id);
-    }
+    // Give another node a chance to process this job / line:
+    size_t const num_rows = mandel_tasks.nc_node_timeout(node_id);
+    spdlog::get("mandel_logger")->debug("Rows given to other nodes: {}", num_rows);
 }
 
 [[nodiscard]] std::vector<uint8_t> MandelServerProcessor::nc_get_new_data(NCNodeID node_id) {
     spdlog::get("mandel_logger")->debug("New data for node: {}", node_id);
 
-    for (uint32_t i = 0; i < mandel_data_intern.height; i++) {
-        if (mandel_job[i] == JobStatus::UnProcessed) {
-            mandel_job[i] = JobStatus::Processing;
-            node_map[node_id] = i;
-
-            return u32_to_vec_u8(i);
-        }
+    if (auto const row = mandel_tasks.nc_next_task(node_id)) {
+        return MandelRowSerializer().nc_serialize(*row);
     }
 
     // No more lines to process:
-    return {255, 255, 255, 255};
+    return MandelRowSerializer().nc_serialize(std::numeric_limits<uint32_t>::max());
 }
 
-void MandelServerProcessor::nc_process_result(NCNodeID node_id, std::vector<uint8_t> result) {
+[[nodiscard]] std::vector<std::vector<uint8_t>> MandelServerProcessor::nc_get_new_data_batch(NCNodeID node_id,
+    uint32_t const max_tasks) {
+    spdlog::get("mandel_logger")->debug("New data batch for node: {}, max rows: {}", node_id, max_tasks);
+
+    std::vector<std::vector<uint8_t>> result;
+
+    // The node returns the rows in this order:
+    for (uint32_t const row: mandel_tasks.nc_next_tasks(node_id, max_tasks)) {
+        result.push_back(MandelRowSerializer().nc_serialize(row));
+    }
+
+    if (result.empty()) {
+        // No more lines to process:
+        result.push_back(MandelRowSerializer().nc_serialize(std::numeric_limits<uint32_t>::max()));
+    }
+
+    return result;
+}
+
+void MandelServerProcessor::nc_process_result_view(NCNodeID node_id, std::span<const uint8_t> const result) {
     spdlog::get("mandel_logger")->debug("Processed data from node: {}", node_id);
 
-    if (node_map.contains(node_id)) {
-        uint32_t i = node_map[node_id];
+    std::span<const uint32_t> line;
 
-        if (mandel_job[i] == JobStatus::Processing) {
-            mandel_job[i] = JobStatus::Done;
-            if (result.size() == mandel_data_intern.width * 4) {
-                std::memcpy(&mandel_image[i * mandel_data_intern.height], result.data(), result.size());
-            } else {
-                spdlog::get("mandel_logger")->error("Size missmatch, expected: {}, got: {}", mandel_data_intern.width * 4, result.size());
-            }
-        } else {
-            spdlog::get("mandel_logger")->error("Not processing at index {}", i);
-        }
-    } else {
-        spdlog::get("mandel_logger")->error("Node not found in node map: {}", node_id);
+    try {
+        // View into the received buffer, no extra copy:
+        line = MandelLineSerializer().nc_deserialize_view(result);
+    } catch (NCSerializerException &e) {
+        spdlog::get("mandel_logger")->error("Invalid result: {}", e.what());
+
+        // The row is not done, give it to another node:
+        std::ignore = mandel_tasks.nc_task_failed(node_id);
+        return;
+    }
+
+    if (line.size() != mandel_data_intern.width) {
+        spdlog::get("mandel_logger")->error("Size missmatch, expected: {}, got: {}", mandel_data_intern.width, line.size());
+        std::ignore = mandel_tasks.nc_task_failed(node_id);
+        return;
+    }
+
+    // The result doesn't contain the row, a node sends the results in the order of its rows:
+    auto const row = mandel_tasks.nc_task_done(node_id);
+
+    if (!row) {
+        spdlog::get("mandel_logger")->debug("Row already done or node has no row: {}", node_id);
+        return;
+    }
+
+    uint32_t const i = *row;
+    std::copy(line.begin(), line.end(), mandel_image.begin() + (i * mandel_data_intern.height));
+    nc_work_done();
+
+    // Backup copies of this row are not needed anymore. This drops the rows that the other
+    // node has got so far, the ones that are not done are handed out again in nc_tasks_cancelled():
+    for (NCNodeID const& other_node: mandel_tasks.nc_nodes_working_on(i)) {
+        nc_cancel_node_tasks(other_node);
+    }
+}
+
+void MandelServerProcessor::nc_tasks_cancelled(NCNodeID node_id, uint32_t const num_tasks) {
+    spdlog::get("mandel_logger")->debug("Rows cancelled by node: {}, {}", node_id, num_tasks);
+
+    // The rows that are not done yet are given to other nodes:
+    for (uint32_t i = 0; i < num_tasks; i++) {
+        std::ignore = mandel_tasks.nc_task_cancelled(node_id);
     }
 }
@@ -19,22 +19,22 @@
 // External includes:
 #include <spdlog/spdlog.h>
 
-// Size in bytes:
-const uint8_t FLOAT_SIZE = 8;
-const uint8_t UINT32_SIZE = 4;
-const uint32_t MANDEL_DATA_SIZE = (4 * FLOAT_SIZE) + (3 * UINT32_SIZE);
+// Local includes:
+#include "nodcru2/nc_serializer.hpp"
 
+// Trivially copyable, so it can be sent as a whole:
 class MandelData {
     public:
         MandelData();
-        MandelData(std::vector<uint8_t> data);
-
-        std::vector<uint8_t> to_vector();
 
         std::float64_t re1, re2, im1, im2, re_step, im_step;
         uint32_t width, height, max_iteration;
 };
 
+using MandelDataSerializer = nodcru2::NCBinarySerializer<MandelData>;
+using MandelRowSerializer = nodcru2::NCBinarySerializer<uint32_t>;
+using MandelLineSerializer = nodcru2::NCBinarySerializer<std::vector<uint32_t>>;
+
 // For spdlog:
 // Specialization of fmt::formatter for MandelData
 template<>
@@ -47,14 +47,6 @@ struct fmt::formatter<MandelData> : fmt::formatter<std::string>
     }
 };
 
-std::vector<uint8_t> u32_to_vec_u8(uint32_t in);
-
-uint32_t vec_u8_to_u32(std::vector<uint8_t> in);
-
-void vec_u8_to_vec_u32(std::vector<uint8_t> vec_in, std::vector<uint32_t> vec_out);
-
-void vec_u32_to_vec_u8(std::vector<uint32_t> vec_in, std::vector<uint8_t> vec_out);
-
 void mandel_server_logger(spdlog::level::level_enum log_level = spdlog::level::debug);
 
 void mandel_node_logger(spdlog::level::level_enum log_level = spdlog::level::debug);
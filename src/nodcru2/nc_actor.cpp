@@ -0,0 +1,98 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines a single threaded actor executor.
+*/
+
+// Local includes:
+#include "nc_actor.hpp"
+
+namespace nodcru2 {
+NCActorExecutor::NCActorExecutor():
+    head_intern(&stub_intern),
+    tail_intern(&stub_intern),
+    stub_intern(),
+    pending_intern(0),
+    running_intern(true),
+    actor_thread(),
+    actor_thread_id()
+    {
+        actor_thread = std::thread([this] () {nc_run();});
+        actor_thread_id = actor_thread.get_id();
+    }
+
+NCActorExecutor::~NCActorExecutor() {
+    // All functions that were posted before are run first:
+    nc_post([this] () {running_intern = false;});
+    actor_thread.join();
+
+    if (tail_intern != &stub_intern) {
+        delete tail_intern;
+    }
+}
+
+void NCActorExecutor::nc_post(std::move_only_function<void()> function) {
+    /*
+    Append the function to the queue, this never blocks.
+
+    The counter is incremented first, so the actor thread doesn't go to sleep
+    while the task is being linked into the queue.
+    */
+
+    NCActorTask* const task = new NCActorTask();
+    task->function = std::move(function);
+
+    pending_intern.fetch_add(1, std::memory_order_acq_rel);
+    NCActorTask* const previous = head_intern.exchange(task, std::memory_order_acq_rel);
+    previous->next.store(task, std::memory_order_release);
+    pending_intern.notify_one();
+}
+
+[[nodiscard]] NCActorTask* NCActorExecutor::nc_pop() {
+    /*
+    Return the next task or nullptr if the queue is empty.
+
+    The returned task stays in the queue as the new tail until the next call,
+    the previous tail is deleted.
+    */
+
+    NCActorTask* const tail = tail_intern;
+    NCActorTask* const next = tail->next.load(std::memory_order_acquire);
+
+    if (next == nullptr) {
+        return nullptr;
+    }
+
+    tail_intern = next;
+
+    if (tail != &stub_intern) {
+        delete tail;
+    }
+
+    return next;
+}
+
+void NCActorExecutor::nc_run() {
+    while (running_intern) {
+        NCActorTask* const task = nc_pop();
+
+        if (task == nullptr) {
+            if (pending_intern.load(std::memory_order_acquire) == 0) {
+                pending_intern.wait(0, std::memory_order_acquire);
+            } else {
+                // A producer is just linking its task:
+                std::this_thread::yield();
+            }
+            continue;
+        }
+
+        task->function();
+        // Release all captured values now:
+        task->function = nullptr;
+        pending_intern.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+}
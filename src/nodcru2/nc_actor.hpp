@@ -0,0 +1,81 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines a single threaded actor executor.
+
+    All functions that are called through the executor run one after the
+    other on the same dedicated thread, so they don't need any locking.
+    The callers put their function into a lock free multi producer single
+    consumer queue (intrusive linked list, D. Vyukov) and wait for the result.
+*/
+
+#ifndef FILE_NC_ACTOR_HPP_INCLUDED
+#define FILE_NC_ACTOR_HPP_INCLUDED
+
+// STD includes:
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <future>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace nodcru2 {
+struct NCActorTask {
+    std::atomic<NCActorTask*> next = nullptr;
+    std::move_only_function<void()> function = {};
+};
+
+class NCActorExecutor {
+    public:
+        // Run the function on the actor thread and wait for its result.
+        // Exceptions are thrown again in the calling thread:
+        template<typename F>
+        std::invoke_result_t<F> nc_call(F&& function) {
+            if (std::this_thread::get_id() == actor_thread_id) {
+                // Called from a function that already runs on the actor thread:
+                return function();
+            }
+
+            std::packaged_task<std::invoke_result_t<F>()> task(std::forward<F>(function));
+            auto result = task.get_future();
+            // The task stays on the stack until the actor thread is done with it:
+            nc_post([&task]() {task();});
+            return result.get();
+        }
+
+        // Constructor:
+        NCActorExecutor();
+
+        // Destructor, runs all pending functions:
+        ~NCActorExecutor();
+
+        // Disable all other special member functions:
+        NCActorExecutor(const NCActorExecutor&) = delete;
+        NCActorExecutor& operator=(const NCActorExecutor&) = delete;
+        NCActorExecutor(NCActorExecutor&&) = delete;
+        NCActorExecutor& operator=(NCActorExecutor&&) = delete;
+
+    private:
+        // Producers append here:
+        std::atomic<NCActorTask*> head_intern;
+        // Only used by the actor thread, always points to the last processed task:
+        NCActorTask* tail_intern;
+        NCActorTask stub_intern;
+        // Number of tasks that are not processed yet, the actor thread waits on it:
+        std::atomic<uint32_t> pending_intern;
+        bool running_intern;
+        std::thread actor_thread;
+        std::thread::id actor_thread_id;
+
+        void nc_post(std::move_only_function<void()> function);
+        [[nodiscard]] NCActorTask* nc_pop();
+        void nc_run();
+};
+}
+
+#endif // FILE_NC_ACTOR_HPP_INCLUDED
@@ -0,0 +1,118 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines a bounded blocking queue.
+
+    It connects the stages of the server pipeline and of the node pipeline.
+    A full queue blocks the producer, so a slow stage slows down the stages
+    before it instead of letting the number of waiting items grow without limit.
+*/
+
+#ifndef FILE_NC_BOUNDED_QUEUE_HPP_INCLUDED
+#define FILE_NC_BOUNDED_QUEUE_HPP_INCLUDED
+
+// STD includes:
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <optional>
+#include <utility>
+
+namespace nodcru2 {
+template<typename T>
+class NCBoundedQueue {
+    public:
+        // Blocks while the queue is full, returns false if the queue is closed:
+        bool nc_push(T item) {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            not_full.wait(lock, [this] () {return closed_intern || (items_intern.size() < capacity_intern);});
+
+            if (closed_intern) {
+                return false;
+            }
+
+            items_intern.push_back(std::move(item));
+            lock.unlock();
+            not_empty.notify_one();
+            return true;
+        }
+
+        // Blocks while the queue is empty, returns nothing if the queue is closed and empty:
+        [[nodiscard]] std::optional<T> nc_pop() {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            not_empty.wait(lock, [this] () {return closed_intern || !items_intern.empty();});
+
+            if (items_intern.empty()) {
+                return std::nullopt;
+            }
+
+            T item = std::move(items_intern.front());
+            items_intern.pop_front();
+            lock.unlock();
+            not_full.notify_one();
+            return item;
+        }
+
+        // Doesn't block, returns nothing if the queue is empty:
+        [[nodiscard]] std::optional<T> nc_try_pop() {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+
+            if (items_intern.empty()) {
+                return std::nullopt;
+            }
+
+            T item = std::move(items_intern.front());
+            items_intern.pop_front();
+            lock.unlock();
+            not_full.notify_one();
+            return item;
+        }
+
+        // The remaining items can still be popped:
+        void nc_close() {
+            {
+                const std::lock_guard<std::mutex> lock(queue_mutex);
+                closed_intern = true;
+            }
+
+            not_full.notify_all();
+            not_empty.notify_all();
+        }
+
+        [[nodiscard]] size_t nc_size() {
+            const std::lock_guard<std::mutex> lock(queue_mutex);
+            return items_intern.size();
+        }
+
+        // Constructor:
+        NCBoundedQueue(size_t const capacity):
+            items_intern(),
+            capacity_intern(capacity > 0 ? capacity : 1),
+            closed_intern(false),
+            queue_mutex(),
+            not_full(),
+            not_empty()
+            {}
+
+        // Disable all other special member functions:
+        NCBoundedQueue() = delete;
+        NCBoundedQueue(const NCBoundedQueue&) = delete;
+        NCBoundedQueue& operator=(const NCBoundedQueue&) = delete;
+        NCBoundedQueue(NCBoundedQueue&&) = delete;
+        NCBoundedQueue& operator=(NCBoundedQueue&&) = delete;
+
+    private:
+        std::deque<T> items_intern;
+        size_t capacity_intern;
+        bool closed_intern;
+        std::mutex queue_mutex;
+        std::condition_variable not_full;
+        std::condition_variable not_empty;
+};
+}
+
+#endif // FILE_NC_BOUNDED_QUEUE_HPP_INCLUDED
@@ -0,0 +1,135 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines a pool of message buffers.
+*/
+
+// STD includes:
+#include <array>
+#include <algorithm>
+#include <bit>
+#include <mutex>
+
+// Local includes:
+#include "nc_buffer_pool.hpp"
+
+namespace nodcru2 {
+namespace {
+using NCBufferList = std::vector<std::vector<uint8_t>>;
+
+// Maximum number of buffers that are kept for the given size class:
+[[nodiscard]] size_t nc_class_limit(size_t const size_class, size_t const max_count, size_t const max_bytes) noexcept {
+    size_t const class_bytes = size_t(1) << (size_class + NC_POOL_MIN_SHIFT);
+    return std::clamp(max_bytes / class_bytes, size_t(1), max_count);
+}
+
+class NCGlobalBufferPool {
+    public:
+        [[nodiscard]] bool nc_take(size_t const size_class, std::vector<uint8_t>& buffer) {
+            const std::lock_guard<std::mutex> lock(pool_mutex);
+            NCBufferList& list = buffers_intern[size_class];
+
+            if (list.empty()) {
+                return false;
+            }
+
+            buffer = std::move(list.back());
+            list.pop_back();
+            return true;
+        }
+
+        void nc_put(size_t const size_class, std::vector<uint8_t>&& buffer) {
+            const std::lock_guard<std::mutex> lock(pool_mutex);
+            NCBufferList& list = buffers_intern[size_class];
+
+            if (list.size() < nc_class_limit(size_class, NC_POOL_GLOBAL_CACHE_SIZE, NC_POOL_GLOBAL_CACHE_BYTES)) {
+                list.push_back(std::move(buffer));
+            }
+        }
+
+    private:
+        std::mutex pool_mutex;
+        std::array<NCBufferList, NC_POOL_NUM_CLASSES> buffers_intern;
+};
+
+[[nodiscard]] NCGlobalBufferPool& nc_global_pool() {
+    static NCGlobalBufferPool global_pool;
+    return global_pool;
+}
+
+struct NCThreadBufferCache {
+    std::array<NCBufferList, NC_POOL_NUM_CLASSES> buffers;
+
+    // Give all buffers to the global pool when the thread exits,
+    // the server uses one thread per connection:
+    ~NCThreadBufferCache() {
+        for (size_t size_class = 0; size_class < NC_POOL_NUM_CLASSES; size_class++) {
+            for (auto& buffer: buffers[size_class]) {
+                nc_global_pool().nc_put(size_class, std::move(buffer));
+            }
+        }
+    }
+};
+
+thread_local NCThreadBufferCache thread_cache;
+
+// Smallest size class that can hold the given size:
+[[nodiscard]] size_t nc_acquire_class(size_t const size) noexcept {
+    size_t const shift = (size <= 1) ? 0 : static_cast<size_t>(std::bit_width(size - 1));
+    return (shift < NC_POOL_MIN_SHIFT) ? 0 : shift - NC_POOL_MIN_SHIFT;
+}
+}
+
+[[nodiscard]] std::vector<uint8_t> nc_acquire_buffer(size_t const size) {
+    size_t const size_class = nc_acquire_class(size);
+
+    if (size_class >= NC_POOL_NUM_CLASSES) {
+        // Too large for the pool:
+        return std::vector<uint8_t>(size);
+    }
+
+    std::vector<uint8_t> result;
+    NCBufferList& list = thread_cache.buffers[size_class];
+
+    if (!list.empty()) {
+        result = std::move(list.back());
+        list.pop_back();
+    } else if (!nc_global_pool().nc_take(size_class, result)) {
+        // Allocate the full size class, so the buffer can be reused for all sizes of this class:
+        result.reserve(size_t(1) << (size_class + NC_POOL_MIN_SHIFT));
+    }
+
+    result.resize(size);
+    return result;
+}
+
+void nc_release_buffer(std::vector<uint8_t>&& buffer) {
+    std::vector<uint8_t> released = std::move(buffer);
+    size_t const capacity = released.capacity();
+
+    if (capacity < (size_t(1) << NC_POOL_MIN_SHIFT)) {
+        // Too small to be worth keeping:
+        return;
+    }
+
+    // Largest size class that fits into the capacity:
+    size_t const size_class = static_cast<size_t>(std::bit_width(capacity)) - 1 - NC_POOL_MIN_SHIFT;
+
+    if (size_class >= NC_POOL_NUM_CLASSES) {
+        // Too large, don't keep it:
+        return;
+    }
+
+    released.clear();
+    NCBufferList& list = thread_cache.buffers[size_class];
+
+    if (list.size() < nc_class_limit(size_class, NC_POOL_THREAD_CACHE_SIZE, NC_POOL_THREAD_CACHE_BYTES)) {
+        list.push_back(std::move(released));
+    } else {
+        nc_global_pool().nc_put(size_class, std::move(released));
+    }
+}
+}
@@ -0,0 +1,49 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines a pool of message buffers.
+
+    The network, the message codec and the server / node loops take their
+    buffers from this pool and give them back when they are done, so that
+    in steady state almost no heap allocations are needed per message.
+    The buffers are sorted into size classes (powers of two). Each thread
+    has a small cache, a global pool is used as fallback.
+
+    The buffers move through the pipeline inside the messages, so they are
+    given back by hand with nc_release_buffer() where they are used up.
+    A buffer that is not given back, e.g. when an exception is thrown, is
+    freed as usual and only misses the pool.
+*/
+
+#ifndef FILE_NC_BUFFER_POOL_HPP_INCLUDED
+#define FILE_NC_BUFFER_POOL_HPP_INCLUDED
+
+// STD includes:
+#include <cstdint>
+#include <vector>
+
+namespace nodcru2 {
+// Smallest and largest pooled buffer: 256 bytes and 64 MB.
+// Larger buffers are allocated and freed as usual:
+size_t const NC_POOL_MIN_SHIFT = 8;
+size_t const NC_POOL_MAX_SHIFT = 26;
+size_t const NC_POOL_NUM_CLASSES = NC_POOL_MAX_SHIFT - NC_POOL_MIN_SHIFT + 1;
+
+// Number of buffers kept per size class, large buffers are also limited
+// by the number of bytes kept per size class:
+size_t const NC_POOL_THREAD_CACHE_SIZE = 4;
+size_t const NC_POOL_THREAD_CACHE_BYTES = 16 * 1024 * 1024;
+size_t const NC_POOL_GLOBAL_CACHE_SIZE = 32;
+size_t const NC_POOL_GLOBAL_CACHE_BYTES = 128 * 1024 * 1024;
+
+// Returns a buffer with the given size:
+[[nodiscard]] std::vector<uint8_t> nc_acquire_buffer(size_t const size);
+
+// Gives the buffer back to the pool, the buffer is empty afterwards:
+void nc_release_buffer(std::vector<uint8_t>&& buffer);
+}
+
+#endif // FILE_NC_BUFFER_POOL_HPP_INCLUDED
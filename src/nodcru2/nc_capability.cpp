@@ -0,0 +1,268 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines the capabilities that are exchanged between the node and
+    the server in the Init / InitOK handshake.
+    The node sends its capabilities in the Init message, the server picks the
+    best common codec for this node and sends the result back in the InitOK message.
+*/
+
+// STD includes:
+#include <algorithm>
+#include <array>
+#include <thread>
+#include <limits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+// External includes:
+#include <spdlog/spdlog.h>
+
+// Local includes:
+#include "nc_capability.hpp"
+#include "nc_util.hpp"
+#include "nc_exceptions.hpp"
+
+namespace nodcru2 {
+[[nodiscard]] uint16_t nc_compressor_mask(NCCompressorID const compressor) noexcept {
+    // Zero for an invalid id, it is not supported by anyone:
+    if (static_cast<uint8_t>(compressor) >= NC_MAX_CODEC_ID) {
+        return 0;
+    }
+
+    return static_cast<uint16_t>(1u << static_cast<uint8_t>(compressor));
+}
+
+[[nodiscard]] uint16_t nc_encryption_mask(NCEncryptionID const encryption) noexcept {
+    if (static_cast<uint8_t>(encryption) >= NC_MAX_CODEC_ID) {
+        return 0;
+    }
+
+    return static_cast<uint16_t>(1u << static_cast<uint8_t>(encryption));
+}
+
+[[nodiscard]] std::vector<uint8_t> nc_encode_capabilities(NCCapabilities const& capabilities) {
+    std::vector<uint8_t> result(NC_CAPABILITIES_LENGTH);
+    std::span<uint8_t> data(result);
+
+    nc_to_big_endian_bytes16(capabilities.protocol_version, data.subspan(0, 2));
+    nc_to_big_endian_bytes16(capabilities.compressors, data.subspan(2, 2));
+    nc_to_big_endian_bytes16(capabilities.encryptions, data.subspan(4, 2));
+    nc_to_big_endian_bytes(capabilities.max_frame_size, data.subspan(6, 4));
+    data[10] = capabilities.features;
+    data[11] = static_cast<uint8_t>(capabilities.preferred_compressor);
+    data[12] = static_cast<uint8_t>(capabilities.preferred_encryption);
+
+    return result;
+}
+
+[[nodiscard]] NCCapabilities nc_decode_capabilities(std::span<const uint8_t> const data) {
+    if (data.size() < NC_CAPABILITIES_LENGTH) {
+        throw NCMessageException("Capabilities too short.");
+    }
+
+    NCCapabilities result;
+
+    result.protocol_version = nc_from_big_endian_bytes16(data.subspan(0, 2));
+    result.compressors = nc_from_big_endian_bytes16(data.subspan(2, 2));
+    result.encryptions = nc_from_big_endian_bytes16(data.subspan(4, 2));
+    result.max_frame_size = nc_from_big_endian_bytes(data.subspan(6, 4));
+    result.features = data[10];
+    // An unknown id from the network means no preference:
+    result.preferred_compressor = (data[11] < NC_MAX_CODEC_ID) ?
+        static_cast<NCCompressorID>(data[11]) : NCCompressorID::Default;
+    result.preferred_encryption = (data[12] < NC_MAX_CODEC_ID) ?
+        static_cast<NCEncryptionID>(data[12]) : NCEncryptionID::Default;
+
+    return result;
+}
+
+[[nodiscard]] std::vector<uint8_t> nc_encode_negotiated(NCNegotiatedCapabilities const& negotiated) {
+    std::vector<uint8_t> result(NC_NEGOTIATED_LENGTH);
+    std::span<uint8_t> data(result);
+
+    nc_to_big_endian_bytes16(negotiated.protocol_version, data.subspan(0, 2));
+    data[2] = nc_codec_to_byte(negotiated.codec);
+    nc_to_big_endian_bytes(negotiated.max_frame_size, data.subspan(3, 4));
+    data[7] = negotiated.features;
+
+    return result;
+}
+
+[[nodiscard]] NCNegotiatedCapabilities nc_decode_negotiated(std::span<const uint8_t> const data) {
+    if (data.size() < NC_NEGOTIATED_LENGTH) {
+        throw NCMessageException("Negotiated capabilities too short.");
+    }
+
+    NCNegotiatedCapabilities result;
+
+    result.protocol_version = nc_from_big_endian_bytes16(data.subspan(0, 2));
+    result.codec = nc_codec_from_byte(data[2]);
+    result.max_frame_size = nc_from_big_endian_bytes(data.subspan(3, 4));
+    result.features = data[7];
+
+    return result;
+}
+
+[[nodiscard]] std::vector<uint8_t> nc_encode_node_info(NCNodeInfo const& node_info) {
+    std::vector<uint8_t> result(NC_NODE_INFO_LENGTH);
+    std::span<uint8_t> data(result);
+
+    nc_to_big_endian_bytes16(node_info.num_cores, data.subspan(0, 2));
+    nc_to_big_endian_bytes64(node_info.memory, data.subspan(2, 8));
+    nc_to_big_endian_bytes(node_info.cpu_features, data.subspan(10, 4));
+    nc_to_big_endian_bytes(node_info.benchmark_score, data.subspan(14, 4));
+
+    return result;
+}
+
+[[nodiscard]] NCNodeInfo nc_decode_node_info(std::span<const uint8_t> const data) {
+    if (data.size() < NC_NODE_INFO_LENGTH) {
+        throw NCMessageException("Node info too short.");
+    }
+
+    NCNodeInfo result;
+
+    result.num_cores = nc_from_big_endian_bytes16(data.subspan(0, 2));
+    result.memory = nc_from_big_endian_bytes64(data.subspan(2, 8));
+    result.cpu_features = nc_from_big_endian_bytes(data.subspan(10, 4));
+    result.benchmark_score = nc_from_big_endian_bytes(data.subspan(14, 4));
+
+    return result;
+}
+
+[[nodiscard]] NCNodeInfo nc_detect_node_info() {
+    /*
+    Values that can't be detected on this platform stay zero.
+    */
+
+    NCNodeInfo result;
+    result.num_cores = static_cast<uint16_t>(std::min(std::thread::hardware_concurrency(),
+        uint32_t(std::numeric_limits<uint16_t>::max())));
+
+#if defined(__unix__) || defined(__APPLE__)
+    long const num_pages = sysconf(_SC_PHYS_PAGES);
+    long const page_size = sysconf(_SC_PAGESIZE);
+
+    if ((num_pages > 0) && (page_size > 0)) {
+        result.memory = static_cast<uint64_t>(num_pages) * static_cast<uint64_t>(page_size);
+    }
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse4.2")) {
+        result.cpu_features |= NC_CPU_SSE42;
+    }
+
+    if (__builtin_cpu_supports("avx")) {
+        result.cpu_features |= NC_CPU_AVX;
+    }
+
+    if (__builtin_cpu_supports("avx2")) {
+        result.cpu_features |= NC_CPU_AVX2;
+    }
+
+    if (__builtin_cpu_supports("avx512f")) {
+        result.cpu_features |= NC_CPU_AVX512F;
+    }
+
+    if (__builtin_cpu_supports("fma")) {
+        result.cpu_features |= NC_CPU_FMA;
+    }
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+    result.cpu_features |= NC_CPU_NEON;
+#endif
+
+    return result;
+}
+
+[[nodiscard]] double nc_node_weight(NCNodeInfo const& node_info) noexcept {
+    /*
+    All nodes of a job should either report a benchmark score or none,
+    otherwise scores and core counts are mixed.
+    */
+
+    if (node_info.benchmark_score > 0) {
+        return static_cast<double>(node_info.benchmark_score);
+    }
+
+    if (node_info.num_cores > 0) {
+        return static_cast<double>(node_info.num_cores);
+    }
+
+    return 1.0;
+}
+
+[[nodiscard]] NCNegotiatedCapabilities nc_negotiate(NCCapabilities const& server, NCCapabilities const& node) {
+    /*
+    Pick the best codec that is supported by both sides.
+
+    For the compression the preference of the node is used first since the node knows
+    how fast its network link is: nodes in the same rack can skip compression, nodes
+    behind a slow link can use heavy compression.
+    For the encryption the preference of the server is used first.
+    */
+
+    if (node.protocol_version == 0) {
+        throw NCMessageException("Invalid protocol version.");
+    }
+
+    NCNegotiatedCapabilities result;
+    result.protocol_version = std::min(server.protocol_version, node.protocol_version);
+    result.max_frame_size = std::min(server.max_frame_size, node.max_frame_size);
+    result.features = server.features & node.features;
+
+    uint16_t const compressors = server.compressors & node.compressors;
+    std::array<NCCompressorID, 5> const compressor_order = {node.preferred_compressor,
+        server.preferred_compressor, NCCompressorID::LZ4, NCCompressorID::LZ4HC, NCCompressorID::None};
+    auto const compressor = std::find_if(compressor_order.cbegin(), compressor_order.cend(),
+        [compressors](NCCompressorID const id) { return (id != NCCompressorID::Default) && (compressors & nc_compressor_mask(id)); });
+
+    if (compressor == compressor_order.cend()) {
+        throw NCMessageException("No common compressor.");
+    }
+
+    uint16_t const encryptions = server.encryptions & node.encryptions;
+    std::array<NCEncryptionID, 4> const encryption_order = {server.preferred_encryption,
+        node.preferred_encryption, NCEncryptionID::ChaCha20Poly1305, NCEncryptionID::AES256GCM};
+    auto const encryption = std::find_if(encryption_order.cbegin(), encryption_order.cend(),
+        [encryptions](NCEncryptionID const id) { return (id != NCEncryptionID::Default) && (encryptions & nc_encryption_mask(id)); });
+
+    if (encryption == encryption_order.cend()) {
+        throw NCMessageException("No common encryption.");
+    }
+
+    result.codec = NCCodecID{*compressor, *encryption};
+
+    return result;
+}
+
+[[nodiscard]] NCCompressorID nc_compressor_from_string(std::string_view const name) {
+    if (name == "none") {
+        return NCCompressorID::None;
+    } else if (name == "lz4") {
+        return NCCompressorID::LZ4;
+    } else if (name == "lz4hc") {
+        return NCCompressorID::LZ4HC;
+    } else {
+        throw NCConfigurationException(fmt::format("Unknown compressor: {}", name).c_str());
+    }
+}
+
+[[nodiscard]] NCEncryptionID nc_encryption_from_string(std::string_view const name) {
+    if (name == "chacha20-poly1305") {
+        return NCEncryptionID::ChaCha20Poly1305;
+    } else if (name == "aes-256-gcm") {
+        return NCEncryptionID::AES256GCM;
+    } else {
+        throw NCConfigurationException(fmt::format("Unknown encryption: {}", name).c_str());
+    }
+}
+}
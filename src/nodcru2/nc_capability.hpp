@@ -0,0 +1,116 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines the capabilities that are exchanged between the node and
+    the server in the Init / InitOK handshake.
+    The node sends its capabilities in the Init message, the server picks the
+    best common codec for this node and sends the result back in the InitOK message.
+    The node also reports its hardware (NCNodeInfo) in the Init message, so the
+    server can give more work to stronger nodes from the first task on.
+*/
+
+#ifndef FILE_NC_CAPABILITY_HPP_INCLUDED
+#define FILE_NC_CAPABILITY_HPP_INCLUDED
+
+// STD includes:
+#include <cstdint>
+#include <vector>
+#include <span>
+#include <string_view>
+
+// Local includes:
+#include "nc_message_types.hpp"
+
+namespace nodcru2 {
+uint16_t const NC_PROTOCOL_VERSION = 1;
+uint32_t const NC_DEFAULT_MAX_FRAME_SIZE = 256 * 1024 * 1024;
+
+// Optional protocol features, one bit each:
+uint8_t const NC_FEATURE_PERSISTENT_CONNECTION = 1 << 0;
+// The node sends the result and asks for new data in one message (ResultNeedsMoreData):
+uint8_t const NC_FEATURE_RESULT_WITH_NEW_DATA = 1 << 1;
+// The node sends the results of several tasks in one message (NewResultBatchFromNode):
+uint8_t const NC_FEATURE_RESULT_BATCH = 1 << 2;
+// The node understands the Cancel message as the answer to any of its messages:
+uint8_t const NC_FEATURE_CANCEL = 1 << 3;
+
+// CPU features of the node, one bit each:
+uint32_t const NC_CPU_SSE42 = 1 << 0;
+uint32_t const NC_CPU_AVX = 1 << 1;
+uint32_t const NC_CPU_AVX2 = 1 << 2;
+uint32_t const NC_CPU_AVX512F = 1 << 3;
+uint32_t const NC_CPU_FMA = 1 << 4;
+uint32_t const NC_CPU_NEON = 1 << 5;
+
+// Bit masks of the built in compressors (None, LZ4, LZ4HC) and encryptions (ChaCha20Poly1305, AES256GCM):
+uint16_t const NC_BUILTIN_COMPRESSORS = 0b0111;
+uint16_t const NC_BUILTIN_ENCRYPTIONS = 0b0110;
+
+// Size in bytes:
+size_t const NC_CAPABILITIES_LENGTH = 2 + 2 + 2 + 4 + 1 + 1 + 1;
+size_t const NC_NEGOTIATED_LENGTH = 2 + 1 + 4 + 1;
+size_t const NC_NODE_INFO_LENGTH = 2 + 8 + 4 + 4;
+
+struct NCCapabilities {
+    uint16_t protocol_version = NC_PROTOCOL_VERSION;
+    // Bit masks, one bit for each NCCompressorID / NCEncryptionID:
+    uint16_t compressors = NC_BUILTIN_COMPRESSORS;
+    uint16_t encryptions = NC_BUILTIN_ENCRYPTIONS;
+    uint32_t max_frame_size = NC_DEFAULT_MAX_FRAME_SIZE;
+    uint8_t features = 0;
+    NCCompressorID preferred_compressor = NCCompressorID::LZ4;
+    NCEncryptionID preferred_encryption = NCEncryptionID::ChaCha20Poly1305;
+};
+
+struct NCNegotiatedCapabilities {
+    uint16_t protocol_version = NC_PROTOCOL_VERSION;
+    NCCodecID codec = NC_DEFAULT_CODEC;
+    // Only the messages of the node are checked against it. The server doesn't split
+    // its answers, the node rejects a larger frame (lower its batch_size then):
+    uint32_t max_frame_size = NC_DEFAULT_MAX_FRAME_SIZE;
+    uint8_t features = 0;
+};
+
+struct NCNodeInfo {
+    // Zero if unknown:
+    uint16_t num_cores = 0;
+    // Physical memory in bytes, zero if unknown:
+    uint64_t memory = 0;
+    uint32_t cpu_features = 0;
+    // Optional micro benchmark of the node data processor, higher is faster, zero if unknown:
+    uint32_t benchmark_score = 0;
+};
+
+[[nodiscard]] uint16_t nc_compressor_mask(NCCompressorID const compressor) noexcept;
+
+[[nodiscard]] uint16_t nc_encryption_mask(NCEncryptionID const encryption) noexcept;
+
+[[nodiscard]] std::vector<uint8_t> nc_encode_capabilities(NCCapabilities const& capabilities);
+
+[[nodiscard]] NCCapabilities nc_decode_capabilities(std::span<const uint8_t> const data);
+
+[[nodiscard]] std::vector<uint8_t> nc_encode_negotiated(NCNegotiatedCapabilities const& negotiated);
+
+[[nodiscard]] NCNegotiatedCapabilities nc_decode_negotiated(std::span<const uint8_t> const data);
+
+[[nodiscard]] std::vector<uint8_t> nc_encode_node_info(NCNodeInfo const& node_info);
+
+[[nodiscard]] NCNodeInfo nc_decode_node_info(std::span<const uint8_t> const data);
+
+// Number of cores, memory and CPU features of this machine:
+[[nodiscard]] NCNodeInfo nc_detect_node_info();
+
+// Relative speed of the node, the benchmark score if given, otherwise the number of cores:
+[[nodiscard]] double nc_node_weight(NCNodeInfo const& node_info) noexcept;
+
+[[nodiscard]] NCNegotiatedCapabilities nc_negotiate(NCCapabilities const& server, NCCapabilities const& node);
+
+[[nodiscard]] NCCompressorID nc_compressor_from_string(std::string_view const name);
+
+[[nodiscard]] NCEncryptionID nc_encryption_from_string(std::string_view const name);
+}
+
+#endif // FILE_NC_CAPABILITY_HPP_INCLUDED
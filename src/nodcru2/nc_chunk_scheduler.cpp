@@ -0,0 +1,304 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines the chunk scheduler and the chunk data processors.
+*/
+
+// STD includes:
+#include <algorithm>
+#include <cmath>
+
+// Local includes:
+#include "nc_chunk_scheduler.hpp"
+#include "nc_exceptions.hpp"
+#include "nc_buffer_pool.hpp"
+#include "nc_util.hpp"
+
+namespace nodcru2 {
+void nc_write_chunk_header(NCChunk const chunk, std::span<uint8_t> bytes) noexcept {
+    nc_to_big_endian_bytes64(chunk.begin, bytes.subspan(0, sizeof(uint64_t)));
+    nc_to_big_endian_bytes64(chunk.end, bytes.subspan(sizeof(uint64_t), sizeof(uint64_t)));
+}
+
+[[nodiscard]] NCChunk nc_read_chunk_header(std::span<const uint8_t> const bytes) {
+    if (bytes.size() < NC_CHUNK_HEADER_SIZE) {
+        throw NCMessageException("Chunk header too short.");
+    }
+
+    NCChunk const chunk{
+        nc_from_big_endian_bytes64(bytes.subspan(0, sizeof(uint64_t))),
+        nc_from_big_endian_bytes64(bytes.subspan(sizeof(uint64_t), sizeof(uint64_t)))
+    };
+
+    if (chunk.begin > chunk.end) {
+        throw NCMessageException("Invalid chunk range.");
+    }
+
+    return chunk;
+}
+
+NCChunkScheduler::NCChunkScheduler(uint64_t const num_items, uint64_t const min_chunk_size,
+    uint64_t const max_chunk_size, double const factor):
+    num_items_intern(num_items),
+    min_chunk_size_intern(std::max(min_chunk_size, uint64_t(1))),
+    max_chunk_size_intern(std::max(max_chunk_size, std::max(min_chunk_size, uint64_t(1)))),
+    factor_intern(std::max(factor, 1.0)),
+    next_item_intern(0),
+    requeued_intern(),
+    num_unassigned_intern(num_items),
+    num_done_intern(0),
+    nodes_intern(),
+    chunk_mutex()
+    {}
+
+[[nodiscard]] uint64_t NCChunkScheduler::nc_chunk_size(NCChunkNode const& node) const {
+    /*
+    Factoring: each node gets its share of 1 / factor of the remaining work,
+    scaled by its throughput relative to the mean throughput of all nodes.
+
+    Nodes without a measured throughput are scaled by their weight
+    relative to the mean weight of all nodes.
+    */
+
+    double throughput_sum = 0.0;
+    double weight_sum = 0.0;
+    size_t num_measured = 0;
+
+    for (auto const& [node_id, other]: nodes_intern) {
+        weight_sum += other.weight;
+
+        if (other.throughput > 0.0) {
+            throughput_sum += other.throughput;
+            num_measured++;
+        }
+    }
+
+    double const num_nodes = static_cast<double>(nodes_intern.size());
+    double size = static_cast<double>(num_unassigned_intern) / (factor_intern * num_nodes);
+
+    if ((node.throughput > 0.0) && (num_measured > 0)) {
+        size *= node.throughput / (throughput_sum / static_cast<double>(num_measured));
+    } else if (weight_sum > 0.0) {
+        size *= node.weight / (weight_sum / num_nodes);
+    }
+
+    double const max_size = static_cast<double>(max_chunk_size_intern);
+    uint64_t const chunk_size = (size >= max_size) ? max_chunk_size_intern :
+        std::max(static_cast<uint64_t>(std::ceil(size)), min_chunk_size_intern);
+
+    return std::min(chunk_size, num_unassigned_intern);
+}
+
+[[nodiscard]] std::optional<NCChunk> NCChunkScheduler::nc_next_chunk(NCNodeID const& node_id,
+    std::chrono::steady_clock::time_point const now) {
+    const std::lock_guard<std::mutex> lock(chunk_mutex);
+
+    if (num_unassigned_intern == 0) {
+        return std::nullopt;
+    }
+
+    NCChunkNode& node = nodes_intern[node_id];
+    uint64_t const size = nc_chunk_size(node);
+    NCChunk chunk;
+
+    if (!requeued_intern.empty()) {
+        // Split the requeued chunk if it is too large for this node:
+        NCChunk& requeued = requeued_intern.back();
+        chunk = NCChunk{requeued.begin, requeued.begin + std::min(size, requeued.nc_size())};
+        requeued.begin = chunk.end;
+
+        if (requeued.nc_size() == 0) {
+            requeued_intern.pop_back();
+        }
+    } else {
+        chunk = NCChunk{next_item_intern, next_item_intern + size};
+        next_item_intern = chunk.end;
+    }
+
+    num_unassigned_intern -= chunk.nc_size();
+    node.chunks.push_back(NCAssignedChunk{chunk, now});
+    return chunk;
+}
+
+bool NCChunkScheduler::nc_chunk_done(NCNodeID const& node_id, NCChunk const chunk,
+    std::chrono::steady_clock::time_point const now) {
+    /*
+    Mark the chunk as done.
+
+    The chunks of a timed out node may already be split and given to other
+    nodes, so late results of these chunks are not accepted.
+    */
+
+    const std::lock_guard<std::mutex> lock(chunk_mutex);
+    auto const item = nodes_intern.find(node_id);
+
+    if (item == nodes_intern.end()) {
+        return false;
+    }
+
+    NCChunkNode& node = item->second;
+    auto const position = std::find_if(node.chunks.begin(), node.chunks.end(),
+        [chunk] (NCAssignedChunk const& assigned) { return assigned.chunk == chunk; });
+
+    if (position == node.chunks.end()) {
+        return false;
+    }
+
+    std::chrono::duration<double> const elapsed = now - position->start_time;
+    // Guard against a zero duration:
+    double const sample = static_cast<double>(chunk.nc_size()) / std::max(elapsed.count(), 1e-6);
+
+    if (node.throughput > 0.0) {
+        node.throughput = (NC_CHUNK_THROUGHPUT_WEIGHT * sample) + ((1.0 - NC_CHUNK_THROUGHPUT_WEIGHT) * node.throughput);
+    } else {
+        node.throughput = sample;
+    }
+
+    node.chunks.erase(position);
+    num_done_intern += chunk.nc_size();
+    return true;
+}
+
+void NCChunkScheduler::nc_set_node_weight(NCNodeID const& node_id, double const weight) {
+    const std::lock_guard<std::mutex> lock(chunk_mutex);
+    nodes_intern[node_id].weight = std::max(weight, 0.0);
+}
+
+uint64_t NCChunkScheduler::nc_node_timeout(NCNodeID const& node_id) {
+    const std::lock_guard<std::mutex> lock(chunk_mutex);
+    auto const item = nodes_intern.find(node_id);
+
+    if (item == nodes_intern.end()) {
+        return 0;
+    }
+
+    uint64_t num_requeued = 0;
+
+    for (NCAssignedChunk const& assigned: item->second.chunks) {
+        requeued_intern.push_back(assigned.chunk);
+        num_requeued += assigned.chunk.nc_size();
+    }
+
+    num_unassigned_intern += num_requeued;
+    // The node doesn't count for the chunk size anymore:
+    nodes_intern.erase(item);
+    return num_requeued;
+}
+
+[[nodiscard]] bool NCChunkScheduler::nc_is_done() const {
+    const std::lock_guard<std::mutex> lock(chunk_mutex);
+    return num_done_intern == num_items_intern;
+}
+
+[[nodiscard]] uint64_t NCChunkScheduler::nc_num_items() const noexcept {
+    return num_items_intern;
+}
+
+[[nodiscard]] uint64_t NCChunkScheduler::nc_num_done() const {
+    const std::lock_guard<std::mutex> lock(chunk_mutex);
+    return num_done_intern;
+}
+
+[[nodiscard]] uint64_t NCChunkScheduler::nc_num_unassigned() const {
+    const std::lock_guard<std::mutex> lock(chunk_mutex);
+    return num_unassigned_intern;
+}
+
+[[nodiscard]] double NCChunkScheduler::nc_get_throughput(NCNodeID const& node_id) const {
+    const std::lock_guard<std::mutex> lock(chunk_mutex);
+
+    if (auto const item = nodes_intern.find(node_id); item != nodes_intern.end()) {
+        return item->second.throughput;
+    }
+
+    return 0.0;
+}
+
+NCChunkServerProcessor::NCChunkServerProcessor(uint64_t const num_items, uint64_t const min_chunk_size,
+    uint64_t const max_chunk_size, double const factor):
+    NCServerDataProcessor(),
+    scheduler_intern(num_items, min_chunk_size, max_chunk_size, factor)
+    {
+        // The server checks this counter instead of calling nc_is_job_done():
+        nc_set_remaining_work(num_items);
+    }
+
+[[nodiscard]] std::vector<uint8_t> NCChunkServerProcessor::nc_get_chunk_data([[maybe_unused]] NCNodeID node_id,
+    [[maybe_unused]] NCChunk const chunk) {
+    return std::vector<uint8_t>();
+}
+
+[[nodiscard]] std::vector<uint8_t> NCChunkServerProcessor::nc_get_new_data(NCNodeID node_id) {
+    /*
+    The data starts with the chunk range, followed by the user data.
+
+    If all chunks are handed out the data is empty, the node sends back
+    an empty result and asks again until the job is done.
+    */
+
+    auto const chunk = scheduler_intern.nc_next_chunk(node_id);
+
+    if (!chunk) {
+        return std::vector<uint8_t>();
+    }
+
+    std::vector<uint8_t> const chunk_data = nc_get_chunk_data(node_id, *chunk);
+    std::vector<uint8_t> data(NC_CHUNK_HEADER_SIZE + chunk_data.size());
+    nc_write_chunk_header(*chunk, data);
+    std::copy(chunk_data.begin(), chunk_data.end(), data.begin() + NC_CHUNK_HEADER_SIZE);
+
+    return data;
+}
+
+void NCChunkServerProcessor::nc_process_result(NCNodeID node_id, std::vector<uint8_t> result) {
+    if (result.size() >= NC_CHUNK_HEADER_SIZE) {
+        NCChunk const chunk = nc_read_chunk_header(result);
+
+        if (scheduler_intern.nc_chunk_done(node_id, chunk)) {
+            nc_process_chunk_result(node_id, chunk, std::span<const uint8_t>(result).subspan(NC_CHUNK_HEADER_SIZE));
+            nc_work_done(chunk.nc_size());
+        }
+    }
+
+    nc_release_buffer(std::move(result));
+}
+
+void NCChunkServerProcessor::nc_node_timeout(NCNodeID node_id) {
+    // Give the unfinished chunks of this node to other nodes:
+    scheduler_intern.nc_node_timeout(node_id);
+}
+
+void NCChunkServerProcessor::nc_node_info(NCNodeID node_id, NCNodeInfo const& node_info) {
+    // Stronger nodes get larger chunks from the first chunk on:
+    scheduler_intern.nc_set_node_weight(node_id, nc_node_weight(node_info));
+}
+
+[[nodiscard]] NCChunkScheduler& NCChunkServerProcessor::nc_get_scheduler() noexcept {
+    return scheduler_intern;
+}
+
+void NCChunkNodeProcessor::nc_process_data_into(std::vector<uint8_t> data, std::vector<uint8_t>& result) {
+    /*
+    The result starts with the same chunk range as the data,
+    so the server knows which chunk is done.
+    */
+
+    result.clear();
+
+    if (data.empty()) {
+        // No chunk left at the moment:
+        return;
+    }
+
+    NCChunk const chunk = nc_read_chunk_header(data);
+    std::vector<uint8_t> const chunk_result = nc_process_chunk(chunk,
+        std::span<const uint8_t>(data).subspan(NC_CHUNK_HEADER_SIZE));
+
+    result.resize(NC_CHUNK_HEADER_SIZE);
+    nc_write_chunk_header(chunk, result);
+    result.insert(result.end(), chunk_result.begin(), chunk_result.end());
+}
+}
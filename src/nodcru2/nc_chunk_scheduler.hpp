@@ -0,0 +1,175 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines the chunk scheduler and the chunk data processors.
+
+    The job is a divisible range of work items [0, n). Instead of a fixed
+    task size the scheduler sizes each hand-out (chunk) from the remaining
+    work and the measured throughput of the node (factoring): early chunks
+    are large to keep the per message overhead low, the chunks get smaller
+    towards the end of the job so all nodes finish at about the same time.
+    Faster nodes get larger chunks than slower nodes. Until the first result
+    of a node arrives its weight (e.g. the number of cores) is used instead.
+    All methods of the scheduler are thread safe.
+*/
+
+#ifndef FILE_NC_CHUNK_SCHEDULER_HPP_INCLUDED
+#define FILE_NC_CHUNK_SCHEDULER_HPP_INCLUDED
+
+// STD includes:
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <span>
+#include <mutex>
+#include <chrono>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+
+// Local includes:
+#include "nc_nodeid.hpp"
+#include "nc_server.hpp"
+#include "nc_node.hpp"
+
+namespace nodcru2 {
+// Weight of the newest sample in the throughput estimate of a node:
+double const NC_CHUNK_THROUGHPUT_WEIGHT = 0.5;
+// Begin and end of the chunk in front of the data and the result:
+size_t const NC_CHUNK_HEADER_SIZE = 2 * sizeof(uint64_t);
+
+struct NCChunk {
+    uint64_t begin = 0;
+    uint64_t end = 0;
+
+    [[nodiscard]] uint64_t nc_size() const noexcept {
+        return end - begin;
+    }
+
+    [[nodiscard]] bool operator==(NCChunk const&) const = default;
+};
+
+void nc_write_chunk_header(NCChunk const chunk, std::span<uint8_t> bytes) noexcept;
+[[nodiscard]] NCChunk nc_read_chunk_header(std::span<const uint8_t> const bytes);
+
+struct NCAssignedChunk {
+    NCChunk chunk;
+    std::chrono::steady_clock::time_point start_time = {};
+};
+
+struct NCChunkNode {
+    // Work items per second, zero until the first result arrives:
+    double throughput = 0.0;
+    // Relative speed of the node, used until the throughput is known:
+    double weight = 1.0;
+    // Chunks of the node, oldest first:
+    std::deque<NCAssignedChunk> chunks;
+};
+
+class NCChunkScheduler {
+    public:
+        // Returns the next chunk for the node, nothing if all work items are handed out:
+        [[nodiscard]] std::optional<NCChunk> nc_next_chunk(NCNodeID const& node_id,
+            std::chrono::steady_clock::time_point const now = std::chrono::steady_clock::now());
+
+        // Returns true if the node was working on this chunk, the result should then be kept.
+        // Updates the throughput of the node:
+        bool nc_chunk_done(NCNodeID const& node_id, NCChunk const chunk,
+            std::chrono::steady_clock::time_point const now = std::chrono::steady_clock::now());
+
+        // The weight is relative to the other nodes, see nc_node_weight():
+        void nc_set_node_weight(NCNodeID const& node_id, double const weight);
+
+        // All unfinished chunks of the node are given to other nodes, returns the number of work items:
+        uint64_t nc_node_timeout(NCNodeID const& node_id);
+
+        [[nodiscard]] bool nc_is_done() const;
+        [[nodiscard]] uint64_t nc_num_items() const noexcept;
+        [[nodiscard]] uint64_t nc_num_done() const;
+        // Number of work items that are not handed out yet:
+        [[nodiscard]] uint64_t nc_num_unassigned() const;
+        [[nodiscard]] double nc_get_throughput(NCNodeID const& node_id) const;
+
+        // Constructor:
+        NCChunkScheduler(uint64_t const num_items, uint64_t const min_chunk_size = 1,
+            uint64_t const max_chunk_size = std::numeric_limits<uint64_t>::max(), double const factor = 2.0);
+
+        // Disable all other special member functions:
+        NCChunkScheduler() = delete;
+        NCChunkScheduler(const NCChunkScheduler&) = delete;
+        NCChunkScheduler& operator=(const NCChunkScheduler&) = delete;
+        NCChunkScheduler(NCChunkScheduler&&) = delete;
+        NCChunkScheduler& operator=(NCChunkScheduler&&) = delete;
+
+    private:
+        uint64_t const num_items_intern;
+        uint64_t const min_chunk_size_intern;
+        uint64_t const max_chunk_size_intern;
+        double const factor_intern;
+        // Start of the work items that have never been handed out:
+        uint64_t next_item_intern;
+        // Chunks of timed out nodes, handed out first:
+        std::vector<NCChunk> requeued_intern;
+        uint64_t num_unassigned_intern;
+        uint64_t num_done_intern;
+        std::unordered_map<NCNodeID, NCChunkNode> nodes_intern;
+        mutable std::mutex chunk_mutex;
+
+        // The lock must be held:
+        [[nodiscard]] uint64_t nc_chunk_size(NCChunkNode const& node) const;
+};
+
+class NCChunkServerProcessor: public NCServerDataProcessor {
+    public:
+        // Constructor:
+        NCChunkServerProcessor(uint64_t const num_items, uint64_t const min_chunk_size = 1,
+            uint64_t const max_chunk_size = std::numeric_limits<uint64_t>::max(), double const factor = 2.0);
+
+        // Destructor:
+        virtual ~NCChunkServerProcessor() = default;
+
+        // Disable all other special member functions:
+        NCChunkServerProcessor(NCChunkServerProcessor&&) = delete;
+        NCChunkServerProcessor(const NCChunkServerProcessor&) = delete;
+        NCChunkServerProcessor& operator=(const NCChunkServerProcessor&) = delete;
+        NCChunkServerProcessor& operator=(NCChunkServerProcessor&&) = delete;
+
+        // Must be implemented by the user:
+        // Optional extra data for the chunk, the node gets the chunk range in any case:
+        [[nodiscard]] virtual std::vector<uint8_t> nc_get_chunk_data(NCNodeID node_id, NCChunk const chunk);
+        virtual void nc_process_chunk_result(NCNodeID node_id, NCChunk const chunk, std::span<const uint8_t> const result) = 0;
+
+        // Called by the server:
+        [[nodiscard]] std::vector<uint8_t> nc_get_new_data(NCNodeID node_id) final;
+        void nc_process_result(NCNodeID node_id, std::vector<uint8_t> result) final;
+        void nc_node_timeout(NCNodeID node_id) override;
+        void nc_node_info(NCNodeID node_id, NCNodeInfo const& node_info) override;
+
+        [[nodiscard]] NCChunkScheduler& nc_get_scheduler() noexcept;
+
+    private:
+        NCChunkScheduler scheduler_intern;
+};
+
+class NCChunkNodeProcessor: public NCNodeDataProcessor {
+    public:
+        // Default special member functions:
+        NCChunkNodeProcessor() = default;
+        virtual ~NCChunkNodeProcessor() = default;
+        NCChunkNodeProcessor(NCChunkNodeProcessor&&) = default;
+        NCChunkNodeProcessor(const NCChunkNodeProcessor&) = default;
+        NCChunkNodeProcessor& operator=(const NCChunkNodeProcessor&) = default;
+        NCChunkNodeProcessor& operator=(NCChunkNodeProcessor&&) = default;
+
+        // Must be implemented by the user:
+        [[nodiscard]] virtual std::vector<uint8_t> nc_process_chunk(NCChunk const chunk, std::span<const uint8_t> const data) = 0;
+
+        // Called by the node:
+        void nc_process_data_into(std::vector<uint8_t> data, std::vector<uint8_t>& result) final;
+};
+}
+
+#endif // FILE_NC_CHUNK_SCHEDULER_HPP_INCLUDED
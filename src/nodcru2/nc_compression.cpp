@@ -9,17 +9,19 @@
 
 // External includes:
 #include <lz4.h>
+#include <lz4hc.h>
 
 // Local includes:
 #include "nc_compression.hpp"
 #include "nc_util.hpp"
 #include "nc_exceptions.hpp"
+#include "nc_buffer_pool.hpp"
 
 namespace nodcru2 {
 [[nodiscard]] NCCompressedMessage NCCompressor::nc_compress_message(NCDecompressedMessage const& message) const {
     const uint32_t original_size = static_cast<uint32_t>(message.data.size());
     const size_t max_compressed_size = static_cast<size_t>(LZ4_compressBound(static_cast<int>(original_size)));
-    std::vector<uint8_t> compressed_data(max_compressed_size + 4);
+    std::vector<uint8_t> compressed_data = nc_acquire_buffer(max_compressed_size + 4);
 
     const size_t compressed_size = static_cast<size_t>(LZ4_compress_default(
         reinterpret_cast<const char*>(message.data.data()),
@@ -31,7 +33,7 @@ namespace nodcru2 {
     if (compressed_size > 0) {
         compressed_data.resize(compressed_size + 4);
         nc_to_big_endian_bytes(original_size, compressed_data);
-        return NCCompressedMessage(compressed_data);
+        return NCCompressedMessage(std::move(compressed_data));
     } else {
         throw NCCompressionException();
     }
@@ -39,7 +41,7 @@ namespace nodcru2 {
 
 [[nodiscard]] NCDecompressedMessage NCCompressor::nc_decompress_message(NCCompressedMessage const& message) const {
     const uint32_t original_size = nc_from_big_endian_bytes(message.data);
-    std::vector<uint8_t> decompressed_data(original_size);
+    std::vector<uint8_t> decompressed_data = nc_acquire_buffer(original_size);
     const int32_t decompressed_size = LZ4_decompress_safe(
         reinterpret_cast<const char*>(message.data.data() + 4),
         reinterpret_cast<char*>(decompressed_data.data()),
@@ -47,26 +49,76 @@ namespace nodcru2 {
         static_cast<int>(original_size)
     );
 
-    if (decompressed_size > 0) {
-        return NCDecompressedMessage(decompressed_data);
+    // An empty message (i.e. heartbeat) has a decompressed size of zero:
+    if ((decompressed_size >= 0) && (static_cast<uint32_t>(decompressed_size) == original_size)) {
+        return NCDecompressedMessage(std::move(decompressed_data));
     } else {
         throw NCDecompressionException();
     }
 }
 
+[[nodiscard]] NCCompressorID NCCompressor::nc_compressor_id() const {
+    return NCCompressorID::LZ4;
+}
+
 [[nodiscard]] NCCompressedMessage NCNonCompressor::nc_compress_message(NCDecompressedMessage const& message) const {
     const uint32_t original_size = static_cast<uint32_t>(message.data.size());
-    std::vector<uint8_t> compressed_data(original_size + 4);
+    std::vector<uint8_t> compressed_data = nc_acquire_buffer(original_size + 4);
     std::copy(message.data.cbegin(), message.data.cend(), compressed_data.begin() + 4);
     nc_to_big_endian_bytes(original_size, compressed_data);
-    return NCCompressedMessage(compressed_data);
+    return NCCompressedMessage(std::move(compressed_data));
 }
 
 [[nodiscard]] NCDecompressedMessage NCNonCompressor::nc_decompress_message(NCCompressedMessage const& message) const {
+    // The size header must match the stored data exactly:
+    if (message.data.size() < 4) {
+        throw NCDecompressionException();
+    }
+
     const uint32_t original_size = nc_from_big_endian_bytes(message.data);
-    std::vector<uint8_t> decompressed_data(original_size);
+
+    if (original_size != message.data.size() - 4) {
+        throw NCDecompressionException();
+    }
+
+    std::vector<uint8_t> decompressed_data = nc_acquire_buffer(original_size);
     std::copy(message.data.cbegin() + 4, message.data.cend(), decompressed_data.begin());
-    return NCDecompressedMessage{decompressed_data};
+    return NCDecompressedMessage{std::move(decompressed_data)};
+}
+
+[[nodiscard]] NCCompressorID NCNonCompressor::nc_compressor_id() const {
+    return NCCompressorID::None;
+}
+
+NCCompressorHC::NCCompressorHC(int32_t const level):
+    NCCompressor(),
+    level_intern(level)
+    {}
+
+[[nodiscard]] NCCompressedMessage NCCompressorHC::nc_compress_message(NCDecompressedMessage const& message) const {
+    const uint32_t original_size = static_cast<uint32_t>(message.data.size());
+    const size_t max_compressed_size = static_cast<size_t>(LZ4_compressBound(static_cast<int>(original_size)));
+    std::vector<uint8_t> compressed_data = nc_acquire_buffer(max_compressed_size + 4);
+
+    const size_t compressed_size = static_cast<size_t>(LZ4_compress_HC(
+        reinterpret_cast<const char*>(message.data.data()),
+        reinterpret_cast<char*>(compressed_data.data() + 4),
+        static_cast<int>(original_size),
+        static_cast<int>(max_compressed_size),
+        level_intern
+    ));
+
+    if (compressed_size > 0) {
+        compressed_data.resize(compressed_size + 4);
+        nc_to_big_endian_bytes(original_size, compressed_data);
+        return NCCompressedMessage(std::move(compressed_data));
+    } else {
+        throw NCCompressionException();
+    }
+}
+
+[[nodiscard]] NCCompressorID NCCompressorHC::nc_compressor_id() const {
+    return NCCompressorID::LZ4HC;
 }
 
 }
@@ -24,6 +24,7 @@ class NCCompressor {
     public:
         [[nodiscard]] virtual NCCompressedMessage nc_compress_message(NCDecompressedMessage const& message) const;
         [[nodiscard]] virtual NCDecompressedMessage nc_decompress_message(NCCompressedMessage const& message) const;
+        [[nodiscard]] virtual NCCompressorID nc_compressor_id() const;
 
         // Constructor:
         NCCompressor() = default;
@@ -40,10 +41,11 @@ class NCCompressor {
         NCCompressor& operator=(NCCompressor&&) = delete;
 };
 
-class NCNonCompressor: NCCompressor {
+class NCNonCompressor: public NCCompressor {
     public:
         [[nodiscard]] NCCompressedMessage nc_compress_message(NCDecompressedMessage const& message) const override;
         [[nodiscard]] NCDecompressedMessage nc_decompress_message(NCCompressedMessage const& message) const override;
+        [[nodiscard]] NCCompressorID nc_compressor_id() const override;
 
         // Constructor:
         NCNonCompressor() = default;
@@ -57,6 +59,28 @@ class NCNonCompressor: NCCompressor {
         NCNonCompressor& operator=(NCNonCompressor&&) = delete;
 };
 
+// Slower but stronger compression (LZ4 HC), useful for slow network links.
+// The decompression is the same as for NCCompressor.
+class NCCompressorHC: public NCCompressor {
+    public:
+        [[nodiscard]] NCCompressedMessage nc_compress_message(NCDecompressedMessage const& message) const override;
+        [[nodiscard]] NCCompressorID nc_compressor_id() const override;
+
+        // Constructor:
+        NCCompressorHC(int32_t const level = 9);
+
+        // Default special member functions:
+        NCCompressorHC(NCCompressorHC&&) = default;
+        NCCompressorHC(const NCCompressorHC&) = default;
+        NCCompressorHC& operator=(const NCCompressorHC&) = default;
+
+        // Disable all other special member functions:
+        NCCompressorHC& operator=(NCCompressorHC&&) = delete;
+
+    private:
+        int32_t level_intern;
+};
+
 }
 
 #endif // FILE_NC_COMPRESSION_HPP_INCLUDED
@@ -21,12 +21,26 @@ NCConfiguration::NCConfiguration(std::string secret_key_user):
     server_address("127.0.0.1"),
     server_port(3100),
     heartbeat_timeout(60 * 5), // Seconds
+    phi_threshold(8.0), // Suspicion level of the failure detector, zero: static heartbeat timeout
     quit_counter(10), // Number of rounds to wait before quitting
     secret_key(secret_key_user),
     nc_server_log_file(""),
     nc_server_log_level(""),
     nc_node_log_file(""),
-    nc_node_log_level("")
+    nc_node_log_level(""),
+    preferred_compressor(NCCompressorID::LZ4),
+    preferred_encryption(NCEncryptionID::ChaCha20Poly1305),
+    max_frame_size(NC_DEFAULT_MAX_FRAME_SIZE), // Bytes
+    serialize_processor(false), // Run all server data processor callbacks on one thread
+    io_threads(10), // Server threads that receive and send messages
+    codec_threads(4), // Server threads that decode and encode messages (each)
+    processor_threads(4), // Server threads that call the data processor
+    batch_size(1), // Maximum number of tasks a node asks for in one request
+    result_batch_size(1), // Number of results a node sends in one message, one: no batching
+    result_batch_bytes(1024 * 1024), // Bytes, a node sends the result batch when it is larger
+    result_batch_time(1000), // Milliseconds, a node sends the result batch when the oldest result is older
+    prefetch_depth(0), // Number of tasks and results a node keeps in flight while it computes, zero: no prefetch
+    num_workers(1) // Number of tasks a node computes at the same time, sharing one registration
 {
     size_t key_length = secret_key_user.size();
     if (key_length != 32)
@@ -60,11 +74,19 @@ NCConfiguration::NCConfiguration(std::string secret_key_user):
     if (auto v = json_config.find("heartbeat_timeout"); v != nullptr) {
         config.heartbeat_timeout = v->as<uint16_t>();
 
-        if (config.heartbeat_timeout < 10) {
+        if (config.heartbeat_timeout < NC_MIN_HEARTBEAT_TIMEOUT) {
             throw NCConfigurationException("Invalid heartbeat");
         }
     }
 
+    if (auto v = json_config.find("phi_threshold"); v != nullptr) {
+        config.phi_threshold = v->as<double>();
+
+        if (!(config.phi_threshold >= 0.0)) {
+            throw NCConfigurationException("Invalid phi threshold");
+        }
+    }
+
     if (auto v = json_config.find("quit_counter"); v != nullptr) {
         config.quit_counter = v->as<uint8_t>();
     }
@@ -85,6 +107,90 @@ NCConfiguration::NCConfiguration(std::string secret_key_user):
         config.nc_node_log_level = v->as<std::string>();
     }
 
+    if (auto v = json_config.find("preferred_compressor"); v != nullptr) {
+        config.preferred_compressor = nc_compressor_from_string(v->as<std::string>());
+    }
+
+    if (auto v = json_config.find("preferred_encryption"); v != nullptr) {
+        config.preferred_encryption = nc_encryption_from_string(v->as<std::string>());
+    }
+
+    if (auto v = json_config.find("max_frame_size"); v != nullptr) {
+        config.max_frame_size = v->as<uint32_t>();
+
+        if (config.max_frame_size < 1024) {
+            throw NCConfigurationException("Invalid max frame size");
+        }
+    }
+
+    if (auto v = json_config.find("serialize_processor"); v != nullptr) {
+        config.serialize_processor = v->as<bool>();
+    }
+
+    if (auto v = json_config.find("io_threads"); v != nullptr) {
+        config.io_threads = v->as<uint16_t>();
+
+        if (config.io_threads == 0) {
+            throw NCConfigurationException("Invalid number of io threads");
+        }
+    }
+
+    if (auto v = json_config.find("codec_threads"); v != nullptr) {
+        config.codec_threads = v->as<uint16_t>();
+
+        if (config.codec_threads == 0) {
+            throw NCConfigurationException("Invalid number of codec threads");
+        }
+    }
+
+    if (auto v = json_config.find("processor_threads"); v != nullptr) {
+        config.processor_threads = v->as<uint16_t>();
+
+        if (config.processor_threads == 0) {
+            throw NCConfigurationException("Invalid number of processor threads");
+        }
+    }
+
+    if (auto v = json_config.find("batch_size"); v != nullptr) {
+        config.batch_size = v->as<uint32_t>();
+
+        if (config.batch_size == 0) {
+            throw NCConfigurationException("Invalid batch size");
+        }
+    }
+
+    if (auto v = json_config.find("result_batch_size"); v != nullptr) {
+        config.result_batch_size = v->as<uint32_t>();
+
+        if (config.result_batch_size == 0) {
+            throw NCConfigurationException("Invalid result batch size");
+        }
+    }
+
+    if (auto v = json_config.find("result_batch_bytes"); v != nullptr) {
+        config.result_batch_bytes = v->as<uint32_t>();
+
+        if (config.result_batch_bytes == 0) {
+            throw NCConfigurationException("Invalid result batch bytes");
+        }
+    }
+
+    if (auto v = json_config.find("result_batch_time"); v != nullptr) {
+        config.result_batch_time = v->as<uint32_t>();
+    }
+
+    if (auto v = json_config.find("prefetch_depth"); v != nullptr) {
+        config.prefetch_depth = v->as<uint32_t>();
+    }
+
+    if (auto v = json_config.find("num_workers"); v != nullptr) {
+        config.num_workers = v->as<uint16_t>();
+
+        if (config.num_workers == 0) {
+            throw NCConfigurationException("Invalid number of workers");
+        }
+    }
+
     return config;
 }
 
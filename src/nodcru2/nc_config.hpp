@@ -19,18 +19,38 @@
 // External includes:
 #include <tao/json.hpp>
 
+// Local includes:
+#include "nc_capability.hpp"
+
 namespace nodcru2 {
+// The smallest heartbeat timeout in seconds, the server checks the heartbeats ten times per timeout:
+uint16_t const NC_MIN_HEARTBEAT_TIMEOUT = 10;
+
 class NCConfiguration {
     public:
         std::string server_address;
         uint16_t server_port;
         uint16_t heartbeat_timeout;
+        double phi_threshold;
         uint8_t quit_counter;
         std::string secret_key;
         std::string nc_server_log_file;
         std::string nc_server_log_level;
         std::string nc_node_log_file;
         std::string nc_node_log_level;
+        NCCompressorID preferred_compressor;
+        NCEncryptionID preferred_encryption;
+        uint32_t max_frame_size;
+        bool serialize_processor;
+        uint16_t io_threads;
+        uint16_t codec_threads;
+        uint16_t processor_threads;
+        uint32_t batch_size;
+        uint32_t result_batch_size;
+        uint32_t result_batch_bytes;
+        uint32_t result_batch_time;
+        uint32_t prefetch_depth;
+        uint16_t num_workers;
 
         // Constructor:
         NCConfiguration(std::string secret_key_user);
@@ -9,6 +9,7 @@
 
 // STD includes:
 #include <iostream>
+#include <tuple>
 
 // External includes:
 #include <openssl/evp.h>
@@ -18,11 +19,34 @@
 // Local includes:
 #include "nc_encryption.hpp"
 #include "nc_exceptions.hpp"
+#include "nc_buffer_pool.hpp"
 
 namespace nodcru2 {
-NCEncryption::NCEncryption(std::string const secret_key): secret_key_intern(secret_key) {}
+[[nodiscard]] EVP_CIPHER const* nc_evp_cipher(NCEncryptionID const cipher) {
+    switch (cipher) {
+        case NCEncryptionID::ChaCha20Poly1305:
+            return EVP_chacha20_poly1305();
+        case NCEncryptionID::AES256GCM:
+            return EVP_aes_256_gcm();
+        default:
+            throw NCEncryptionException("Unknown cipher.");
+    }
+}
+
+NCEncryption::NCEncryption(std::string const secret_key, NCEncryptionID const cipher):
+    secret_key_intern(secret_key),
+    cipher_intern(cipher)
+    {
+        // Check for a valid cipher:
+        std::ignore = nc_evp_cipher(cipher_intern);
+    }
 
-[[nodiscard]] NCEncryptedMessage NCEncryption::nc_encrypt_message(NCDecryptedMessage const& message) const {
+[[nodiscard]] NCEncryptionID NCEncryption::nc_encryption_id() const {
+    return cipher_intern;
+}
+
+[[nodiscard]] NCEncryptedMessage NCEncryption::nc_encrypt_message(NCDecryptedMessage const& message,
+    std::span<const uint8_t> const associated_data) const {
     EVP_CIPHER_CTX* ctx = nullptr;
 
     // Create and initialize context:
@@ -31,13 +55,13 @@ NCEncryption::NCEncryption(std::string const secret_key): secret_key_intern(secr
     }
 
     // Initialize the encryption operation:
-    if (1 != EVP_EncryptInit_ex(ctx, EVP_chacha20_poly1305(), nullptr,
+    if (1 != EVP_EncryptInit_ex(ctx, nc_evp_cipher(cipher_intern), nullptr,
         reinterpret_cast<const unsigned char *>(secret_key_intern.c_str()), nullptr)) {
         EVP_CIPHER_CTX_free(ctx);
         throw NCEncryptionException("Encrypt init error.");
     }
 
-    // Set the nonce (IV) length. ChaCha20-Poly1305 uses 12-byte nonce:
+    // Set the nonce (IV) length. ChaCha20-Poly1305 and AES-256-GCM use a 12-byte nonce:
     if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, NC_NONCE_LENGTH, nullptr)) {
         EVP_CIPHER_CTX_free(ctx);
         throw NCEncryptionException("Cipher controll error.");
@@ -60,15 +84,23 @@ NCEncryption::NCEncryption(std::string const secret_key): secret_key_intern(secr
         throw NCEncryptionException("Set nonce error.");
     }
 
-    size_t block_size = static_cast<size_t>(EVP_CIPHER_get_block_size(EVP_chacha20_poly1305()));
+    size_t block_size = static_cast<size_t>(EVP_CIPHER_get_block_size(nc_evp_cipher(cipher_intern)));
     // std::cout << "Block size: " << std::dec << block_size << std::endl;
 
-    // Provide the message data to be encrypted:
+    // Provide the associated data (AAD), if any. It is only authenticated, not encrypted:
     int32_t len = 0;
+    if (associated_data.size() > 0) {
+        if (1 != EVP_EncryptUpdate(ctx, nullptr, &len, associated_data.data(), static_cast<int>(associated_data.size()))) {
+            EVP_CIPHER_CTX_free(ctx);
+            throw NCEncryptionException("Encrypt associated data error.");
+        }
+    }
+
+    // Provide the message data to be encrypted:
     size_t const message_len = message.data.size();
     // std::cout << "Message length: " << message_len << std::endl;
     // Ciphertext will be same size as message:
-    result.data.resize(message_len + block_size);
+    result.data = nc_acquire_buffer(message_len + block_size);
     if (1 != EVP_EncryptUpdate(ctx, result.data.data(), &len, message.data.data(), static_cast<int>(message_len))) {
         EVP_CIPHER_CTX_free(ctx);
         throw NCEncryptionException("Encrypt update error.");
@@ -98,7 +130,8 @@ NCEncryption::NCEncryption(std::string const secret_key): secret_key_intern(secr
     return result;
 }
 
-[[nodiscard]] NCDecryptedMessage NCEncryption::nc_decrypt_message(NCEncryptedMessage &message) const {
+[[nodiscard]] NCDecryptedMessage NCEncryption::nc_decrypt_message(NCEncryptedMessage &message,
+    std::span<const uint8_t> const associated_data) const {
     EVP_CIPHER_CTX* ctx = nullptr;
 
     // Create and initialize context:
@@ -107,13 +140,13 @@ NCEncryption::NCEncryption(std::string const secret_key): secret_key_intern(secr
     }
 
     // Initialize the decryption operation
-    if (1 != EVP_DecryptInit_ex(ctx, EVP_chacha20_poly1305(), nullptr,
+    if (1 != EVP_DecryptInit_ex(ctx, nc_evp_cipher(cipher_intern), nullptr,
         reinterpret_cast<const unsigned char *>(secret_key_intern.c_str()), nullptr)) {
         EVP_CIPHER_CTX_free(ctx);
         throw NCEncryptionException("Decrypt init error.");
     }
 
-    // Set the nonce (IV) length. ChaCha20-Poly1305 uses 12-byte nonce:
+    // Set the nonce (IV) length. ChaCha20-Poly1305 and AES-256-GCM use a 12-byte nonce:
     if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, NC_NONCE_LENGTH, nullptr)) {
         EVP_CIPHER_CTX_free(ctx);
         throw NCEncryptionException("Cipher controll error");
@@ -135,16 +168,24 @@ NCEncryption::NCEncryption(std::string const secret_key): secret_key_intern(secr
         throw NCEncryptionException("Cipher set tag error.");
     }
 
-    size_t const block_size = static_cast<size_t>(EVP_CIPHER_get_block_size(EVP_chacha20_poly1305()));
+    size_t const block_size = static_cast<size_t>(EVP_CIPHER_get_block_size(nc_evp_cipher(cipher_intern)));
 
     // std::cout << "block_size: " << block_size << "\n";
 
+    // Provide the associated data (AAD), if any. It must match the data given at encryption:
+    int32_t len = 0;
+    if (associated_data.size() > 0) {
+        if (1 != EVP_DecryptUpdate(ctx, nullptr, &len, associated_data.data(), static_cast<int>(associated_data.size()))) {
+            EVP_CIPHER_CTX_free(ctx);
+            throw NCEncryptionException("Decrypt associated data error.");
+        }
+    }
+
     // Provide the ciphertext data to be decrypted:
     NCDecryptedMessage result;
     size_t const ciphertext_len = message.data.size();
      // Plaintext will be same size as ciphertext:
-    result.data.resize(ciphertext_len + block_size);
-    int32_t len = 0;
+    result.data = nc_acquire_buffer(ciphertext_len + block_size);
     if (1 != EVP_DecryptUpdate(ctx, result.data.data(), &len, message.data.data(), static_cast<int>(ciphertext_len))) {
         EVP_CIPHER_CTX_free(ctx);
         throw NCEncryptionException("Decrypt update error.");
@@ -174,11 +215,17 @@ NCEncryption::NCEncryption(std::string const secret_key): secret_key_intern(secr
 
 NCNonEncryption::NCNonEncryption(std::string const secret_key): NCEncryption(secret_key) {}
 
-[[nodiscard]] NCEncryptedMessage NCNonEncryption::nc_encrypt_message(NCDecryptedMessage const& message) const {
+[[nodiscard]] NCEncryptionID NCNonEncryption::nc_encryption_id() const {
+    return NCEncryptionID::None;
+}
+
+[[nodiscard]] NCEncryptedMessage NCNonEncryption::nc_encrypt_message(NCDecryptedMessage const& message,
+    [[maybe_unused]] std::span<const uint8_t> const associated_data) const {
     return NCEncryptedMessage{{}, {}, message.data};
 }
 
-[[nodiscard]] NCDecryptedMessage NCNonEncryption::nc_decrypt_message(NCEncryptedMessage &message) const {
+[[nodiscard]] NCDecryptedMessage NCNonEncryption::nc_decrypt_message(NCEncryptedMessage &message,
+    [[maybe_unused]] std::span<const uint8_t> const associated_data) const {
     return NCDecryptedMessage{message.data};
 }
 
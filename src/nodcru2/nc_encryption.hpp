@@ -15,6 +15,7 @@
 #include <vector>
 #include <string>
 #include <expected>
+#include <span>
 
 // Local includes:
 #include "nc_message_types.hpp"
@@ -22,11 +23,16 @@
 namespace nodcru2 {
 class NCEncryption {
     public:
-        [[nodiscard]] virtual NCEncryptedMessage nc_encrypt_message(NCDecryptedMessage const& message) const;
-        [[nodiscard]] virtual NCDecryptedMessage nc_decrypt_message(NCEncryptedMessage &message) const;
+        // The associated data is not encrypted, but it is authenticated by the tag:
+        [[nodiscard]] virtual NCEncryptedMessage nc_encrypt_message(NCDecryptedMessage const& message,
+            std::span<const uint8_t> const associated_data = {}) const;
+        [[nodiscard]] virtual NCDecryptedMessage nc_decrypt_message(NCEncryptedMessage &message,
+            std::span<const uint8_t> const associated_data = {}) const;
+        [[nodiscard]] virtual NCEncryptionID nc_encryption_id() const;
 
         // Constructor:
-        NCEncryption(std::string const secret_key);
+        NCEncryption(std::string const secret_key,
+            NCEncryptionID const cipher = NCEncryptionID::ChaCha20Poly1305);
 
         // Destructor
         virtual ~NCEncryption() = default;
@@ -41,12 +47,16 @@ class NCEncryption {
 
     private:
         const std::string secret_key_intern;
+        const NCEncryptionID cipher_intern;
 };
 
-class NCNonEncryption: NCEncryption {
+class NCNonEncryption: public NCEncryption {
     public:
-        [[nodiscard]] NCEncryptedMessage nc_encrypt_message(NCDecryptedMessage const& message) const override;
-        [[nodiscard]] NCDecryptedMessage nc_decrypt_message(NCEncryptedMessage &message) const override;
+        [[nodiscard]] NCEncryptedMessage nc_encrypt_message(NCDecryptedMessage const& message,
+            std::span<const uint8_t> const associated_data = {}) const override;
+        [[nodiscard]] NCDecryptedMessage nc_decrypt_message(NCEncryptedMessage &message,
+            std::span<const uint8_t> const associated_data = {}) const override;
+        [[nodiscard]] NCEncryptionID nc_encryption_id() const override;
 
         // Constructor:
         NCNonEncryption(std::string const secret_key);
@@ -38,6 +38,21 @@ public:
   NCDecryptionException(const char *msg): std::runtime_error(msg) { }
 };
 
+class NCMessageException: public std::runtime_error {
+public:
+  NCMessageException(const char *msg): std::runtime_error(msg) { }
+};
+
+class NCSerializerException: public std::runtime_error {
+public:
+  NCSerializerException(const char *msg): std::runtime_error(msg) { }
+};
+
+class NCServerException: public std::runtime_error {
+public:
+  NCServerException(const char *msg): std::runtime_error(msg) { }
+};
+
 class NCConfigurationException: public std::runtime_error {
 public:
   NCConfigurationException(const char *msg): std::runtime_error(msg) { }
@@ -0,0 +1,134 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines a phi accrual failure detector.
+*/
+
+// STD includes:
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+// Local includes:
+#include "nc_failure_detector.hpp"
+
+namespace nodcru2 {
+namespace {
+[[nodiscard]] double nc_probability_later(double const deviations) {
+    // Probability that a normal distributed value is larger than mean + deviations * std:
+    return 0.5 * std::erfc(deviations / std::sqrt(2.0));
+}
+}
+
+[[nodiscard]] double nc_phi_to_deviations(double const phi_threshold) {
+    /*
+    Solve nc_probability_later(z) = 10^-phi_threshold for z.
+
+    The probability is monotonically decreasing, so a bisection is enough.
+    This is only called once per expired heartbeat timer.
+    */
+
+    double const probability = std::pow(10.0, -phi_threshold);
+    double lower = -10.0;
+    double upper = 40.0;
+
+    for (uint32_t i = 0; i < 100; i++) {
+        double const middle = 0.5 * (lower + upper);
+
+        if (nc_probability_later(middle) > probability) {
+            lower = middle;
+        } else {
+            upper = middle;
+        }
+    }
+
+    return upper;
+}
+
+NCPhiAccrualDetector::NCPhiAccrualDetector():
+    intervals_intern(),
+    next_index_intern(0),
+    num_samples_intern(0),
+    last_arrival_intern(),
+    detector_mutex()
+    {}
+
+void NCPhiAccrualDetector::nc_heartbeat(std::chrono::steady_clock::time_point const arrival_time) {
+    const std::lock_guard<std::mutex> lock(detector_mutex);
+
+    if (arrival_time <= last_arrival_intern) {
+        return;
+    }
+
+    std::chrono::duration<double> const interval = arrival_time - last_arrival_intern;
+    last_arrival_intern = arrival_time;
+
+    intervals_intern[next_index_intern] = interval.count();
+    next_index_intern = (next_index_intern + 1) % NC_PHI_WINDOW_SIZE;
+    num_samples_intern = std::min(num_samples_intern + 1, NC_PHI_WINDOW_SIZE);
+}
+
+void NCPhiAccrualDetector::nc_reset(std::chrono::steady_clock::time_point const arrival_time) {
+    const std::lock_guard<std::mutex> lock(detector_mutex);
+    next_index_intern = 0;
+    num_samples_intern = 0;
+    last_arrival_intern = arrival_time;
+}
+
+[[nodiscard]] std::pair<double, double> NCPhiAccrualDetector::nc_statistics() const {
+    double sum = 0.0;
+
+    for (size_t i = 0; i < num_samples_intern; i++) {
+        sum += intervals_intern[i];
+    }
+
+    double const mean = sum / static_cast<double>(num_samples_intern);
+    double sum_squares = 0.0;
+
+    for (size_t i = 0; i < num_samples_intern; i++) {
+        double const delta = intervals_intern[i] - mean;
+        sum_squares += delta * delta;
+    }
+
+    double const std_deviation = std::sqrt(sum_squares / static_cast<double>(num_samples_intern));
+
+    return {mean, std::max(std_deviation, mean * NC_PHI_MIN_STD_DEVIATION)};
+}
+
+[[nodiscard]] double NCPhiAccrualDetector::nc_phi(std::chrono::steady_clock::time_point const current_time) const {
+    const std::lock_guard<std::mutex> lock(detector_mutex);
+
+    if ((num_samples_intern < NC_PHI_MIN_SAMPLES) || (current_time <= last_arrival_intern)) {
+        return 0.0;
+    }
+
+    auto const [mean, std_deviation] = nc_statistics();
+    std::chrono::duration<double> const elapsed = current_time - last_arrival_intern;
+    double const probability = nc_probability_later((elapsed.count() - mean) / std_deviation);
+
+    // Avoid infinity if the probability underflows:
+    return -std::log10(std::max(probability, std::numeric_limits<double>::min()));
+}
+
+[[nodiscard]] std::optional<std::chrono::steady_clock::duration> NCPhiAccrualDetector::nc_suspect_after(
+    double const phi_threshold) const {
+    const std::lock_guard<std::mutex> lock(detector_mutex);
+
+    if (num_samples_intern < NC_PHI_MIN_SAMPLES) {
+        return std::nullopt;
+    }
+
+    auto const [mean, std_deviation] = nc_statistics();
+    double const seconds = std::max(0.0, mean + (nc_phi_to_deviations(phi_threshold) * std_deviation));
+
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+[[nodiscard]] size_t NCPhiAccrualDetector::nc_num_samples() const {
+    const std::lock_guard<std::mutex> lock(detector_mutex);
+    return num_samples_intern;
+}
+}
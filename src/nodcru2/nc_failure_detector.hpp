@@ -0,0 +1,77 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines a phi accrual failure detector.
+
+    The detector learns the distribution of the heartbeat inter-arrival times
+    of one node (normal distribution with the mean and the standard deviation
+    of the last intervals). Phi is the suspicion level that the node is dead:
+    phi = -log10(probability that the next heartbeat arrives even later).
+    A phi of 8 means that the node is dead with a probability of 1 - 10^-8.
+*/
+
+#ifndef FILE_NC_FAILURE_DETECTOR_HPP_INCLUDED
+#define FILE_NC_FAILURE_DETECTOR_HPP_INCLUDED
+
+// STD includes:
+#include <cstdint>
+#include <array>
+#include <mutex>
+#include <chrono>
+#include <optional>
+#include <utility>
+
+namespace nodcru2 {
+// Number of inter-arrival times that are kept per node:
+size_t const NC_PHI_WINDOW_SIZE = 100;
+// Below this number of samples the detector has no estimate:
+size_t const NC_PHI_MIN_SAMPLES = 5;
+// Lower bound of the standard deviation relative to the mean,
+// otherwise perfectly regular heartbeats would be suspected immediately:
+double const NC_PHI_MIN_STD_DEVIATION = 0.1;
+
+// Number of standard deviations after the mean where phi reaches the given threshold:
+[[nodiscard]] double nc_phi_to_deviations(double const phi_threshold);
+
+class NCPhiAccrualDetector {
+    public:
+        // Record the arrival of a heartbeat:
+        void nc_heartbeat(std::chrono::steady_clock::time_point const arrival_time);
+        // Forget all samples, the given time is the first arrival:
+        void nc_reset(std::chrono::steady_clock::time_point const arrival_time);
+
+        // Suspicion level at the given time, zero if there are not enough samples:
+        [[nodiscard]] double nc_phi(std::chrono::steady_clock::time_point const current_time) const;
+        // Time after the last heartbeat when phi reaches the threshold,
+        // nothing if there are not enough samples:
+        [[nodiscard]] std::optional<std::chrono::steady_clock::duration> nc_suspect_after(
+            double const phi_threshold) const;
+
+        [[nodiscard]] size_t nc_num_samples() const;
+
+        // Constructor:
+        NCPhiAccrualDetector();
+
+        // Disable all other special member functions:
+        NCPhiAccrualDetector(const NCPhiAccrualDetector&) = delete;
+        NCPhiAccrualDetector& operator=(const NCPhiAccrualDetector&) = delete;
+        NCPhiAccrualDetector(NCPhiAccrualDetector&&) = delete;
+        NCPhiAccrualDetector& operator=(NCPhiAccrualDetector&&) = delete;
+
+    private:
+        // Ring buffer of inter-arrival times in seconds:
+        std::array<double, NC_PHI_WINDOW_SIZE> intervals_intern;
+        size_t next_index_intern;
+        size_t num_samples_intern;
+        std::chrono::steady_clock::time_point last_arrival_intern;
+        mutable std::mutex detector_mutex;
+
+        // Mean and standard deviation, the lock must be held:
+        [[nodiscard]] std::pair<double, double> nc_statistics() const;
+};
+}
+
+#endif // FILE_NC_FAILURE_DETECTOR_HPP_INCLUDED
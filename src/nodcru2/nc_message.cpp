@@ -8,35 +8,208 @@
 */
 
 // STD includes:
+#include <algorithm>
 #include <type_traits>
+#include <span>
+#include <tuple>
 
 // Local includes:
 #include "nc_message.hpp"
+#include "nc_util.hpp"
+#include "nc_exceptions.hpp"
+#include "nc_buffer_pool.hpp"
+#include "nc_serializer.hpp"
 
 namespace nodcru2 {
+namespace {
+[[nodiscard]] std::vector<uint8_t> nc_encode_batch(std::vector<std::vector<uint8_t>> const& items) {
+    // Number of items, then the length and the bytes of each item:
+    size_t capacity = 8;
+
+    for (auto const& item: items) {
+        capacity += 8 + item.size();
+    }
+
+    NCBinaryWriter writer(capacity);
+    writer.nc_write(items);
+    return writer.nc_get_data();
+}
+
+[[nodiscard]] std::vector<std::vector<uint8_t>> nc_decode_batch(std::vector<uint8_t> const& data) {
+    NCBinaryReader reader(data);
+    std::vector<std::span<const uint8_t>> items;
+
+    try {
+        items = reader.nc_read_nested<uint8_t>();
+    } catch (NCSerializerException const&) {
+        throw NCMessageException("Invalid batch.");
+    }
+
+    if (!reader.nc_at_end()) {
+        throw NCMessageException("Invalid batch.");
+    }
+
+    std::vector<std::vector<uint8_t>> result;
+    result.reserve(items.size());
+
+    for (auto const& item: items) {
+        result.emplace_back(item.begin(), item.end());
+    }
+
+    return result;
+}
+}
+
 NCMessageCodecBase::NCMessageCodecBase(std::string const secret_key):
     NCMessageCodecBase(std::make_unique<NCCompressor>(),
     std::make_unique<NCEncryption>(secret_key))
-    {}
+    {
+        // Register all built in codecs, so that the best one can be
+        // negotiated for each node:
+        nc_add_compressor(std::make_unique<NCCompressorHC>());
+        nc_add_compressor(std::make_unique<NCNonCompressor>());
+        nc_add_encryption(std::make_unique<NCEncryption>(secret_key, NCEncryptionID::AES256GCM));
+    }
 
 NCMessageCodecBase::NCMessageCodecBase(std::unique_ptr<NCCompressor> nc_compressor,
     std::unique_ptr<NCEncryption> nc_encryption):
-    compressor_intern(std::move(nc_compressor)),
-    encryption_intern(std::move(nc_encryption)) {}
+    compressors_intern(),
+    encryptions_intern(),
+    codec_intern(nc_codec_to_byte(NCCodecID{nc_compressor->nc_compressor_id(), nc_encryption->nc_encryption_id()}))
+    {
+        nc_add_compressor(std::move(nc_compressor));
+        nc_add_encryption(std::move(nc_encryption));
+    }
+
+void NCMessageCodecBase::nc_add_compressor(std::unique_ptr<NCCompressor> compressor) {
+    /*
+    Register an additional compressor.
+
+    The compressor is selected by its id in the message header.
+    */
+
+    uint8_t const id = static_cast<uint8_t>(compressor->nc_compressor_id());
+    if (id >= static_cast<uint8_t>(NCCompressorID::Default)) {
+        throw NCMessageException("Invalid compressor id.");
+    }
+    compressors_intern[id] = std::move(compressor);
+}
+
+void NCMessageCodecBase::nc_add_encryption(std::unique_ptr<NCEncryption> encryption) {
+    /*
+    Register an additional encryption.
+
+    The encryption is selected by its id in the message header.
+    */
+
+    uint8_t const id = static_cast<uint8_t>(encryption->nc_encryption_id());
+    if (id >= static_cast<uint8_t>(NCEncryptionID::Default)) {
+        throw NCMessageException("Invalid encryption id.");
+    }
+    encryptions_intern[id] = std::move(encryption);
+}
+
+void NCMessageCodecBase::nc_set_codec(NCCodecID const codec) {
+    /*
+    Set the codec that is used when NC_DEFAULT_CODEC is given.
+
+    The node calls this with the codec negotiated in the Init / InitOK handshake.
+    */
+
+    NCCodecID const resolved = nc_resolve_codec(codec);
+    // Throws if the codec is not registered:
+    std::ignore = nc_get_compressor(resolved.compressor);
+    std::ignore = nc_get_encryption(resolved.encryption);
+    codec_intern.store(nc_codec_to_byte(resolved));
+}
+
+[[nodiscard]] NCCodecID NCMessageCodecBase::nc_get_codec() const {
+    return nc_codec_from_byte(codec_intern.load());
+}
+
+[[nodiscard]] NCCapabilities NCMessageCodecBase::nc_get_capabilities() const {
+    /*
+    Return the capabilities of this codec: all registered compressors
+    and encryptions, the current codec is the preferred one.
+    */
+
+    NCCapabilities result;
+    result.compressors = 0;
+    result.encryptions = 0;
+
+    for (uint8_t id = 0; id < NC_MAX_CODEC_ID; id++) {
+        if (compressors_intern[id]) {
+            result.compressors |= nc_compressor_mask(static_cast<NCCompressorID>(id));
+        }
+        if (encryptions_intern[id]) {
+            result.encryptions |= nc_encryption_mask(static_cast<NCEncryptionID>(id));
+        }
+    }
+
+    NCCodecID const codec = nc_get_codec();
+    result.preferred_compressor = codec.compressor;
+    result.preferred_encryption = codec.encryption;
+
+    return result;
+}
+
+[[nodiscard]] NCCodecID NCMessageCodecBase::nc_resolve_codec(NCCodecID const codec) const {
+    NCCodecID result = codec;
+    NCCodecID const current = nc_get_codec();
+
+    if (result.compressor == NCCompressorID::Default) {
+        result.compressor = current.compressor;
+    }
+
+    if (result.encryption == NCEncryptionID::Default) {
+        result.encryption = current.encryption;
+    }
+
+    return result;
+}
 
-[[nodiscard]] std::vector<uint8_t> NCMessageCodecBase::nc_encode(NCDecompressedMessage decompressed_message) const {
+[[nodiscard]] NCCompressor const& NCMessageCodecBase::nc_get_compressor(NCCompressorID const id) const {
+    uint8_t const index = static_cast<uint8_t>(id);
+    if ((index >= NC_MAX_CODEC_ID) || !compressors_intern[index]) {
+        throw NCMessageException("Unsupported compressor.");
+    }
+    return *compressors_intern[index];
+}
+
+[[nodiscard]] NCEncryption const& NCMessageCodecBase::nc_get_encryption(NCEncryptionID const id) const {
+    uint8_t const index = static_cast<uint8_t>(id);
+    if ((index >= NC_MAX_CODEC_ID) || !encryptions_intern[index]) {
+        throw NCMessageException("Unsupported encryption.");
+    }
+    return *encryptions_intern[index];
+}
+
+[[nodiscard]] std::vector<uint8_t> NCMessageCodecBase::nc_encode(std::vector<uint8_t> header,
+    NCDecompressedMessage const& decompressed_message, NCCodecID const codec) const {
+        // Select the codec, stored in the second byte of the header:
+        NCCodecID const resolved = nc_resolve_codec(codec);
+        NCCompressor const& compressor = nc_get_compressor(resolved.compressor);
+        NCEncryption const& encryption = nc_get_encryption(resolved.encryption);
+        header[1] = nc_codec_to_byte(resolved);
         // 2. Compress message:
-        NCCompressedMessage compressed_message = compressor_intern->nc_compress_message(decompressed_message);
-        // 3. Encrypt compressed message:
-        NCEncryptedMessage encrypted_message = encryption_intern->nc_encrypt_message(NCDecryptedMessage{compressed_message.data});
-        // 4. Encode encrypted compressed message:
-        std::vector<uint8_t> result;
-        uint32_t const result_size = NC_NONCE_LENGTH + NC_GCM_TAG_LENGTH + static_cast<uint32_t>(encrypted_message.data.size());
-        result = std::vector<uint8_t>(result_size);
-        auto const r_begin1 = result.begin();
+        NCCompressedMessage compressed_message = compressor.nc_compress_message(decompressed_message);
+        // 3. Set the payload length, stored in the last four bytes of the header.
+        // The stream cipher does not change the length of the compressed message:
+        uint32_t const payload_size = static_cast<uint32_t>(compressed_message.data.size());
+        nc_to_big_endian_bytes(payload_size, std::span(header).last(4));
+        // 4. Encrypt compressed message, the header is authenticated as associated data:
+        NCDecryptedMessage plain_message{std::move(compressed_message.data)};
+        NCEncryptedMessage encrypted_message = encryption.nc_encrypt_message(plain_message, header);
+        // 5. Encode header and encrypted compressed message:
+        uint32_t const result_size = static_cast<uint32_t>(header.size()) + NC_NONCE_LENGTH + NC_GCM_TAG_LENGTH +
+            static_cast<uint32_t>(encrypted_message.data.size());
+        std::vector<uint8_t> result = nc_acquire_buffer(result_size);
+        auto const r_begin1 = result.begin() + static_cast<std::ptrdiff_t>(header.size());
         auto const r_begin2 = r_begin1 + NC_NONCE_LENGTH;
         auto const r_begin3 = r_begin2 + NC_GCM_TAG_LENGTH;
 
+        // Encode header:
+        std::copy(header.cbegin(), header.cend(), result.begin());
         // Encode nonce:
         std::copy(encrypted_message.nonce.cbegin(), encrypted_message.nonce.cend(), r_begin1);
         // Encode tag:
@@ -44,13 +217,40 @@ NCMessageCodecBase::NCMessageCodecBase(std::unique_ptr<NCCompressor> nc_compress
         // Encode rest of message, if any:
         std::copy(encrypted_message.data.cbegin(), encrypted_message.data.cend(), r_begin3);
 
+        // Give the intermediate buffers back to the pool:
+        nc_release_buffer(std::move(plain_message.data));
+        nc_release_buffer(std::move(encrypted_message.data));
+
         return result;
 }
 
-[[nodiscard]] NCDecompressedMessage NCMessageCodecBase::nc_decode(std::vector<uint8_t> const& message) const {
-    // 1. Decrypt message:
+[[nodiscard]] uint32_t NCMessageCodecBase::nc_decode_payload_length(std::vector<uint8_t> const& message,
+    size_t const header_length) const {
+    /*
+    Check the size of the message and return the payload length from the header.
+
+    This does not decrypt anything, so the header is not authenticated yet.
+    */
+
+    if (message.size() < header_length + NC_NONCE_LENGTH + NC_GCM_TAG_LENGTH) {
+        throw NCMessageException("Message too short.");
+    }
+
+    uint32_t const payload_length = nc_from_big_endian_bytes(std::span(message).subspan(header_length - 4, 4));
+
+    if (message.size() != header_length + NC_NONCE_LENGTH + NC_GCM_TAG_LENGTH + payload_length) {
+        throw NCMessageException("Payload length does not match message size.");
+    }
+
+    return payload_length;
+}
+
+[[nodiscard]] NCDecompressedMessage NCMessageCodecBase::nc_decode(std::vector<uint8_t> const& message,
+    size_t const header_length) const {
+    // 1. Decode message:
+    uint32_t const payload_length = nc_decode_payload_length(message, header_length);
     NCEncryptedMessage encrypted_message;
-    auto const m_begin1 = message.cbegin();
+    auto const m_begin1 = message.cbegin() + static_cast<std::ptrdiff_t>(header_length);
     auto const m_begin2 = m_begin1 + NC_NONCE_LENGTH;
     auto const m_begin3 = m_begin2 + NC_GCM_TAG_LENGTH;
 
@@ -59,12 +259,22 @@ NCMessageCodecBase::NCMessageCodecBase(std::unique_ptr<NCCompressor> nc_compress
     // Decode tag:
     std::copy(m_begin2, m_begin3, encrypted_message.tag.begin());
     // Decode the rest of the data, if any:
-    encrypted_message.data = std::vector<uint8_t>(m_begin3, message.cend());
-
-    // 2. Decrypt message:
-    NCDecryptedMessage decrypted_message = encryption_intern->nc_decrypt_message(encrypted_message);
+    encrypted_message.data = nc_acquire_buffer(payload_length);
+    std::copy(m_begin3, message.cend(), encrypted_message.data.begin());
+
+    // The codec is stored in the second byte of the header:
+    NCCodecID const codec = nc_codec_from_byte(message[1]);
+    NCCompressor const& compressor = nc_get_compressor(codec.compressor);
+    NCEncryption const& encryption = nc_get_encryption(codec.encryption);
+
+    // 2. Decrypt message, this also verifies the header:
+    NCDecryptedMessage decrypted_message = encryption.nc_decrypt_message(encrypted_message,
+        std::span(message).first(header_length));
+    nc_release_buffer(std::move(encrypted_message.data));
     // 3. Decompress decrpted message:
-    NCDecompressedMessage decompressed_message = compressor_intern->nc_decompress_message(NCCompressedMessage{decrypted_message.data});
+    NCCompressedMessage compressed_message{std::move(decrypted_message.data)};
+    NCDecompressedMessage decompressed_message = compressor.nc_decompress_message(compressed_message);
+    nc_release_buffer(std::move(compressed_message.data));
 
     return decompressed_message;
 }
@@ -79,71 +289,129 @@ NCMessageCodecNode::NCMessageCodecNode(std::unique_ptr<NCCompressor> nc_compress
     {}
 
 [[nodiscard]] NCEncodedMessageToServer NCMessageCodecNode::nc_encode_message_to_server(
-    NCNodeMessageType const msg_type, std::vector<uint8_t> const& data, NCNodeID const node_id) const {
-    // 1. Encode message:
-    NCDecompressedMessage decompressed_message;
-
-    uint32_t const dc_size = static_cast<uint32_t>(1 + NC_NODEID_LENGTH + data.size());
-    decompressed_message.data = std::vector<uint8_t>(dc_size);
+    NCNodeMessageType const msg_type, std::vector<uint8_t> const& data, NCNodeSlot const node_slot) const {
+    // 1. Encode header:
+    std::vector<uint8_t> header(NC_HEADER_TO_SERVER_LENGTH);
 
     // Encode message type (1 byte)
-    decompressed_message.data[0] = static_cast<uint8_t>(msg_type);
-    auto dm_begin = decompressed_message.data.begin() + 1;
+    header[0] = static_cast<uint8_t>(msg_type);
 
-    // Node id has to be encoded here:
-    std::copy(node_id.id.cbegin(), node_id.id.cend(), dm_begin);
-    dm_begin += NC_NODEID_LENGTH;
+    // Node slot has to be encoded here:
+    nc_encode_node_slot(node_slot, std::span(header).subspan(2, NC_NODE_SLOT_LENGTH));
 
-    // Encode the actual data, if there is any:
-    std::copy(data.cbegin(), data.cend(), dm_begin);
+    // The codec and the payload length are set in nc_encode().
 
-    // Steps 2 to 4:
-    std::vector<uint8_t> encoded = nc_encode(decompressed_message);
+    // Steps 2 to 5:
+    std::vector<uint8_t> encoded = nc_encode(std::move(header), NCDecompressedMessage{data}, NC_DEFAULT_CODEC);
     return NCEncodedMessageToServer{encoded};
 }
 
-[[nodiscard]] NCDecodedMessageFromServer NCMessageCodecNode::nc_decode_message_from_server(
+[[nodiscard]] NCMessageHeaderFromServer NCMessageCodecNode::nc_decode_header_from_server(
     NCEncodedMessageToNode const& message) const {
-    // Steps 1 to 3:
-    NCDecompressedMessage decompressed_message = nc_decode(message.data);
+    /*
+    Decode only the clear text header of a message from the server.
 
-    // 4. Decode message:
-    NCDecodedMessageFromServer result;
+    The header is not authenticated until the payload has been decoded.
+    */
+
+    NCMessageHeaderFromServer result;
+    result.payload_length = nc_decode_payload_length(message.data, NC_HEADER_TO_NODE_LENGTH);
     // Decode message type:
-    result.msg_type = static_cast<NCServerMessageType>(decompressed_message.data[0]);
-    auto m_begin = decompressed_message.data.cbegin() + 1;
+    result.msg_type = static_cast<NCServerMessageType>(message.data[0]);
+    // Decode codec:
+    result.codec = nc_codec_from_byte(message.data[1]);
+
+    return result;
+}
+
+[[nodiscard]] std::vector<uint8_t> NCMessageCodecNode::nc_decode_payload_from_server(
+    NCEncodedMessageToNode const& message) const {
+    // Steps 1 to 3:
+    return nc_decode(message.data, NC_HEADER_TO_NODE_LENGTH).data;
+}
+
+[[nodiscard]] NCInitResponse NCMessageCodecNode::nc_decode_init_response(std::vector<uint8_t> data) const {
+    /*
+    Decode the payload of the InitOK message: the negotiated capabilities,
+    the node slot assigned by the server and the init data.
+    */
+
+    NCInitResponse result;
+    result.negotiated = nc_decode_negotiated(data);
+    result.node_slot = nc_decode_node_slot(std::span(data).subspan(NC_NEGOTIATED_LENGTH));
+
+    data.erase(data.cbegin(), data.cbegin() + NC_NEGOTIATED_LENGTH + NC_NODE_SLOT_LENGTH);
+    result.init_data = std::move(data);
+
+    return result;
+}
+
+[[nodiscard]] std::vector<std::vector<uint8_t>> NCMessageCodecNode::nc_decode_data_batch(std::vector<uint8_t> const& data) const {
+    /*
+    Decode the payload of the NewDataBatchFromServer message: a list of tasks.
+    */
+
+    return nc_decode_batch(data);
+}
+
+[[nodiscard]] uint64_t NCMessageCodecNode::nc_decode_cancel(std::vector<uint8_t> const& data) const {
+    /*
+    Decode the payload of the Cancel message: the number of tasks that the server
+    had handed out to the node in this registration when the tasks were cancelled.
+    */
 
-    // Decode the actual data, if any:
-    result.data = std::vector<uint8_t>(m_begin, decompressed_message.data.cend());
+    if (data.size() != 8) {
+        throw NCMessageException("Invalid cancel message.");
+    }
+
+    return nc_from_big_endian_bytes64(data);
+}
+
+[[nodiscard]] NCDecodedMessageFromServer NCMessageCodecNode::nc_decode_message_from_server(
+    NCEncodedMessageToNode const& message) const {
+    NCMessageHeaderFromServer const header = nc_decode_header_from_server(message);
+
+    NCDecodedMessageFromServer result;
+    result.msg_type = header.msg_type;
+    result.data = nc_decode_payload_from_server(message);
 
     return result;
 }
 
-[[nodiscard]] NCEncodedMessageToServer NCMessageCodecNode::nc_gen_heartbeat_message(NCNodeID const node_id) const {
+[[nodiscard]] NCEncodedMessageToServer NCMessageCodecNode::nc_gen_heartbeat_message(NCNodeSlot const node_slot) const {
     /*
     Generate a heartbeat message to be sent from the node to the server.
 
-    The node sends its node_id that the server will check.
+    The node sends its node slot that the server will check.
     The secret key is used to encode the message.
     */
 
-    return nc_encode_message_to_server(NCNodeMessageType::Heartbeat, {}, node_id);
+    return nc_encode_message_to_server(NCNodeMessageType::Heartbeat, {}, node_slot);
 }
 
-[[nodiscard]] NCEncodedMessageToServer NCMessageCodecNode::nc_gen_init_message(NCNodeID const node_id) const {
+[[nodiscard]] NCEncodedMessageToServer NCMessageCodecNode::nc_gen_init_message(NCNodeID const node_id,
+    NCCapabilities const& capabilities, NCNodeInfo const& node_info) const {
     /*
     Generate an initialisation message to be sent from the node to the server.
 
     This message is only sent once when the node connects for the first time to the server.
-    The node registers itself to the server given its own node id.
+    The node registers itself to the server given its own node id, which is sent
+    after the capabilities, so that the server can choose the best codec.
+    The hardware of the node comes last.
+    The node has no slot yet.
     The secret key is used to encode the message.
     */
 
-    return nc_encode_message_to_server(NCNodeMessageType::Init, {}, node_id);
+    std::vector<uint8_t> data = nc_encode_capabilities(capabilities);
+    data.insert(data.end(), node_id.id.cbegin(), node_id.id.cend());
+    std::vector<uint8_t> const info = nc_encode_node_info(node_info);
+    data.insert(data.end(), info.cbegin(), info.cend());
+
+    return nc_encode_message_to_server(NCNodeMessageType::Init, data, NCNodeSlot());
 }
 
 [[nodiscard]] NCEncodedMessageToServer NCMessageCodecNode::nc_gen_result_message(
-    std::vector<uint8_t> const& new_data, NCNodeID const node_id) const {
+    std::vector<uint8_t> const& new_data, NCNodeSlot const node_slot) const {
     /*
     Generate a result message to be sent from the node to the server.
 
@@ -152,19 +420,72 @@ NCMessageCodecNode::NCMessageCodecNode(std::unique_ptr<NCCompressor> nc_compress
     The secret key is used to encode the message.
     */
 
-    return nc_encode_message_to_server(NCNodeMessageType::NewResultFromNode, new_data, node_id);
+    return nc_encode_message_to_server(NCNodeMessageType::NewResultFromNode, new_data, node_slot);
 }
 
-[[nodiscard]] NCEncodedMessageToServer NCMessageCodecNode::nc_gen_need_more_data_message(NCNodeID const node_id) const {
+[[nodiscard]] NCEncodedMessageToServer NCMessageCodecNode::nc_gen_need_more_data_message(NCNodeSlot const node_slot,
+    uint32_t const max_tasks) const {
     /*
     Generate a "need more data" message to be sent from the node to the server.
 
     This message is only sent when the node has finished processing the data and needs
     more data to be processed from the server.
+    If the node asks for more than one task, the maximum number of tasks is the payload.
+    The secret key is used to encode the message.
+    */
+
+    if (max_tasks <= 1) {
+        return nc_encode_message_to_server(NCNodeMessageType::NodeNeedsMoreData, {}, node_slot);
+    }
+
+    std::vector<uint8_t> data(4);
+    nc_to_big_endian_bytes(max_tasks, data);
+
+    return nc_encode_message_to_server(NCNodeMessageType::NodeNeedsMoreData, data, node_slot);
+}
+
+[[nodiscard]] NCEncodedMessageToServer NCMessageCodecNode::nc_gen_result_need_more_data_message(
+    std::vector<uint8_t> const& new_data, NCNodeSlot const node_slot) const {
+    /*
+    Generate a "result and need more data" message to be sent from the node to the server.
+
+    This combines the result message and the "need more data" message, the server
+    answers with the next data right away. This saves one round trip for each task.
+    It is only sent if the server supports it (NC_FEATURE_RESULT_WITH_NEW_DATA).
+    The secret key is used to encode the message.
+    */
+
+    return nc_encode_message_to_server(NCNodeMessageType::ResultNeedsMoreData, new_data, node_slot);
+}
+
+[[nodiscard]] NCEncodedMessageToServer NCMessageCodecNode::nc_gen_result_batch_message(
+    std::vector<std::vector<uint8_t>> const& results, NCNodeSlot const node_slot) const {
+    /*
+    Generate a "result batch" message to be sent from the node to the server.
+
+    This contains the results of several tasks, in the order the tasks were processed.
+    It is only sent if the server supports it (NC_FEATURE_RESULT_BATCH).
+    The secret key is used to encode the message.
+    */
+
+    return nc_encode_message_to_server(NCNodeMessageType::NewResultBatchFromNode, nc_encode_batch(results), node_slot);
+}
+
+[[nodiscard]] NCEncodedMessageToServer NCMessageCodecNode::nc_gen_tasks_cancelled_message(
+    uint32_t const num_tasks, NCNodeSlot const node_slot) const {
+    /*
+    Generate a "tasks cancelled" message to be sent from the node to the server.
+
+    The node has received a Cancel message and has dropped its oldest num_tasks
+    tasks without a result. It takes the place of these results, so the server
+    still sees the tasks of the node in the order they were handed out.
     The secret key is used to encode the message.
     */
 
-    return nc_encode_message_to_server(NCNodeMessageType::NodeNeedsMoreData, {}, node_id);
+    std::vector<uint8_t> data(4);
+    nc_to_big_endian_bytes(num_tasks, data);
+
+    return nc_encode_message_to_server(NCNodeMessageType::TasksCancelled, data, node_slot);
 }
 
 NCMessageCodecServer::NCMessageCodecServer(std::string const secret_key):
@@ -176,47 +497,123 @@ NCMessageCodecServer::NCMessageCodecServer(std::unique_ptr<NCCompressor> nc_comp
     {}
 
 [[nodiscard]] NCEncodedMessageToNode NCMessageCodecServer::nc_encode_message_to_node(
-    NCServerMessageType const msg_type, std::vector<uint8_t> const& data) const {
-    // 1. Encode message:
-    NCDecompressedMessage decompressed_message;
-
-    uint32_t const dc_size = static_cast<uint32_t>(1 + data.size());
-    decompressed_message.data = std::vector<uint8_t>(dc_size);
+    NCServerMessageType const msg_type, std::vector<uint8_t> const& data, NCCodecID const codec) const {
+    // 1. Encode header:
+    std::vector<uint8_t> header(NC_HEADER_TO_NODE_LENGTH);
 
     // Encode message type (1 byte)
-    decompressed_message.data[0] = static_cast<uint8_t>(msg_type);
-    auto dm_begin = decompressed_message.data.begin() + 1;
+    header[0] = static_cast<uint8_t>(msg_type);
 
-    // Encode the actual data, if there is any:
-    std::copy(data.cbegin(), data.cend(), dm_begin);
+    // The codec and the payload length are set in nc_encode().
 
-    // Steps 2 to 4:
-    std::vector<uint8_t> encoded = nc_encode(decompressed_message);
+    // Steps 2 to 5:
+    std::vector<uint8_t> encoded = nc_encode(std::move(header), NCDecompressedMessage{data}, codec);
     return NCEncodedMessageToNode{encoded};
 }
 
-[[nodiscard]] NCDecodedMessageFromNode NCMessageCodecServer::nc_decode_message_from_node(
+[[nodiscard]] NCMessageHeaderFromNode NCMessageCodecServer::nc_decode_header_from_node(
     NCEncodedMessageToServer const& message) const {
-    // Steps 1 to 3:
-    NCDecompressedMessage decompressed_message = nc_decode(message.data);
+    /*
+    Decode only the clear text header of a message from a node.
 
-    // 4. Decode message:
-    NCDecodedMessageFromNode result;
+    This is cheap and allows the server to route or reject a message before
+    the payload is decrypted and decompressed.
+    The header is not authenticated until the payload has been decoded.
+    */
+
+    NCMessageHeaderFromNode result;
+    result.payload_length = nc_decode_payload_length(message.data, NC_HEADER_TO_SERVER_LENGTH);
     // Decode message type:
-    result.msg_type = static_cast<NCNodeMessageType>(decompressed_message.data[0]);
-    auto m_begin = decompressed_message.data.cbegin() + 1;
+    result.msg_type = static_cast<NCNodeMessageType>(message.data[0]);
+    // Decode codec:
+    result.codec = nc_codec_from_byte(message.data[1]);
+    // Decode node slot:
+    result.node_slot = nc_decode_node_slot(std::span(message.data).subspan(2, NC_NODE_SLOT_LENGTH));
+
+    return result;
+}
+
+[[nodiscard]] std::vector<uint8_t> NCMessageCodecServer::nc_decode_payload_from_node(
+    NCEncodedMessageToServer const& message) const {
+    // Steps 1 to 3:
+    return nc_decode(message.data, NC_HEADER_TO_SERVER_LENGTH).data;
+}
 
-    // Decode node id:
+[[nodiscard]] NCInitRequest NCMessageCodecServer::nc_decode_init_request(std::vector<uint8_t> const& data) const {
+    /*
+    Decode the payload of the Init message: the capabilities of the node
+    followed by its node id and its hardware.
+    The hardware is optional, older nodes don't send it.
+    */
+
+    size_t const base_length = NC_CAPABILITIES_LENGTH + NC_NODEID_LENGTH;
+
+    if ((data.size() != base_length) && (data.size() != base_length + NC_NODE_INFO_LENGTH)) {
+        throw NCMessageException("Invalid init message.");
+    }
+
+    NCInitRequest result;
+    result.capabilities = nc_decode_capabilities(data);
+    auto const m_begin = data.cbegin() + NC_CAPABILITIES_LENGTH;
     std::copy(m_begin, m_begin + NC_NODEID_LENGTH, result.node_id.id.begin());
-    m_begin += NC_NODEID_LENGTH;
 
-    // Decode the actual data, if any:
-    result.data = std::vector<uint8_t>(m_begin, decompressed_message.data.cend());
+    if (data.size() > base_length) {
+        result.node_info = nc_decode_node_info(std::span(data).subspan(base_length));
+    }
 
     return result;
 }
 
-[[nodiscard]] NCEncodedMessageToNode NCMessageCodecServer::nc_gen_heartbeat_message_ok() const {
+[[nodiscard]] uint32_t NCMessageCodecServer::nc_decode_need_more_data_request(std::vector<uint8_t> const& data) const {
+    /*
+    Decode the payload of the NodeNeedsMoreData message: the maximum number
+    of tasks, an empty payload means one task.
+    */
+
+    if (data.empty()) {
+        return 1;
+    }
+
+    if (data.size() != 4) {
+        throw NCMessageException("Invalid need more data message.");
+    }
+
+    return std::max(nc_from_big_endian_bytes(data), uint32_t(1));
+}
+
+[[nodiscard]] std::vector<std::vector<uint8_t>> NCMessageCodecServer::nc_decode_result_batch(std::vector<uint8_t> const& data) const {
+    /*
+    Decode the payload of the NewResultBatchFromNode message: a list of results.
+    */
+
+    return nc_decode_batch(data);
+}
+
+[[nodiscard]] uint32_t NCMessageCodecServer::nc_decode_tasks_cancelled(std::vector<uint8_t> const& data) const {
+    /*
+    Decode the payload of the TasksCancelled message: the number of dropped tasks.
+    */
+
+    if (data.size() != 4) {
+        throw NCMessageException("Invalid tasks cancelled message.");
+    }
+
+    return nc_from_big_endian_bytes(data);
+}
+
+[[nodiscard]] NCDecodedMessageFromNode NCMessageCodecServer::nc_decode_message_from_node(
+    NCEncodedMessageToServer const& message) const {
+    NCMessageHeaderFromNode const header = nc_decode_header_from_node(message);
+
+    NCDecodedMessageFromNode result;
+    result.msg_type = header.msg_type;
+    result.node_slot = header.node_slot;
+    result.data = nc_decode_payload_from_node(message);
+
+    return result;
+}
+
+[[nodiscard]] NCEncodedMessageToNode NCMessageCodecServer::nc_gen_heartbeat_message_ok(NCCodecID const codec) const {
         /*
     Generate a "heartbeat OK" message to be sent from the server to the node.
 
@@ -225,24 +622,31 @@ NCMessageCodecServer::NCMessageCodecServer(std::unique_ptr<NCCompressor> nc_comp
     The secret key is used to encode the message.
     */
 
-    return nc_encode_message_to_node(NCServerMessageType::HeartbeatOK, {});
+    return nc_encode_message_to_node(NCServerMessageType::HeartbeatOK, {}, codec);
 }
 
 [[nodiscard]] NCEncodedMessageToNode NCMessageCodecServer::nc_gen_init_message_ok(
-    std::vector<uint8_t> const& init_data) const {
+    NCNegotiatedCapabilities const& negotiated, NCNodeSlot const node_slot, std::vector<uint8_t> const& init_data,
+    NCCodecID const codec) const {
     /*
     Generate an "init ok" message to be sent from the server to the node.
 
     This message is only sent once when the node has registered itself correctly to the server.
-    The server then can send some initial data to the node, if needed.
+    It contains the negotiated capabilities and the node slot assigned by the server,
+    followed by some initial data, if needed.
     The secret key is used to encode the message.
     */
 
-    return nc_encode_message_to_node(NCServerMessageType::InitOK, init_data);
+    std::vector<uint8_t> data = nc_encode_negotiated(negotiated);
+    data.resize(NC_NEGOTIATED_LENGTH + NC_NODE_SLOT_LENGTH);
+    nc_encode_node_slot(node_slot, std::span(data).subspan(NC_NEGOTIATED_LENGTH));
+    data.insert(data.end(), init_data.cbegin(), init_data.cend());
+
+    return nc_encode_message_to_node(NCServerMessageType::InitOK, data, codec);
 }
 
 [[nodiscard]] NCEncodedMessageToNode NCMessageCodecServer::nc_gen_new_data_message(
-    std::vector<uint8_t> const& new_data) const {
+    std::vector<uint8_t> const& new_data, NCCodecID const codec) const {
     /*
     Generate a "new data" message to be sent from the server to the node.
 
@@ -250,10 +654,23 @@ NCMessageCodecServer::NCMessageCodecServer(std::unique_ptr<NCCompressor> nc_comp
     The secret key is used to encode the message.
     */
 
-    return nc_encode_message_to_node(NCServerMessageType::NewDataFromServer, new_data);
+    return nc_encode_message_to_node(NCServerMessageType::NewDataFromServer, new_data, codec);
+}
+
+[[nodiscard]] NCEncodedMessageToNode NCMessageCodecServer::nc_gen_new_data_batch_message(
+    std::vector<std::vector<uint8_t>> const& new_data, NCCodecID const codec) const {
+    /*
+    Generate a "new data batch" message to be sent from the server to the node.
+
+    This message is sent when the node has asked for more than one task.
+    It contains the list of tasks, which can be empty if no task is available at the moment.
+    The secret key is used to encode the message.
+    */
+
+    return nc_encode_message_to_node(NCServerMessageType::NewDataBatchFromServer, nc_encode_batch(new_data), codec);
 }
 
-[[nodiscard]] NCEncodedMessageToNode NCMessageCodecServer::nc_gen_result_ok_message() const {
+[[nodiscard]] NCEncodedMessageToNode NCMessageCodecServer::nc_gen_result_ok_message(NCCodecID const codec) const {
     /*
     Generate a "result ok" message to be sent from the server to the node.
 
@@ -262,10 +679,10 @@ NCMessageCodecServer::NCMessageCodecServer(std::unique_ptr<NCCompressor> nc_comp
     The secret key is used to encode the message.
     */
 
-    return nc_encode_message_to_node(NCServerMessageType::ResultOK, {});
+    return nc_encode_message_to_node(NCServerMessageType::ResultOK, {}, codec);
 }
 
-[[nodiscard]] NCEncodedMessageToNode NCMessageCodecServer::nc_gen_quit_message() const {
+[[nodiscard]] NCEncodedMessageToNode NCMessageCodecServer::nc_gen_quit_message(NCCodecID const codec) const {
     /*
     Generate a quit message to be sent from the server to the node.
 
@@ -276,10 +693,29 @@ NCMessageCodecServer::NCMessageCodecServer(std::unique_ptr<NCCompressor> nc_comp
     the quit message yet.
     */
 
-    return nc_encode_message_to_node(NCServerMessageType::Quit, {});
+    return nc_encode_message_to_node(NCServerMessageType::Quit, {}, codec);
+}
+
+[[nodiscard]] NCEncodedMessageToNode NCMessageCodecServer::nc_gen_cancel_message(uint64_t const num_tasks,
+    NCCodecID const codec) const {
+    /*
+    Generate a cancel message to be sent from the server to the node.
+
+    This message is sent as the answer to the next message of the node, when
+    the data processor doesn't need the results of the node anymore (nc_cancel_node_tasks()).
+    It takes the place of the usual answer, the message of the node has been handled.
+    The node stops its first num_tasks tasks of the current registration, if they
+    are not done yet, and reports them with a TasksCancelled message.
+    Tasks handed out later are not affected.
+    */
+
+    std::vector<uint8_t> data(8);
+    nc_to_big_endian_bytes64(num_tasks, data);
+
+    return nc_encode_message_to_node(NCServerMessageType::Cancel, data, codec);
 }
 
-[[nodiscard]] NCEncodedMessageToNode NCMessageCodecServer::nc_gen_invalid_node_id_error() const {
+[[nodiscard]] NCEncodedMessageToNode NCMessageCodecServer::nc_gen_invalid_node_id_error(NCCodecID const codec) const {
     /*
     Generate an invalid node id message to be sent from the server to the node.
 
@@ -287,17 +723,17 @@ NCMessageCodecServer::NCMessageCodecServer(std::unique_ptr<NCCompressor> nc_comp
     That is when the node hasn't registered first to the server.
     */
 
-    return nc_encode_message_to_node(NCServerMessageType::InvalidNodeID, {});
+    return nc_encode_message_to_node(NCServerMessageType::InvalidNodeID, {}, codec);
 }
 
-[[nodiscard]] NCEncodedMessageToNode NCMessageCodecServer::nc_gen_unknown_error() const {
+[[nodiscard]] NCEncodedMessageToNode NCMessageCodecServer::nc_gen_unknown_error(NCCodecID const codec) const {
     /*
     Generate an unknown error message to be sent from the server to the node.
 
     This message is only sent when the node sends an invalid / unknown message.
     */
 
-    return nc_encode_message_to_node(NCServerMessageType::UnknownError, {});
+    return nc_encode_message_to_node(NCServerMessageType::UnknownError, {}, codec);
 }
 
 }
@@ -17,18 +17,47 @@
 #include <string_view>
 #include <expected>
 #include <memory>
+#include <array>
+#include <atomic>
 
 // Local includes:
 #include "nc_message_types.hpp"
 #include "nc_nodeid.hpp"
 #include "nc_compression.hpp"
 #include "nc_encryption.hpp"
+#include "nc_capability.hpp"
 
 namespace nodcru2 {
+// The payload of the Init message:
+struct NCInitRequest {
+    NCCapabilities capabilities = NCCapabilities();
+    NCNodeID node_id = NCNodeID();
+    NCNodeInfo node_info = NCNodeInfo();
+};
+
+// The payload of the InitOK message:
+struct NCInitResponse {
+    NCNegotiatedCapabilities negotiated = NCNegotiatedCapabilities();
+    NCNodeSlot node_slot = NCNodeSlot();
+    std::vector<uint8_t> init_data = {};
+};
+
 class NCMessageCodecBase {
     public:
-        [[nodiscard]] virtual std::vector<uint8_t> nc_encode(NCDecompressedMessage decompressed_message) const;
-        [[nodiscard]] virtual NCDecompressedMessage nc_decode(std::vector<uint8_t> const& message) const;
+        [[nodiscard]] virtual std::vector<uint8_t> nc_encode(std::vector<uint8_t> header,
+            NCDecompressedMessage const& decompressed_message, NCCodecID const codec) const;
+        [[nodiscard]] virtual NCDecompressedMessage nc_decode(std::vector<uint8_t> const& message,
+            size_t const header_length) const;
+        [[nodiscard]] uint32_t nc_decode_payload_length(std::vector<uint8_t> const& message,
+            size_t const header_length) const;
+
+        // Must be called before the codec is used:
+        void nc_add_compressor(std::unique_ptr<NCCompressor> compressor);
+        void nc_add_encryption(std::unique_ptr<NCEncryption> encryption);
+
+        void nc_set_codec(NCCodecID const codec);
+        [[nodiscard]] NCCodecID nc_get_codec() const;
+        [[nodiscard]] NCCapabilities nc_get_capabilities() const;
 
         // Constructor:
         NCMessageCodecBase(std::string const secret_key);
@@ -38,31 +67,55 @@ class NCMessageCodecBase {
         // Desctructor:
         virtual ~NCMessageCodecBase() = default;
 
-        // Default special member functions:
-        NCMessageCodecBase(const NCMessageCodecBase&) = delete;
-        NCMessageCodecBase& operator=(const NCMessageCodecBase&) = default;
-        NCMessageCodecBase(NCMessageCodecBase&&) = default;
-
         // Disable all other special member functions:
+        NCMessageCodecBase(const NCMessageCodecBase&) = delete;
+        NCMessageCodecBase& operator=(const NCMessageCodecBase&) = delete;
+        NCMessageCodecBase(NCMessageCodecBase&&) = delete;
         NCMessageCodecBase& operator=(NCMessageCodecBase&&) = delete;
 
     private:
-        std::unique_ptr<NCCompressor> compressor_intern;
-        std::unique_ptr<NCEncryption> encryption_intern;
+        // Indexed by NCCompressorID / NCEncryptionID:
+        std::array<std::unique_ptr<NCCompressor>, NC_MAX_CODEC_ID> compressors_intern;
+        std::array<std::unique_ptr<NCEncryption>, NC_MAX_CODEC_ID> encryptions_intern;
+        // Default codec, used when NC_DEFAULT_CODEC is given:
+        std::atomic<uint8_t> codec_intern;
+
+        [[nodiscard]] NCCodecID nc_resolve_codec(NCCodecID const codec) const;
+        [[nodiscard]] NCCompressor const& nc_get_compressor(NCCompressorID const id) const;
+        [[nodiscard]] NCEncryption const& nc_get_encryption(NCEncryptionID const id) const;
 };
 
 class NCMessageCodecNode: NCMessageCodecBase {
     public:
         [[nodiscard]] virtual NCEncodedMessageToServer nc_encode_message_to_server(
-            NCNodeMessageType const msg_type, std::vector<uint8_t> const& data, NCNodeID const node_id) const;
+            NCNodeMessageType const msg_type, std::vector<uint8_t> const& data, NCNodeSlot const node_slot) const;
         [[nodiscard]] virtual NCDecodedMessageFromServer nc_decode_message_from_server(
             NCEncodedMessageToNode const& message) const;
+        [[nodiscard]] virtual NCMessageHeaderFromServer nc_decode_header_from_server(
+            NCEncodedMessageToNode const& message) const;
+        [[nodiscard]] virtual std::vector<uint8_t> nc_decode_payload_from_server(
+            NCEncodedMessageToNode const& message) const;
+        [[nodiscard]] virtual NCInitResponse nc_decode_init_response(std::vector<uint8_t> data) const;
+        [[nodiscard]] virtual std::vector<std::vector<uint8_t>> nc_decode_data_batch(std::vector<uint8_t> const& data) const;
+        [[nodiscard]] virtual uint64_t nc_decode_cancel(std::vector<uint8_t> const& data) const;
 
-        [[nodiscard]] virtual NCEncodedMessageToServer nc_gen_heartbeat_message(NCNodeID const node_id) const;
-        [[nodiscard]] virtual NCEncodedMessageToServer nc_gen_init_message(NCNodeID const node_id) const;
+        [[nodiscard]] virtual NCEncodedMessageToServer nc_gen_heartbeat_message(NCNodeSlot const node_slot) const;
+        [[nodiscard]] virtual NCEncodedMessageToServer nc_gen_init_message(NCNodeID const node_id,
+            NCCapabilities const& capabilities = NCCapabilities(), NCNodeInfo const& node_info = NCNodeInfo()) const;
         [[nodiscard]] virtual NCEncodedMessageToServer nc_gen_result_message(
-            std::vector<uint8_t> const& new_data, NCNodeID const node_id) const;
-        [[nodiscard]] virtual NCEncodedMessageToServer nc_gen_need_more_data_message(NCNodeID const node_id) const;
+            std::vector<uint8_t> const& new_data, NCNodeSlot const node_slot) const;
+        [[nodiscard]] virtual NCEncodedMessageToServer nc_gen_need_more_data_message(NCNodeSlot const node_slot,
+            uint32_t const max_tasks = 1) const;
+        [[nodiscard]] virtual NCEncodedMessageToServer nc_gen_result_need_more_data_message(
+            std::vector<uint8_t> const& new_data, NCNodeSlot const node_slot) const;
+        [[nodiscard]] virtual NCEncodedMessageToServer nc_gen_result_batch_message(
+            std::vector<std::vector<uint8_t>> const& results, NCNodeSlot const node_slot) const;
+        [[nodiscard]] virtual NCEncodedMessageToServer nc_gen_tasks_cancelled_message(
+            uint32_t const num_tasks, NCNodeSlot const node_slot) const;
+
+        using NCMessageCodecBase::nc_set_codec;
+        using NCMessageCodecBase::nc_get_codec;
+        using NCMessageCodecBase::nc_get_capabilities;
 
         // Constructor:
         NCMessageCodecNode(std::string const secret_key);
@@ -83,16 +136,34 @@ class NCMessageCodecNode: NCMessageCodecBase {
 
 class NCMessageCodecServer: NCMessageCodecBase {
     public:
-        [[nodiscard]] virtual NCEncodedMessageToNode nc_encode_message_to_node(NCServerMessageType const msg_type, std::vector<uint8_t> const& data) const;
+        [[nodiscard]] virtual NCEncodedMessageToNode nc_encode_message_to_node(NCServerMessageType const msg_type,
+            std::vector<uint8_t> const& data, NCCodecID const codec = NC_DEFAULT_CODEC) const;
         [[nodiscard]] virtual NCDecodedMessageFromNode nc_decode_message_from_node(NCEncodedMessageToServer const& message) const;
-
-        [[nodiscard]] virtual NCEncodedMessageToNode nc_gen_heartbeat_message_ok() const;
-        [[nodiscard]] virtual NCEncodedMessageToNode nc_gen_init_message_ok(std::vector<uint8_t> const& init_data) const;
-        [[nodiscard]] virtual NCEncodedMessageToNode nc_gen_new_data_message(std::vector<uint8_t> const& new_data) const;
-        [[nodiscard]] virtual NCEncodedMessageToNode nc_gen_result_ok_message() const;
-        [[nodiscard]] virtual NCEncodedMessageToNode nc_gen_quit_message() const;
-        [[nodiscard]] virtual NCEncodedMessageToNode nc_gen_invalid_node_id_error() const;
-        [[nodiscard]] virtual NCEncodedMessageToNode nc_gen_unknown_error() const;
+        [[nodiscard]] virtual NCMessageHeaderFromNode nc_decode_header_from_node(NCEncodedMessageToServer const& message) const;
+        [[nodiscard]] virtual std::vector<uint8_t> nc_decode_payload_from_node(NCEncodedMessageToServer const& message) const;
+        [[nodiscard]] virtual NCInitRequest nc_decode_init_request(std::vector<uint8_t> const& data) const;
+        [[nodiscard]] virtual uint32_t nc_decode_need_more_data_request(std::vector<uint8_t> const& data) const;
+        [[nodiscard]] virtual std::vector<std::vector<uint8_t>> nc_decode_result_batch(std::vector<uint8_t> const& data) const;
+        [[nodiscard]] virtual uint32_t nc_decode_tasks_cancelled(std::vector<uint8_t> const& data) const;
+
+        [[nodiscard]] virtual NCEncodedMessageToNode nc_gen_heartbeat_message_ok(NCCodecID const codec = NC_DEFAULT_CODEC) const;
+        [[nodiscard]] virtual NCEncodedMessageToNode nc_gen_init_message_ok(NCNegotiatedCapabilities const& negotiated,
+            NCNodeSlot const node_slot, std::vector<uint8_t> const& init_data,
+            NCCodecID const codec = NC_DEFAULT_CODEC) const;
+        [[nodiscard]] virtual NCEncodedMessageToNode nc_gen_new_data_message(std::vector<uint8_t> const& new_data,
+            NCCodecID const codec = NC_DEFAULT_CODEC) const;
+        [[nodiscard]] virtual NCEncodedMessageToNode nc_gen_new_data_batch_message(std::vector<std::vector<uint8_t>> const& new_data,
+            NCCodecID const codec = NC_DEFAULT_CODEC) const;
+        [[nodiscard]] virtual NCEncodedMessageToNode nc_gen_result_ok_message(NCCodecID const codec = NC_DEFAULT_CODEC) const;
+        [[nodiscard]] virtual NCEncodedMessageToNode nc_gen_quit_message(NCCodecID const codec = NC_DEFAULT_CODEC) const;
+        [[nodiscard]] virtual NCEncodedMessageToNode nc_gen_cancel_message(uint64_t const num_tasks,
+            NCCodecID const codec = NC_DEFAULT_CODEC) const;
+        [[nodiscard]] virtual NCEncodedMessageToNode nc_gen_invalid_node_id_error(NCCodecID const codec = NC_DEFAULT_CODEC) const;
+        [[nodiscard]] virtual NCEncodedMessageToNode nc_gen_unknown_error(NCCodecID const codec = NC_DEFAULT_CODEC) const;
+
+        using NCMessageCodecBase::nc_set_codec;
+        using NCMessageCodecBase::nc_get_codec;
+        using NCMessageCodecBase::nc_get_capabilities;
 
         // Constructor:
         NCMessageCodecServer(std::string const secret_key);
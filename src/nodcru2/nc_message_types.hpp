@@ -23,6 +23,12 @@ enum struct NCNodeMessageType: uint8_t {
     Heartbeat,
     NewResultFromNode,
     NodeNeedsMoreData,
+    // Result and request for the next data in one message:
+    ResultNeedsMoreData,
+    // Results of several tasks in one message:
+    NewResultBatchFromNode,
+    // The node has dropped its oldest tasks after a Cancel message:
+    TasksCancelled,
 };
 
 enum struct NCServerMessageType: uint8_t {
@@ -32,12 +38,51 @@ enum struct NCServerMessageType: uint8_t {
     NewDataFromServer,
     ResultOK,
     InvalidNodeID,
-    Quit
+    Quit,
+    // Several tasks in one message:
+    NewDataBatchFromServer,
+    // Stop the tasks that the server has handed out before, also acknowledges the message of the node:
+    Cancel
 };
 
+// The IDs are sent in the header, four bits each:
+enum struct NCCompressorID: uint8_t {
+    None = 0,
+    LZ4,
+    LZ4HC,
+    // Use the default compressor of the message codec:
+    Default = 15
+};
+
+enum struct NCEncryptionID: uint8_t {
+    None = 0,
+    ChaCha20Poly1305,
+    AES256GCM,
+    // Use the default encryption of the message codec:
+    Default = 15
+};
+
+uint8_t const NC_MAX_CODEC_ID = 16;
+
+struct NCCodecID {
+    NCCompressorID compressor = NCCompressorID::Default;
+    NCEncryptionID encryption = NCEncryptionID::Default;
+
+    bool operator==(const NCCodecID&) const = default;
+};
+
+NCCodecID const NC_DEFAULT_CODEC = NCCodecID();
+
 uint8_t const NC_NONCE_LENGTH = 12;
 uint8_t const NC_GCM_TAG_LENGTH = 16;
 
+// The routing header is sent in clear text in front of the encrypted payload.
+// It is bound to the payload as associated data, so it can't be modified.
+// To server: message type (1 byte), codec (1 byte), node slot, payload length (4 bytes)
+size_t const NC_HEADER_TO_SERVER_LENGTH = 1 + 1 + NC_NODE_SLOT_LENGTH + 4;
+// To node: message type (1 byte), codec (1 byte), payload length (4 bytes)
+size_t const NC_HEADER_TO_NODE_LENGTH = 1 + 1 + 4;
+
 struct NCCompressedMessage {
     std::vector<uint8_t> data = {};
 };
@@ -64,9 +109,22 @@ struct NCEncodedMessageToNode {
     std::vector<uint8_t> data = {};
 };
 
+struct NCMessageHeaderFromNode {
+    NCNodeMessageType msg_type = NCNodeMessageType::Init;
+    NCCodecID codec = NC_DEFAULT_CODEC;
+    NCNodeSlot node_slot = NCNodeSlot();
+    uint32_t payload_length = 0;
+};
+
+struct NCMessageHeaderFromServer {
+    NCServerMessageType msg_type = NCServerMessageType::UnknownError;
+    NCCodecID codec = NC_DEFAULT_CODEC;
+    uint32_t payload_length = 0;
+};
+
 struct NCDecodedMessageFromNode {
     NCNodeMessageType msg_type = NCNodeMessageType::Init;
-    NCNodeID node_id = NCNodeID();
+    NCNodeSlot node_slot = NCNodeSlot();
     std::vector<uint8_t> data = {};
 };
 
@@ -10,9 +10,11 @@
 // Local includes:
 #include "nc_util.hpp"
 #include "nc_network.hpp"
+#include "nc_exceptions.hpp"
+#include "nc_buffer_pool.hpp"
 
 namespace nodcru2 {
-void NCNetworkSocketBase::nc_send_data([[maybe_unused]] std::vector<uint8_t> const data) {
+void NCNetworkSocketBase::nc_send_data([[maybe_unused]] std::vector<uint8_t> const& data) {
 }
 
 [[nodiscard]] std::vector<uint8_t> NCNetworkSocketBase::nc_receive_data() {
@@ -23,7 +25,7 @@ void NCNetworkSocketBase::nc_send_data([[maybe_unused]] std::vector<uint8_t> con
     return std::string();
 }
 
-void NCNetworkSocket::nc_send_data(std::vector<uint8_t> const data) {
+void NCNetworkSocket::nc_send_data(std::vector<uint8_t> const& data) {
     uint32_t data_size = static_cast<uint32_t>(data.size());
     std::array<uint8_t, 4> size_bytes;
     nc_to_big_endian_bytes(data_size, size_bytes);
@@ -38,7 +40,12 @@ void NCNetworkSocket::nc_send_data(std::vector<uint8_t> const data) {
     asio::read(socket_intern, asio::buffer(size_bytes));
     uint32_t data_size = nc_from_big_endian_bytes(size_bytes);
 
-    std::vector<uint8_t> result(data_size);
+    // Reject oversized frames before the buffer is allocated:
+    if (data_size > max_frame_size_intern) {
+        throw NCMessageException("Message exceeds maximum frame size.");
+    }
+
+    std::vector<uint8_t> result = nc_acquire_buffer(data_size);
     if (data_size > 0) {
         asio::read(socket_intern, asio::buffer(result));
     }
@@ -50,9 +57,10 @@ void NCNetworkSocket::nc_send_data(std::vector<uint8_t> const data) {
     return socket_intern.remote_endpoint().address().to_string();
 }
 
-NCNetworkSocket::NCNetworkSocket(tcp::socket &socket):
+NCNetworkSocket::NCNetworkSocket(tcp::socket &socket, uint32_t const max_frame_size):
     NCNetworkSocketBase(),
-    socket_intern(std::move(socket)) {}
+    socket_intern(std::move(socket)),
+    max_frame_size_intern(max_frame_size) {}
 
 std::unique_ptr<NCNetworkSocketBase> NCNetworkClientBase::nc_connect() {
     return std::make_unique<NCNetworkSocketBase>();
@@ -61,14 +69,15 @@ std::unique_ptr<NCNetworkSocketBase> NCNetworkClientBase::nc_connect() {
 std::unique_ptr<NCNetworkSocketBase> NCNetworkClient::nc_connect() {
     tcp::socket socket(io_context_intern);
     asio::connect(socket, endpoints_intern);
-    return std::make_unique<NCNetworkSocket>(socket);
+    return std::make_unique<NCNetworkSocket>(socket, max_frame_size_intern);
 }
 
-NCNetworkClient::NCNetworkClient(std::string_view server, uint16_t port):
+NCNetworkClient::NCNetworkClient(std::string_view server, uint16_t port, uint32_t const max_frame_size):
     NCNetworkClientBase(),
     io_context_intern(),
     resolver_intern(io_context_intern),
-    endpoints_intern(resolver_intern.resolve(server, std::to_string(port)))
+    endpoints_intern(resolver_intern.resolve(server, std::to_string(port))),
+    max_frame_size_intern(max_frame_size)
     {}
 
 std::unique_ptr<NCNetworkSocketBase> NCNetworkServerBase::nc_accept() {
@@ -78,12 +87,13 @@ std::unique_ptr<NCNetworkSocketBase> NCNetworkServerBase::nc_accept() {
 std::unique_ptr<NCNetworkSocketBase> NCNetworkServer::nc_accept() {
     tcp::socket socket(io_context_intern);
     acceptor_intern.accept(socket);
-    return std::make_unique<NCNetworkSocket>(socket);
+    return std::make_unique<NCNetworkSocket>(socket, max_frame_size_intern);
 }
 
-NCNetworkServer::NCNetworkServer(uint16_t server_port):
+NCNetworkServer::NCNetworkServer(uint16_t server_port, uint32_t const max_frame_size):
     NCNetworkServerBase(),
     io_context_intern(),
-    acceptor_intern(io_context_intern, tcp::endpoint(tcp::v4(), server_port))
+    acceptor_intern(io_context_intern, tcp::endpoint(tcp::v4(), server_port)),
+    max_frame_size_intern(max_frame_size)
     {}
 }
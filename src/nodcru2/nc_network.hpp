@@ -17,12 +17,15 @@
 // External includes:
 #include <asio.hpp>
 
+// Local includes:
+#include "nc_capability.hpp"
+
 namespace nodcru2 {
 using asio::ip::tcp;
 
 class NCNetworkSocketBase {
     public:
-        virtual void nc_send_data(std::vector<uint8_t> const data);
+        virtual void nc_send_data(std::vector<uint8_t> const& data);
         [[nodiscard]] virtual std::vector<uint8_t> nc_receive_data();
         [[nodiscard]] virtual std::string nc_address();
 
@@ -37,12 +40,12 @@ class NCNetworkSocketBase {
 
 class NCNetworkSocket: public NCNetworkSocketBase {
     public:
-        void nc_send_data(std::vector<uint8_t> const data) override;
+        void nc_send_data(std::vector<uint8_t> const& data) override;
         [[nodiscard]] std::vector<uint8_t> nc_receive_data() override;
         [[nodiscard]] std::string nc_address() override;
 
         // Constructor:
-        NCNetworkSocket(tcp::socket &socket);
+        NCNetworkSocket(tcp::socket &socket, uint32_t const max_frame_size = NC_DEFAULT_MAX_FRAME_SIZE);
 
         // Default special member functions:
         ~NCNetworkSocket() = default;
@@ -53,6 +56,7 @@ class NCNetworkSocket: public NCNetworkSocketBase {
 
     private:
         tcp::socket socket_intern;
+        uint32_t max_frame_size_intern;
 };
 
 class NCNetworkClientBase {
@@ -74,7 +78,8 @@ class NCNetworkClient: public NCNetworkClientBase {
         //NCNetworkSocket nc_connect_to(std::string_view server, std::string_view port);
 
         // Constructor:
-        NCNetworkClient(std::string_view server, uint16_t port);
+        NCNetworkClient(std::string_view server, uint16_t port,
+            uint32_t const max_frame_size = NC_DEFAULT_MAX_FRAME_SIZE);
 
         // Disable all other special member functions:
         NCNetworkClient(NCNetworkClient&&) = delete;
@@ -86,6 +91,7 @@ class NCNetworkClient: public NCNetworkClientBase {
         asio::io_context io_context_intern;
         tcp::resolver resolver_intern;
         tcp::resolver::results_type endpoints_intern;
+        uint32_t max_frame_size_intern;
 };
 
 class NCNetworkServerBase {
@@ -106,7 +112,7 @@ class NCNetworkServer: public NCNetworkServerBase {
         std::unique_ptr<NCNetworkSocketBase> nc_accept() override;
 
         // Constructor:
-        NCNetworkServer(uint16_t server_port);
+        NCNetworkServer(uint16_t server_port, uint32_t const max_frame_size = NC_DEFAULT_MAX_FRAME_SIZE);
 
         // Disable all other special member functions:
         NCNetworkServer(NCNetworkServer&&) = delete;
@@ -117,6 +123,7 @@ class NCNetworkServer: public NCNetworkServerBase {
     private:
         asio::io_context io_context_intern;
         tcp::acceptor acceptor_intern;
+        uint32_t max_frame_size_intern;
 };
 
 }
@@ -11,6 +11,10 @@
 #include <thread>
 #include <chrono>
 #include <tuple>
+#include <deque>
+#include <optional>
+#include <map>
+#include <algorithm>
 
 // External includes:
 #include <spdlog/sinks/basic_file_sink.h>
@@ -22,12 +26,18 @@
 #include "nc_network.hpp"
 #include "nc_util.hpp"
 #include "nc_exceptions.hpp"
+#include "nc_buffer_pool.hpp"
+#include "nc_bounded_queue.hpp"
 
 namespace nodcru2 {
 enum struct NCRunState: uint8_t {
     Init,
     NeedData,
-    HasData
+    HasData,
+    // Send the collected results in one message:
+    SendResults,
+    // Tell the server about the tasks that were dropped after a Cancel message:
+    Cancelled
 };
 
 void NCNodeDataProcessor::nc_init([[maybe_unused]] std::vector<uint8_t> data,
@@ -38,6 +48,59 @@ void NCNodeDataProcessor::nc_init([[maybe_unused]] std::vector<uint8_t> data,
     return std::vector<uint8_t>();
 }
 
+void NCNodeDataProcessor::nc_process_data_into(std::vector<uint8_t> data, std::vector<uint8_t>& result) {
+    /*
+    The node calls this method with the same result buffer for every task.
+
+    Override this method to write the result into the given buffer, its capacity
+    is kept between the tasks so no new allocation is needed.
+    The default calls nc_process_data().
+    */
+
+    result = nc_process_data(std::move(data));
+}
+
+void NCNodeDataProcessor::nc_process_data_cancellable(std::vector<uint8_t> data, std::vector<uint8_t>& result,
+    [[maybe_unused]] NCCancellationToken const& token) {
+    /*
+    The node calls this method for every task.
+
+    Override this method if a task runs for a long time: check token.nc_is_cancelled()
+    from time to time and return early if it is set, the server doesn't need the result
+    anymore and the node drops it.
+    The default calls nc_process_data_into().
+    */
+
+    nc_process_data_into(std::move(data), result);
+}
+
+NCCancellationToken::NCCancellationToken(std::atomic<uint64_t> const& num_cancelled, uint64_t const task_sequence):
+    num_cancelled_intern(&num_cancelled),
+    task_sequence_intern(task_sequence)
+    {}
+
+NCCancellationToken::NCCancellationToken():
+    num_cancelled_intern(nullptr),
+    task_sequence_intern(0)
+    {}
+
+[[nodiscard]] bool NCCancellationToken::nc_is_cancelled() const noexcept {
+    return (num_cancelled_intern != nullptr) &&
+        (num_cancelled_intern->load(std::memory_order_relaxed) > task_sequence_intern);
+}
+
+[[nodiscard]] uint32_t NCNodeDataProcessor::nc_benchmark() {
+    /*
+    Called once before the node registers itself to the server.
+
+    The server uses the score to give more work to faster nodes.
+    The score should be comparable between all nodes of the job,
+    zero means no score and the server uses the number of cores instead.
+    */
+
+    return 0;
+}
+
 NCNode::NCNode(NCConfiguration config,
     std::shared_ptr<NCNodeDataProcessor> data_processor,
     std::unique_ptr<NCMessageCodecNode> message_codec,
@@ -50,7 +113,13 @@ NCNode::NCNode(NCConfiguration config,
     node_mutex(),
     message_codec_intern(std::move(message_codec)),
     network_client_intern(std::move(network_client)),
-    data_processor_intern(data_processor)
+    data_processor_intern(data_processor),
+    max_frame_size_intern(config_intern.max_frame_size),
+    node_slot_intern(),
+    slot_mutex(),
+    features_intern(0),
+    register_mutex(),
+    num_cancelled_intern(0)
     {
         spdlog::drop("nc_logger");
 
@@ -80,7 +149,7 @@ NCNode::NCNode(NCConfiguration config,
     NCNode(config,
         data_processor,
         std::move(message_codec),
-        std::make_unique<NCNetworkClient>(config.server_address, config.server_port))
+        std::make_unique<NCNetworkClient>(config.server_address, config.server_port, config.max_frame_size))
     {}
 
 NCNode::NCNode(NCConfiguration config,
@@ -97,13 +166,56 @@ NCNode::NCNode(NCConfiguration config,
     NCNode(config,
         data_processor,
         std::make_unique<NCMessageCodecNode>(config.secret_key),
-        std::make_unique<NCNetworkClient>(config.server_address, config.server_port))
+        std::make_unique<NCNetworkClient>(config.server_address, config.server_port, config.max_frame_size))
     {}
 
 void NCNode::nc_run() {
     nc_logger->info("NCNode::nc_run() - starting node");
-    NCEncodedMessageToServer const init_message = message_codec_intern->nc_gen_init_message(node_id);
-    NCEncodedMessageToServer const need_more_data_message = message_codec_intern->nc_gen_need_more_data_message(node_id);
+    NCCapabilities capabilities = message_codec_intern->nc_get_capabilities();
+    capabilities.preferred_compressor = config_intern.preferred_compressor;
+    capabilities.preferred_encryption = config_intern.preferred_encryption;
+    capabilities.max_frame_size = config_intern.max_frame_size;
+    capabilities.features |= NC_FEATURE_RESULT_WITH_NEW_DATA;
+    capabilities.features |= NC_FEATURE_RESULT_BATCH;
+    capabilities.features |= NC_FEATURE_CANCEL;
+
+    NCNodeInfo node_info = nc_detect_node_info();
+    node_info.benchmark_score = data_processor_intern->nc_benchmark();
+    nc_logger->debug("Node info: cores: {}, memory: {}, cpu features: {}, benchmark score: {}",
+        node_info.num_cores, node_info.memory, node_info.cpu_features, node_info.benchmark_score);
+
+    NCEncodedMessageToServer const init_message = message_codec_intern->nc_gen_init_message(node_id, capabilities, node_info);
+
+    // The workers share the cores with the parallel loops of the data processor:
+    nc_set_node_workers(config_intern.num_workers);
+
+    // Have to use lambda in order to call non-static method:
+    std::thread heartbeat_thread([this, &init_message](){nc_send_heartbeat(init_message);});
+
+    if ((config_intern.prefetch_depth > 0) || (config_intern.num_workers > 1)) {
+        nc_run_pipelined(init_message);
+    } else {
+        nc_run_sequential(init_message);
+    }
+
+    nc_logger->debug("Waiting for heartbeat thread...");
+    heartbeat_thread.join();
+    nc_logger->info("Will exit now.");
+    nc_logger->flush();
+
+    // Wait for all log files to be written
+    // TODO: make this duration configurable:
+    std::this_thread::sleep_for(std::chrono::seconds(10));
+}
+
+void NCNode::nc_run_sequential(NCEncodedMessageToServer const& init_message) {
+    /*
+    Request data, compute and send the result back, one after the other.
+    */
+
+    // Generated again with the negotiated codec and the node slot after InitOK:
+    NCEncodedMessageToServer need_more_data_message = message_codec_intern->nc_gen_need_more_data_message(NCNodeSlot(),
+        config_intern.batch_size);
     // TODO: make this configurable:
     auto const sleep_time = std::chrono::seconds(10);
 
@@ -112,9 +224,113 @@ void NCNode::nc_run() {
     NCEncodedMessageToServer result_message;
     NCRunState run_state = NCRunState::Init;
     std::vector<uint8_t> new_data;
+    // Send the result and ask for new data in one message, if the server supports it:
+    bool result_with_new_data = false;
+    // Tasks of the last batch that are not processed yet, in the order of the server:
+    std::deque<std::vector<uint8_t>> pending_data;
+    // Collect the results and send them in one message, if the server supports it:
+    bool result_batch = false;
+    std::vector<std::vector<uint8_t>> pending_results;
+    size_t pending_result_bytes = 0;
+    std::chrono::steady_clock::time_point oldest_result_time;
+    auto const result_batch_time = std::chrono::milliseconds(config_intern.result_batch_time);
+    // Sequence number of the next task, the tasks are numbered from zero for each registration like on the server:
+    uint64_t next_sequence = 0;
+    // Tasks that were dropped after a Cancel message, reported after the results of the earlier tasks:
+    uint32_t num_cancelled = 0;
+    // The registration that the current tasks belong to, the heartbeat thread may register the node again:
+    NCNodeSlot node_slot;
 
-    // Have to use lambda in order to call non-static method:
-    std::thread heartbeat_thread([this](){nc_send_heartbeat();});
+    // The server has given the tasks of the old registration to other nodes,
+    // their results are not needed anymore:
+    auto const new_registration = [&] () {
+        for (auto& item: pending_data) {
+            nc_release_buffer(std::move(item));
+        }
+
+        for (auto& item: pending_results) {
+            nc_release_buffer(std::move(item));
+        }
+
+        pending_data.clear();
+        pending_results.clear();
+        pending_result_bytes = 0;
+        new_data.clear();
+        num_cancelled = 0;
+        next_sequence = 0;
+
+        node_slot = nc_get_node_slot();
+        need_more_data_message = message_codec_intern->nc_gen_need_more_data_message(node_slot, config_intern.batch_size);
+        uint8_t const features = features_intern.load();
+        result_with_new_data = (features & NC_FEATURE_RESULT_WITH_NEW_DATA) != 0;
+        result_batch = ((features & NC_FEATURE_RESULT_BATCH) != 0) && (config_intern.result_batch_size > 1);
+        return NCRunState::NeedData;
+    };
+
+    // Process one task, unless the server has cancelled it:
+    auto const compute = [&] (std::vector<uint8_t> data, uint64_t const sequence) {
+        NCCancellationToken const token(num_cancelled_intern, sequence);
+
+        if (!token.nc_is_cancelled()) {
+            // The result buffer new_data is owned by the node and reused:
+            data_processor_intern->nc_process_data_cancellable(std::move(data), new_data, token);
+
+            if (!token.nc_is_cancelled()) {
+                return NCRunState::HasData;
+            }
+        } else {
+            nc_release_buffer(std::move(data));
+        }
+
+        // Drop this task and the tasks of the batch that are also cancelled,
+        // the tasks that were handed out after the Cancel are processed later:
+        num_cancelled = 1;
+
+        while (!pending_data.empty() && (next_sequence < num_cancelled_intern.load())) {
+            nc_release_buffer(std::move(pending_data.front()));
+            pending_data.pop_front();
+            next_sequence++;
+            num_cancelled++;
+        }
+
+        nc_logger->debug("Tasks cancelled: {}", num_cancelled);
+        new_data.clear();
+        return pending_results.empty() ? NCRunState::Cancelled : NCRunState::SendResults;
+    };
+
+    // Process the next task of the batch or ask the server for more:
+    auto const next_task = [&] () {
+        if (pending_data.empty()) {
+            return NCRunState::NeedData;
+        }
+
+        std::vector<uint8_t> data = std::move(pending_data.front());
+        pending_data.pop_front();
+        return compute(std::move(data), next_sequence++);
+    };
+
+    // The server has accepted the results or the cancelled tasks:
+    auto const result_ok = [&] () {
+        if (run_state == NCRunState::SendResults) {
+            for (auto& item: pending_results) {
+                nc_release_buffer(std::move(item));
+            }
+
+            pending_results.clear();
+            pending_result_bytes = 0;
+        } else if (run_state == NCRunState::Cancelled) {
+            num_cancelled = 0;
+        }
+
+        // Report the cancelled tasks, then the next task of the batch or request more data:
+        return (num_cancelled > 0) ? NCRunState::Cancelled : next_task();
+    };
+
+    auto const results_due = [&] () {
+        return (pending_results.size() >= config_intern.result_batch_size) ||
+            (pending_result_bytes >= config_intern.result_batch_bytes) ||
+            ((std::chrono::steady_clock::now() - oldest_result_time) >= result_batch_time);
+    };
 
     while (!quit.load()) {
         if (error_counter >= max_error_count) {
@@ -124,6 +340,30 @@ void NCNode::nc_run() {
             break;
         }
 
+        if ((run_state != NCRunState::Init) && (nc_get_node_slot() != node_slot)) {
+            nc_logger->info("Registered again, drop the tasks of the old registration.");
+            run_state = new_registration();
+        }
+
+        if ((run_state == NCRunState::HasData) && result_batch) {
+            if (pending_results.empty()) {
+                oldest_result_time = std::chrono::steady_clock::now();
+            }
+
+            pending_result_bytes += new_data.size();
+            pending_results.push_back(std::move(new_data));
+            new_data = nc_acquire_buffer(0);
+
+            // Continue with the next task without a message to the server:
+            run_state = results_due() ? NCRunState::SendResults : next_task();
+            continue;
+        }
+
+        if ((run_state == NCRunState::NeedData) && !pending_results.empty() && results_due()) {
+            // Don't keep old results back while waiting for new data:
+            run_state = NCRunState::SendResults;
+        }
+
         try {
             switch (run_state) {
                 case NCRunState::Init:
@@ -136,7 +376,29 @@ void NCNode::nc_run() {
                 break;
                 case NCRunState::HasData:
                     nc_logger->debug("Has data state, send result message");
-                    result_message = message_codec_intern->nc_gen_result_message(new_data, node_id);
+                    nc_release_buffer(std::move(result_message.data));
+
+                    // Ask for new data only if all tasks of the batch are done:
+                    if (result_with_new_data && pending_data.empty()) {
+                        // The server answers with new data or quit:
+                        result_message = message_codec_intern->nc_gen_result_need_more_data_message(new_data, node_slot);
+                    } else {
+                        result_message = message_codec_intern->nc_gen_result_message(new_data, node_slot);
+                    }
+
+                    result = nc_send_msg_return_answer(result_message);
+                break;
+                case NCRunState::SendResults:
+                    nc_logger->debug("Send results state, send {} results", pending_results.size());
+                    nc_release_buffer(std::move(result_message.data));
+                    // The results are kept until the server has accepted them:
+                    result_message = message_codec_intern->nc_gen_result_batch_message(pending_results, node_slot);
+                    result = nc_send_msg_return_answer(result_message);
+                break;
+                case NCRunState::Cancelled:
+                    nc_logger->debug("Cancelled state, send tasks cancelled message: {}", num_cancelled);
+                    nc_release_buffer(std::move(result_message.data));
+                    result_message = message_codec_intern->nc_gen_tasks_cancelled_message(num_cancelled, node_slot);
                     result = nc_send_msg_return_answer(result_message);
                 break;
                 default:
@@ -155,27 +417,64 @@ void NCNode::nc_run() {
         switch (result.msg_type) {
             case NCServerMessageType::InitOK:
                 nc_logger->debug("InitOK from server.");
-                data_processor_intern->nc_init(result.data, node_id);
-                run_state = NCRunState::NeedData;
+
+                try {
+                    nc_handle_init_ok(std::move(result.data), true);
+                    run_state = new_registration();
+                } catch (std::exception &e) {
+                    error_counter++;
+                    nc_logger->error("Invalid InitOK from server: {}, error counter: {}", e.what(), error_counter);
+                    std::this_thread::sleep_for(sleep_time);
+                }
             break;
             case NCServerMessageType::InvalidNodeID:
-                // Invalid node id was sent to the server.
-                // This node hasn't registered yet to the server.
-                error_counter++;
-                nc_logger->error("InvalidNodeID from server, error counter: {}", error_counter);
-                std::this_thread::sleep_for(sleep_time);
+                // Evicted after a heartbeat timeout, register again (unless the heartbeat
+                // thread already has). The tasks are dropped at the start of the next round:
+                nc_logger->error("InvalidNodeID from server, register again.");
+                std::ignore = nc_register(init_message, node_slot, false);
             break;
             case NCServerMessageType::NewDataFromServer:
                 // Received new data from server.
                 nc_logger->debug("New data from server.");
-                new_data = data_processor_intern->nc_process_data(result.data);
-                run_state = NCRunState::HasData;
+                run_state = compute(std::move(result.data), next_sequence++);
+            break;
+            case NCServerMessageType::NewDataBatchFromServer:
+                nc_logger->debug("New data batch from server.");
+
+                try {
+                    for (auto& item: message_codec_intern->nc_decode_data_batch(result.data)) {
+                        pending_data.push_back(std::move(item));
+                    }
+                } catch (std::exception &e) {
+                    error_counter++;
+                    nc_logger->error("Invalid data batch from server: {}, error counter: {}", e.what(), error_counter);
+                    std::this_thread::sleep_for(sleep_time);
+                    break;
+                }
+
+                nc_release_buffer(std::move(result.data));
+
+                if (pending_data.empty()) {
+                    // No task available at the moment, ask again later:
+                    std::this_thread::sleep_for(std::chrono::seconds(1));
+                }
+
+                run_state = next_task();
             break;
             case NCServerMessageType::ResultOK:
                 // Result was accepted by server.
-                // Request more data.
                 nc_logger->debug("ResultOK from server.");
-                run_state = NCRunState::NeedData;
+                run_state = result_ok();
+            break;
+            case NCServerMessageType::Cancel:
+                // Takes the place of the usual answer, the message has been accepted:
+                nc_logger->debug("Cancel from server.");
+                nc_handle_cancel(result.data, node_slot);
+
+                // Without new data ask again, else the same as ResultOK:
+                if (run_state != NCRunState::NeedData) {
+                    run_state = result_ok();
+                }
             break;
             case NCServerMessageType::Quit:
                 // Job is done.
@@ -189,34 +488,524 @@ void NCNode::nc_run() {
                 std::this_thread::sleep_for(sleep_time);
         }
     }
+}
+
+void NCNode::nc_run_pipelined(NCEncodedMessageToServer const& init_message) {
+    /*
+    Fetch the next tasks and upload the results in the background while
+    the workers compute, so the node doesn't wait for the network.
+
+    This thread is the first worker, the others share the registration,
+    the connection and the init data. Up to max(prefetch_depth, num_workers)
+    tasks and results are kept in the queues.
+    */
+
+    if (!nc_register(init_message, NCNodeSlot(), true)) {
+        return;
+    }
 
-    nc_logger->debug("Waiting for heartbeat thread...");
-    heartbeat_thread.join();
-    nc_logger->info("Will exit now.");
-    nc_logger->flush();
+    size_t const queue_size = std::max(config_intern.prefetch_depth, uint32_t(config_intern.num_workers));
+    NCBoundedQueue<NCNodeTask> tasks(queue_size);
+    NCBoundedQueue<NCNodeTask> results(queue_size);
 
-    // Wait for all log files to be written
-    // TODO: make this duration configurable:
-    std::this_thread::sleep_for(sleep_time);
+    // Have to use lambda in order to call non-static method:
+    std::thread fetch_thread([this, &init_message, &tasks, &results](){nc_fetch_tasks(init_message, tasks, results);});
+    std::thread upload_thread([this, &init_message, &tasks, &results](){nc_upload_results(init_message, tasks, results);});
+    std::vector<std::thread> worker_threads;
+
+    for (uint16_t i = 1; i < config_intern.num_workers; i++) {
+        worker_threads.emplace_back([this, &tasks, &results](){nc_compute_tasks(tasks, results);});
+    }
+
+    nc_compute_tasks(tasks, results);
+
+    for (auto& worker: worker_threads) {
+        worker.join();
+    }
+
+    // Let the upload thread send the remaining results:
+    results.nc_close();
+    upload_thread.join();
+    quit.store(true);
+    tasks.nc_close();
+    fetch_thread.join();
+}
+
+void NCNode::nc_compute_tasks(NCBoundedQueue<NCNodeTask>& tasks, NCBoundedQueue<NCNodeTask>& results) {
+    /*
+    Process tasks until the job is done, called by each worker.
+    */
+
+    std::vector<uint8_t> new_data;
+
+    while (!quit.load()) {
+        std::optional<NCNodeTask> task = tasks.nc_pop();
+
+        if (!task) {
+            break;
+        }
+
+        if (task->node_slot != nc_get_node_slot()) {
+            // Registered again, the server has given this task to another node:
+            nc_release_buffer(std::move(task->data));
+            continue;
+        }
+
+        NCCancellationToken const token(num_cancelled_intern, task->sequence);
+
+        if (!token.nc_is_cancelled()) {
+            // The result buffer is handed to the upload thread and given back to the pool there:
+            data_processor_intern->nc_process_data_cancellable(std::move(task->data), new_data, token);
+        } else {
+            nc_release_buffer(std::move(task->data));
+        }
+
+        if (token.nc_is_cancelled()) {
+            // The upload thread tells the server in the order of the tasks:
+            new_data.clear();
+
+            if (!results.nc_push(NCNodeTask{task->sequence, {}, true, task->node_slot})) {
+                break;
+            }
+
+            continue;
+        }
+
+        if (!results.nc_push(NCNodeTask{task->sequence, std::move(new_data), false, task->node_slot})) {
+            break;
+        }
+
+        new_data = nc_acquire_buffer(0);
+    }
+}
+
+void NCNode::nc_fetch_tasks(NCEncodedMessageToServer const& init_message,
+    NCBoundedQueue<NCNodeTask>& tasks, NCBoundedQueue<NCNodeTask>& results) {
+    /*
+    Ask the server for new data as long as there is room in the task queue.
+
+    The tasks are numbered in the order of the server, starting at zero
+    for each registration.
+    */
+
+    nc_logger->debug("NCNode::nc_fetch_tasks() - starting fetch thread.");
+    // TODO: make this configurable:
+    auto const sleep_time = std::chrono::seconds(10);
+    uint8_t error_counter = 0;
+    uint64_t sequence = 0;
+    NCNodeSlot sequence_slot;
+    NCDecodedMessageFromServer result;
+
+    while (!quit.load()) {
+        if (error_counter >= max_error_count) {
+            nc_logger->error("Fetch, too many errors: {}, will exit now.", error_counter);
+            quit.store(true);
+            break;
+        }
+
+        NCNodeSlot const node_slot = nc_get_node_slot();
+
+        if (node_slot != sequence_slot) {
+            // Registered again, the tasks of the old registration are dropped:
+            sequence = 0;
+            sequence_slot = node_slot;
+        }
+
+        try {
+            auto need_more_data_message = message_codec_intern->nc_gen_need_more_data_message(node_slot, config_intern.batch_size);
+            result = nc_send_msg_return_answer(need_more_data_message);
+            nc_release_buffer(std::move(need_more_data_message.data));
+        } catch (std::exception &e) {
+            error_counter++;
+            nc_logger->error("Fetch, caught exception: {}", e.what());
+            std::this_thread::sleep_for(sleep_time);
+            continue;
+        }
+
+        switch (result.msg_type) {
+            case NCServerMessageType::NewDataFromServer:
+                nc_logger->debug("Fetch, new data from server.");
+                // Blocks while the queue is full:
+                tasks.nc_push(NCNodeTask{sequence++, std::move(result.data), false, node_slot});
+            break;
+            case NCServerMessageType::NewDataBatchFromServer:
+                nc_logger->debug("Fetch, new data batch from server.");
+
+                try {
+                    auto batch = message_codec_intern->nc_decode_data_batch(result.data);
+
+                    if (batch.empty()) {
+                        // No task available at the moment, ask again later:
+                        std::this_thread::sleep_for(std::chrono::seconds(1));
+                    }
+
+                    for (auto& item: batch) {
+                        tasks.nc_push(NCNodeTask{sequence++, std::move(item), false, node_slot});
+                    }
+                } catch (std::exception &e) {
+                    error_counter++;
+                    nc_logger->error("Fetch, invalid data batch from server: {}, error counter: {}", e.what(), error_counter);
+                    std::this_thread::sleep_for(sleep_time);
+                }
+
+                nc_release_buffer(std::move(result.data));
+            break;
+            case NCServerMessageType::Cancel:
+                // No new data in this answer, ask again:
+                nc_logger->debug("Fetch, Cancel from server.");
+                nc_handle_cancel(result.data, node_slot);
+            break;
+            case NCServerMessageType::InvalidNodeID:
+                // Evicted after a heartbeat timeout, register again:
+                nc_logger->error("Fetch, InvalidNodeID from server, register again.");
+                std::ignore = nc_register(init_message, node_slot, false);
+            break;
+            case NCServerMessageType::Quit:
+                nc_logger->info("Fetch, Quit from server, will exit now.");
+                quit.store(true);
+            break;
+            default:
+                error_counter++;
+                nc_logger->error("Fetch, unknown message: {}, error counter: {}", nc_type_to_string(result.msg_type), error_counter);
+                std::this_thread::sleep_for(sleep_time);
+        }
+    }
+
+    // Wake up the other threads:
+    tasks.nc_close();
+    results.nc_close();
+    nc_logger->debug("Fetch, will exit now.");
+}
+
+void NCNode::nc_upload_results(NCEncodedMessageToServer const& init_message,
+    NCBoundedQueue<NCNodeTask>& tasks, NCBoundedQueue<NCNodeTask>& results) {
+    /*
+    Send the results to the server in the order of the tasks, a worker
+    may finish its task before a worker that started earlier.
+
+    If the server supports it, all results that are waiting in the queue
+    are sent in one message (up to result_batch_size and result_batch_bytes).
+    A result is kept and sent again until the server has accepted it.
+    Tasks that were dropped after a Cancel message are reported in their
+    place with a TasksCancelled message.
+    After the node has registered again, the results of the old registration
+    are dropped, the server has given these tasks to other nodes.
+    All results are sent before the thread exits, unless the server has
+    answered with Quit.
+    */
+
+    nc_logger->debug("NCNode::nc_upload_results() - starting upload thread.");
+    // TODO: make this configurable:
+    auto const sleep_time = std::chrono::seconds(10);
+    bool const result_batch = ((features_intern.load() & NC_FEATURE_RESULT_BATCH) != 0) && (config_intern.result_batch_size > 1);
+    uint8_t error_counter = 0;
+    std::vector<std::vector<uint8_t>> pending_results;
+    uint32_t num_cancelled = 0;
+    // Results that are done but wait for an earlier result:
+    std::map<uint64_t, NCNodeTask> done_results;
+    uint64_t next_sequence = 0;
+    // The registration of the results in done_results and pending_results:
+    NCNodeSlot node_slot = nc_get_node_slot();
+    // The server doesn't need the results anymore:
+    bool done = false;
+    NCDecodedMessageFromServer result;
+
+    auto const new_registration = [&] () {
+        for (auto& item: pending_results) {
+            nc_release_buffer(std::move(item));
+        }
+
+        for (auto& [sequence, item]: done_results) {
+            nc_release_buffer(std::move(item.data));
+        }
+
+        pending_results.clear();
+        done_results.clear();
+        num_cancelled = 0;
+        next_sequence = 0;
+        node_slot = nc_get_node_slot();
+    };
+
+    auto const add_result = [&] (NCNodeTask new_result) {
+        if (new_result.node_slot != nc_get_node_slot()) {
+            // Task of an old registration:
+            nc_release_buffer(std::move(new_result.data));
+            return;
+        }
+
+        if (new_result.node_slot != node_slot) {
+            // The first result of a new registration:
+            new_registration();
+        }
+
+        done_results.emplace(new_result.sequence, std::move(new_result));
+    };
+
+    while (!done) {
+        if (error_counter >= max_error_count) {
+            nc_logger->error("Upload, too many errors: {}, will exit now.", error_counter);
+            quit.store(true);
+            break;
+        }
+
+        if (nc_get_node_slot() != node_slot) {
+            nc_logger->info("Upload, registered again, drop the results of the old registration.");
+            new_registration();
+        }
+
+        if (pending_results.empty() && (num_cancelled == 0)) {
+            bool closed = false;
+
+            while (!done_results.contains(next_sequence)) {
+                std::optional<NCNodeTask> new_result = results.nc_pop();
+
+                if (!new_result) {
+                    closed = true;
+                    break;
+                }
+
+                add_result(std::move(*new_result));
+            }
+
+            if (closed) {
+                // All results are sent:
+                break;
+            }
+
+            // Don't wait for more results, only take the ones that are already done:
+            while (std::optional<NCNodeTask> new_result = results.nc_try_pop()) {
+                add_result(std::move(*new_result));
+            }
+
+            size_t pending_result_bytes = 0;
+            auto item = done_results.begin();
+
+            // All cancelled tasks in a row go into one message:
+            while ((item != done_results.end()) && (item->first == next_sequence) && item->second.cancelled) {
+                num_cancelled++;
+                item = done_results.erase(item);
+                next_sequence++;
+            }
+
+            while ((num_cancelled == 0) && (item != done_results.end()) && (item->first == next_sequence) &&
+                !item->second.cancelled && (pending_results.empty() ||
+                (result_batch && (pending_results.size() < config_intern.result_batch_size) &&
+                (pending_result_bytes < config_intern.result_batch_bytes)))) {
+                pending_result_bytes += item->second.data.size();
+                pending_results.push_back(std::move(item->second.data));
+                item = done_results.erase(item);
+                next_sequence++;
+            }
+        }
+
+        try {
+            NCEncodedMessageToServer result_message = (num_cancelled > 0) ?
+                message_codec_intern->nc_gen_tasks_cancelled_message(num_cancelled, node_slot) :
+                (pending_results.size() > 1) ?
+                message_codec_intern->nc_gen_result_batch_message(pending_results, node_slot) :
+                message_codec_intern->nc_gen_result_message(pending_results.front(), node_slot);
+            result = nc_send_msg_return_answer(result_message);
+            nc_release_buffer(std::move(result_message.data));
+        } catch (std::exception &e) {
+            error_counter++;
+            nc_logger->error("Upload, caught exception: {}", e.what());
+
+            if (quit.load()) {
+                // The node shuts down, don't wait for the server:
+                break;
+            }
+
+            std::this_thread::sleep_for(sleep_time);
+            continue;
+        }
+
+        switch (result.msg_type) {
+            case NCServerMessageType::Cancel:
+                // Takes the place of ResultOK:
+                nc_logger->debug("Upload, Cancel from server.");
+                nc_handle_cancel(result.data, node_slot);
+                [[fallthrough]];
+            case NCServerMessageType::ResultOK:
+                nc_logger->debug("Upload, ResultOK from server, results: {}, cancelled: {}",
+                    pending_results.size(), num_cancelled);
+
+                for (auto& item: pending_results) {
+                    nc_release_buffer(std::move(item));
+                }
+
+                pending_results.clear();
+                num_cancelled = 0;
+            break;
+            case NCServerMessageType::InvalidNodeID:
+                // Evicted after a heartbeat timeout, register again. The results are dropped
+                // at the start of the next round:
+                nc_logger->error("Upload, InvalidNodeID from server, register again.");
+                done = !nc_register(init_message, node_slot, false);
+            break;
+            case NCServerMessageType::Quit:
+                nc_logger->info("Upload, Quit from server, will exit now.");
+                quit.store(true);
+                done = true;
+            break;
+            default:
+                error_counter++;
+                nc_logger->error("Upload, unknown message: {}, error counter: {}", nc_type_to_string(result.msg_type), error_counter);
+                std::this_thread::sleep_for(sleep_time);
+        }
+    }
+
+    // Wake up the other threads:
+    tasks.nc_close();
+    results.nc_close();
+    nc_logger->debug("Upload, will exit now.");
+}
+
+[[nodiscard]] bool NCNode::nc_register(NCEncodedMessageToServer const& init_message, NCNodeSlot const old_slot,
+    bool const call_init) {
+    /*
+    Send the init message until the server has accepted the node.
+
+    Called by several threads, only the first one registers again
+    if the node slot is still old_slot.
+    Returns false if the node has to quit.
+    */
+
+    const std::lock_guard<std::mutex> lock(register_mutex);
+
+    if (nc_get_node_slot() != old_slot) {
+        // Another thread has already registered the node:
+        return true;
+    }
+
+    // TODO: make this configurable:
+    auto const sleep_time = std::chrono::seconds(10);
+    uint8_t error_counter = 0;
+    NCDecodedMessageFromServer result;
+
+    while (!quit.load()) {
+        if (error_counter >= max_error_count) {
+            nc_logger->error("Register, too many errors: {}, will exit now.", error_counter);
+            quit.store(true);
+            break;
+        }
+
+        try {
+            result = nc_send_msg_return_answer(init_message);
+
+            if (result.msg_type == NCServerMessageType::InitOK) {
+                nc_handle_init_ok(std::move(result.data), call_init);
+                return true;
+            }
+        } catch (std::exception &e) {
+            error_counter++;
+            nc_logger->error("Register, caught exception: {}", e.what());
+            std::this_thread::sleep_for(sleep_time);
+            continue;
+        }
+
+        if (result.msg_type == NCServerMessageType::Quit) {
+            nc_logger->info("Register, Quit from server, will exit now.");
+            quit.store(true);
+            break;
+        }
+
+        error_counter++;
+        nc_logger->error("Register, unexpected message: {}, error counter: {}", nc_type_to_string(result.msg_type), error_counter);
+        std::this_thread::sleep_for(sleep_time);
+    }
+
+    return false;
+}
+
+uint8_t NCNode::nc_handle_init_ok(std::vector<uint8_t> data, bool const call_init) {
+    /*
+    Use the negotiated capabilities and the node slot from the InitOK message
+    and give the init data to the data processor.
+
+    Returns the negotiated features.
+    */
+
+    // The negotiated capabilities and the node slot are followed by the init data:
+    NCInitResponse response = message_codec_intern->nc_decode_init_response(std::move(data));
+    message_codec_intern->nc_set_codec(response.negotiated.codec);
+    max_frame_size_intern.store(response.negotiated.max_frame_size);
+    features_intern.store(response.negotiated.features);
+    {
+        const std::lock_guard<std::mutex> lock(slot_mutex);
+        node_slot_intern = response.node_slot;
+        // The sequence numbers start at zero again:
+        num_cancelled_intern.store(0);
+    }
+    nc_logger->debug("Negotiated codec: {}, node slot: {}", nc_codec_to_byte(response.negotiated.codec),
+        response.node_slot.slot);
+
+    if (call_init) {
+        data_processor_intern->nc_init(std::move(response.init_data), node_id);
+    }
+
+    return response.negotiated.features;
+}
+
+void NCNode::nc_handle_cancel(std::vector<uint8_t> const& data, NCNodeSlot const node_slot) {
+    /*
+    The server doesn't need the results of its first tasks anymore, the tasks
+    that are not done yet are dropped and reported with a TasksCancelled message.
+
+    The Cancel message was the answer to a message of the given registration.
+    If the node has registered again in the meantime, the Cancel is ignored.
+    */
+
+    uint64_t num_tasks = 0;
+
+    try {
+        num_tasks = message_codec_intern->nc_decode_cancel(data);
+    } catch (std::exception &e) {
+        nc_logger->error("Invalid Cancel from server: {}", e.what());
+        return;
+    }
+
+    nc_logger->info("Cancel from server, stop the first {} tasks.", num_tasks);
+    const std::lock_guard<std::mutex> lock(slot_mutex);
+
+    if ((node_slot_intern == node_slot) && (num_tasks > num_cancelled_intern.load())) {
+        num_cancelled_intern.store(num_tasks);
+    }
 }
 
 [[nodiscard]] NCNodeID NCNode::nc_get_node_id() {
     return node_id;
 }
 
+[[nodiscard]] NCNodeSlot NCNode::nc_get_node_slot() {
+    const std::lock_guard<std::mutex> lock(slot_mutex);
+    return node_slot_intern;
+}
+
 [[nodiscard]] NCDecodedMessageFromServer NCNode::nc_send_msg_return_answer(NCEncodedMessageToServer const& message) {
+    if (message.data.size() > max_frame_size_intern.load()) {
+        throw NCMessageException("Message exceeds maximum frame size.");
+    }
+
     const std::lock_guard<std::mutex> lock(node_mutex);
     std::unique_ptr<NCNetworkSocketBase> socket = network_client_intern->nc_connect();
     socket->nc_send_data(message.data);
     NCEncodedMessageToNode message2;
     message2.data = socket->nc_receive_data();
-    return message_codec_intern->nc_decode_message_from_server(message2);
+    NCDecodedMessageFromServer result = message_codec_intern->nc_decode_message_from_server(message2);
+    nc_release_buffer(std::move(message2.data));
+    return result;
 }
 
-void NCNode::nc_send_heartbeat() {
+void NCNode::nc_send_heartbeat(NCEncodedMessageToServer const& init_message) {
+    /*
+    Send a heartbeat to the server every heartbeat_timeout seconds.
+
+    An evicted node registers again here, so it doesn't have to wait
+    for the next message of the workers.
+    */
+
     nc_logger->info("NCNode::nc_send_heartbeat() - starting heartbeat thread.");
     auto const sleep_time = std::chrono::seconds(config_intern.heartbeat_timeout);
-    auto const heartbeat_message = message_codec_intern->nc_gen_heartbeat_message(node_id);
     uint8_t error_counter = 0;
     NCDecodedMessageFromServer result;
 
@@ -228,8 +1017,18 @@ void NCNode::nc_send_heartbeat() {
             break;
         }
 
+        NCNodeSlot const node_slot = nc_get_node_slot();
+
+        if (node_slot == NCNodeSlot()) {
+            // Not registered yet, the first registration is done by the workers:
+            continue;
+        }
+
         try {
+            // Use the negotiated codec, if any:
+            auto heartbeat_message = message_codec_intern->nc_gen_heartbeat_message(node_slot);
             result = nc_send_msg_return_answer(heartbeat_message);
+            nc_release_buffer(std::move(heartbeat_message.data));
         } catch (std::exception &e) {
             error_counter++;
             nc_logger->error("HB, Caught exception: {}", e.what());
@@ -242,16 +1041,21 @@ void NCNode::nc_send_heartbeat() {
                 // Everything OK, nothing to do.
             break;
             case NCServerMessageType::InvalidNodeID:
-                // Invalid node id was sent to the server.
-                // This node hasn't registered yet to the server.
-                error_counter++;
-                nc_logger->error("HB, InvalidNodeID from server, error counter: {}", error_counter);
+                // Evicted after a heartbeat timeout, register again.
+                // The workers drop the tasks of the old registration:
+                nc_logger->error("HB, InvalidNodeID from server, register again.");
+                std::ignore = nc_register(init_message, node_slot, false);
             break;
             case NCServerMessageType::Quit:
                 // Job is done, so we can quit.
                 nc_logger->info("HB, Quit from server, will exit now.");
                 quit.store(true);
             break;
+            case NCServerMessageType::Cancel:
+                // The heartbeat is also accepted:
+                nc_logger->debug("HB, Cancel from server.");
+                nc_handle_cancel(result.data, node_slot);
+            break;
             default:
                 // Increase error_counter.
                 error_counter++;
@@ -25,8 +25,36 @@
 #include "nc_config.hpp"
 #include "nc_message.hpp"
 #include "nc_network.hpp"
+#include "nc_bounded_queue.hpp"
+#include "nc_thread_pool.hpp"
 
 namespace nodcru2 {
+// A task or its result in the node pipeline, the sequence number keeps the order of the server:
+struct NCNodeTask {
+    uint64_t sequence = 0;
+    std::vector<uint8_t> data = {};
+    // Dropped after a Cancel message, there is no result:
+    bool cancelled = false;
+    // The registration the task was received with, the sequence numbers start at zero for each one:
+    NCNodeSlot node_slot = {};
+};
+
+// Given to the data processor with each task, the processor can poll it and stop early:
+class NCCancellationToken {
+    public:
+        // True if the server has sent a Cancel message for this task:
+        [[nodiscard]] bool nc_is_cancelled() const noexcept;
+
+        // Constructor:
+        NCCancellationToken(std::atomic<uint64_t> const& num_cancelled, uint64_t const task_sequence);
+        // Never cancelled:
+        NCCancellationToken();
+
+    private:
+        std::atomic<uint64_t> const* num_cancelled_intern;
+        uint64_t task_sequence_intern;
+};
+
 class NCNodeDataProcessor {
     public:
         // Default special member functions:
@@ -37,9 +65,17 @@ class NCNodeDataProcessor {
         NCNodeDataProcessor& operator=(const NCNodeDataProcessor&) = default;
         NCNodeDataProcessor& operator=(NCNodeDataProcessor&&) = default;
 
-        // Must be implemented by the user:
+        // Must be implemented by the user.
+        // If the option num_workers is larger than one, nc_process_data() is called from several threads at the same time:
         virtual void nc_init(std::vector<uint8_t>, NCNodeID);
         [[nodiscard]] virtual std::vector<uint8_t> nc_process_data(std::vector<uint8_t>);
+        // Optional, reuses the result buffer of the node for each task:
+        virtual void nc_process_data_into(std::vector<uint8_t> data, std::vector<uint8_t>& result);
+        // Optional, for long tasks: poll the token and return early if it is cancelled, the result is dropped then:
+        virtual void nc_process_data_cancellable(std::vector<uint8_t> data, std::vector<uint8_t>& result,
+            NCCancellationToken const& token);
+        // Optional, short micro benchmark that is sent to the server, higher is faster:
+        [[nodiscard]] virtual uint32_t nc_benchmark();
 };
 
 class NCNode {
@@ -67,6 +103,7 @@ class NCNode {
         // API:
         void nc_run();
         [[nodiscard]] NCNodeID nc_get_node_id();
+        [[nodiscard]] NCNodeSlot nc_get_node_slot();
         void nc_set_logger(std::shared_ptr<spdlog::logger>);
 
     private:
@@ -80,9 +117,32 @@ class NCNode {
         std::unique_ptr<NCMessageCodecNode> message_codec_intern;
         std::unique_ptr<NCNetworkClientBase> network_client_intern;
         std::shared_ptr<NCNodeDataProcessor> data_processor_intern;
+        // Negotiated with the server in the Init / InitOK handshake:
+        std::atomic<uint32_t> max_frame_size_intern;
+        // Assigned by the server in the InitOK message, also used by the heartbeat thread:
+        NCNodeSlot node_slot_intern;
+        std::mutex slot_mutex;
+        // Negotiated optional protocol features:
+        std::atomic<uint8_t> features_intern;
+        // Only one thread registers the node again:
+        std::mutex register_mutex;
+        // The tasks of the current registration with a lower sequence number are cancelled,
+        // set by each thread that gets a Cancel message from the server:
+        std::atomic<uint64_t> num_cancelled_intern;
 
         [[nodiscard]] NCDecodedMessageFromServer nc_send_msg_return_answer(NCEncodedMessageToServer const&);
-        void nc_send_heartbeat();
+        void nc_send_heartbeat(NCEncodedMessageToServer const& init_message);
+        void nc_run_sequential(NCEncodedMessageToServer const& init_message);
+        void nc_run_pipelined(NCEncodedMessageToServer const& init_message);
+        void nc_compute_tasks(NCBoundedQueue<NCNodeTask>& tasks, NCBoundedQueue<NCNodeTask>& results);
+        void nc_fetch_tasks(NCEncodedMessageToServer const& init_message,
+            NCBoundedQueue<NCNodeTask>& tasks, NCBoundedQueue<NCNodeTask>& results);
+        void nc_upload_results(NCEncodedMessageToServer const& init_message,
+            NCBoundedQueue<NCNodeTask>& tasks, NCBoundedQueue<NCNodeTask>& results);
+        [[nodiscard]] bool nc_register(NCEncodedMessageToServer const& init_message, NCNodeSlot const old_slot,
+            bool const call_init);
+        uint8_t nc_handle_init_ok(std::vector<uint8_t> data, bool const call_init);
+        void nc_handle_cancel(std::vector<uint8_t> const& data, NCNodeSlot const node_slot);
 };
 }
 
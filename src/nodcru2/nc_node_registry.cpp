@@ -0,0 +1,218 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines the node registry of the server.
+*/
+
+// STD includes:
+#include <algorithm>
+
+// Local includes:
+#include "nc_node_registry.hpp"
+#include "nc_exceptions.hpp"
+
+namespace nodcru2 {
+NCNodeRegistry::NCNodeRegistry(std::chrono::steady_clock::duration const reuse_delay):
+    segments_intern(),
+    size_intern(0),
+    node_slots_intern(),
+    free_slots_intern(),
+    reuse_delay_intern(reuse_delay),
+    register_mutex()
+    {}
+
+NCNodeRegistry::~NCNodeRegistry() {
+    for (auto& segment: segments_intern) {
+        delete[] segment.load();
+    }
+}
+
+[[nodiscard]] NCNodeSlot NCNodeRegistry::nc_register(NCNodeID const& node_id) {
+    /*
+    Register a node and return its slot and a new session token.
+
+    Old messages of a node that registers again are rejected since the token changes.
+    New slots are published with a release store, so that a lock free reader
+    always sees a fully initialized entry.
+    */
+
+    uint64_t const token = nc_gen_session_token();
+    auto const current_time = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::rep const node_time = current_time.time_since_epoch().count();
+
+    const std::lock_guard<std::mutex> lock(register_mutex);
+    auto const item = node_slots_intern.find(node_id);
+
+    if (item != node_slots_intern.end()) {
+        NCRegistryEntry* const entry = nc_get_entry(NCNodeSlot{item->second, 0});
+        entry->detector.nc_reset(current_time);
+        entry->batch_size.store(1, std::memory_order_relaxed);
+        entry->node_time.store(node_time, std::memory_order_relaxed);
+        entry->token.store(token, std::memory_order_release);
+        return NCNodeSlot{item->second, token};
+    }
+
+    if (!free_slots_intern.empty() && (current_time - free_slots_intern.front().second >= reuse_delay_intern)) {
+        // Reuse the slot of an evicted node:
+        uint32_t const slot = free_slots_intern.front().first;
+        free_slots_intern.pop_front();
+
+        NCRegistryEntry* const entry = nc_get_entry(NCNodeSlot{slot, 0});
+        entry->node_id.store(std::make_shared<NCNodeID const>(node_id), std::memory_order_release);
+        entry->detector.nc_reset(current_time);
+        entry->batch_size.store(1, std::memory_order_relaxed);
+        entry->node_time.store(node_time, std::memory_order_relaxed);
+        entry->token.store(token, std::memory_order_release);
+        node_slots_intern[node_id] = slot;
+        return NCNodeSlot{slot, token};
+    }
+
+    uint32_t const slot = size_intern.load(std::memory_order_relaxed);
+    size_t const segment_index = slot / NC_REGISTRY_SEGMENT_SIZE;
+
+    if (segment_index >= NC_REGISTRY_MAX_SEGMENTS) {
+        throw NCServerException("Too many nodes.");
+    }
+
+    NCRegistryEntry* segment = segments_intern[segment_index].load(std::memory_order_relaxed);
+
+    if (segment == nullptr) {
+        segment = new NCRegistryEntry[NC_REGISTRY_SEGMENT_SIZE];
+        segments_intern[segment_index].store(segment, std::memory_order_release);
+    }
+
+    NCRegistryEntry& entry = segment[slot % NC_REGISTRY_SEGMENT_SIZE];
+    entry.node_id.store(std::make_shared<NCNodeID const>(node_id), std::memory_order_relaxed);
+    entry.detector.nc_reset(current_time);
+    entry.batch_size.store(1, std::memory_order_relaxed);
+    entry.node_time.store(node_time, std::memory_order_relaxed);
+    entry.token.store(token, std::memory_order_relaxed);
+    node_slots_intern[node_id] = slot;
+    size_intern.store(slot + 1, std::memory_order_release);
+
+    return NCNodeSlot{slot, token};
+}
+
+[[nodiscard]] NCRegistryEntry* NCNodeRegistry::nc_get_entry(NCNodeSlot const node_slot) const {
+    if (node_slot.slot >= size_intern.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+
+    NCRegistryEntry* const segment = segments_intern[node_slot.slot / NC_REGISTRY_SEGMENT_SIZE].load(std::memory_order_acquire);
+    return &segment[node_slot.slot % NC_REGISTRY_SEGMENT_SIZE];
+}
+
+[[nodiscard]] std::optional<NCNodeID> NCNodeRegistry::nc_find(NCNodeSlot const node_slot) const {
+    NCRegistryEntry const* const entry = nc_get_entry(node_slot);
+
+    // A free slot has the token zero:
+    if ((entry == nullptr) || (node_slot.token == 0) ||
+        (entry->token.load(std::memory_order_acquire) != node_slot.token)) {
+        return std::nullopt;
+    }
+
+    std::shared_ptr<NCNodeID const> const node_id = entry->node_id.load(std::memory_order_acquire);
+
+    // The slot may have been reused in between. A new node id is only stored after
+    // the old token has been cleared, so the token check fails in that case:
+    if (entry->token.load(std::memory_order_acquire) != node_slot.token) {
+        return std::nullopt;
+    }
+
+    return *node_id;
+}
+
+bool NCNodeRegistry::nc_update_time(NCNodeSlot const node_slot) {
+    NCRegistryEntry* const entry = nc_get_entry(node_slot);
+
+    if ((entry == nullptr) || (node_slot.token == 0) ||
+        (entry->token.load(std::memory_order_acquire) != node_slot.token)) {
+        return false;
+    }
+
+    auto const current_time = std::chrono::steady_clock::now();
+    entry->detector.nc_heartbeat(current_time);
+    entry->node_time.store(current_time.time_since_epoch().count(), std::memory_order_relaxed);
+    return true;
+}
+
+bool NCNodeRegistry::nc_set_batch_size(NCNodeSlot const node_slot, uint32_t const batch_size) {
+    NCRegistryEntry* const entry = nc_get_entry(node_slot);
+
+    if ((entry == nullptr) || (node_slot.token == 0) ||
+        (entry->token.load(std::memory_order_acquire) != node_slot.token)) {
+        return false;
+    }
+
+    entry->batch_size.store(std::max(batch_size, uint32_t(1)), std::memory_order_relaxed);
+    return true;
+}
+
+[[nodiscard]] uint32_t NCNodeRegistry::nc_batch_size(NCNodeSlot const node_slot) const {
+    NCRegistryEntry const* const entry = nc_get_entry(node_slot);
+
+    if ((entry == nullptr) || (node_slot.token == 0) ||
+        (entry->token.load(std::memory_order_acquire) != node_slot.token)) {
+        return 1;
+    }
+
+    return entry->batch_size.load(std::memory_order_relaxed);
+}
+
+[[nodiscard]] std::chrono::steady_clock::time_point NCNodeRegistry::nc_last_contact(uint32_t const slot) const {
+    NCRegistryEntry const* const entry = nc_get_entry(NCNodeSlot{slot, 0});
+
+    if (entry == nullptr) {
+        return std::chrono::steady_clock::time_point();
+    }
+
+    return std::chrono::steady_clock::time_point(
+        std::chrono::steady_clock::duration(entry->node_time.load(std::memory_order_relaxed)));
+}
+
+[[nodiscard]] std::chrono::steady_clock::duration NCNodeRegistry::nc_suspect_after(uint32_t const slot,
+    double const phi_threshold, std::chrono::steady_clock::duration const timeout) const {
+    NCRegistryEntry const* const entry = nc_get_entry(NCNodeSlot{slot, 0});
+
+    if ((entry == nullptr) || (phi_threshold <= 0.0)) {
+        return timeout;
+    }
+
+    return std::max(entry->detector.nc_suspect_after(phi_threshold).value_or(timeout), timeout);
+}
+
+[[nodiscard]] std::optional<NCNodeID> NCNodeRegistry::nc_evict(uint32_t const slot) {
+    /*
+    Free the slot, all following messages with the old token are rejected.
+
+    The node has to register again with an Init message.
+    */
+
+    const std::lock_guard<std::mutex> lock(register_mutex);
+    NCRegistryEntry* const entry = nc_get_entry(NCNodeSlot{slot, 0});
+
+    if ((entry == nullptr) || (entry->token.load(std::memory_order_relaxed) == 0)) {
+        return std::nullopt;
+    }
+
+    entry->token.store(0, std::memory_order_release);
+    // Only changed under the lock:
+    NCNodeID const node_id = *entry->node_id.load(std::memory_order_relaxed);
+    node_slots_intern.erase(node_id);
+    free_slots_intern.emplace_back(slot, std::chrono::steady_clock::now());
+
+    return node_id;
+}
+
+[[nodiscard]] uint32_t NCNodeRegistry::nc_size() const noexcept {
+    return size_intern.load(std::memory_order_acquire);
+}
+
+[[nodiscard]] size_t NCNodeRegistry::nc_num_nodes() {
+    const std::lock_guard<std::mutex> lock(register_mutex);
+    return node_slots_intern.size();
+}
+}
@@ -0,0 +1,122 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines the node registry of the server.
+
+    Each registered node has an entry, indexed by its node slot. The entries
+    are stored in segments of fixed size that never move, so a lookup and a
+    timestamp update are lock free (atomic loads and stores).
+    Only the registration and the eviction of a node take a lock.
+    A heartbeat also takes the lock of the failure detector of its node,
+    which is only shared with the heartbeat check.
+    The node id of an entry is immutable, a reused slot gets a new one that
+    is published atomically, so a lookup never reads an id while it is
+    written. The slot of an evicted node is only reused after a delay.
+*/
+
+#ifndef FILE_NC_NODE_REGISTRY_HPP_INCLUDED
+#define FILE_NC_NODE_REGISTRY_HPP_INCLUDED
+
+// STD includes:
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <unordered_map>
+#include <deque>
+#include <optional>
+#include <memory>
+
+// Local includes:
+#include "nc_nodeid.hpp"
+#include "nc_failure_detector.hpp"
+
+namespace nodcru2 {
+// Number of entries per segment and maximum number of segments:
+size_t const NC_REGISTRY_SEGMENT_SIZE = 1024;
+size_t const NC_REGISTRY_MAX_SEGMENTS = 1024;
+
+struct NCRegistryEntry {
+    // Published before the token, replaced when an evicted slot is reused:
+    std::atomic<std::shared_ptr<NCNodeID const>> node_id;
+    // Zero if the slot is free:
+    std::atomic<uint64_t> token;
+    // Last contact, std::chrono::steady_clock ticks:
+    std::atomic<std::chrono::steady_clock::rep> node_time;
+    // Learns the heartbeat inter-arrival times of the node:
+    NCPhiAccrualDetector detector;
+    // Maximum number of tasks the node asks for in one request:
+    std::atomic<uint32_t> batch_size;
+};
+
+class NCNodeRegistry {
+    public:
+        // Returns the slot and a new session token for this node.
+        // A node that registers again keeps its slot:
+        [[nodiscard]] NCNodeSlot nc_register(NCNodeID const& node_id);
+
+        // Lock free, returns no value if the slot or the token is invalid.
+        // Returns a copy, the slot may be reused by another node later on:
+        [[nodiscard]] std::optional<NCNodeID> nc_find(NCNodeSlot const node_slot) const;
+
+        // Returns false if the slot or the token is invalid.
+        // Only heartbeats should update the time, they are learned by the failure detector:
+        bool nc_update_time(NCNodeSlot const node_slot);
+
+        // Returns false if the slot or the token is invalid:
+        bool nc_set_batch_size(NCNodeSlot const node_slot, uint32_t const batch_size);
+        // Lock free, one if the slot or the token is invalid:
+        [[nodiscard]] uint32_t nc_batch_size(NCNodeSlot const node_slot) const;
+
+        // Lock free, the last contact of the node in the given slot:
+        [[nodiscard]] std::chrono::steady_clock::time_point nc_last_contact(uint32_t const slot) const;
+
+        // Time after the last contact when the node in the given slot is suspected to be dead.
+        // Never less than the timeout, the detector only allows more time for irregular heartbeats
+        // (a heartbeat may wait behind a slow message of the node).
+        // Falls back to the timeout if the detector is disabled (threshold zero) or has not enough samples:
+        [[nodiscard]] std::chrono::steady_clock::duration nc_suspect_after(uint32_t const slot,
+            double const phi_threshold, std::chrono::steady_clock::duration const timeout) const;
+
+        // Remove the node in the given slot, returns its node id
+        // or nothing if the slot is already free:
+        [[nodiscard]] std::optional<NCNodeID> nc_evict(uint32_t const slot);
+
+        // Number of used slots, including the free ones:
+        [[nodiscard]] uint32_t nc_size() const noexcept;
+        // Number of registered nodes:
+        [[nodiscard]] size_t nc_num_nodes();
+
+        // Constructor:
+        NCNodeRegistry(std::chrono::steady_clock::duration const reuse_delay);
+
+        // Destructor:
+        ~NCNodeRegistry();
+
+        // Disable all other special member functions:
+        NCNodeRegistry() = delete;
+        NCNodeRegistry(const NCNodeRegistry&) = delete;
+        NCNodeRegistry& operator=(const NCNodeRegistry&) = delete;
+        NCNodeRegistry(NCNodeRegistry&&) = delete;
+        NCNodeRegistry& operator=(NCNodeRegistry&&) = delete;
+
+    private:
+        std::array<std::atomic<NCRegistryEntry*>, NC_REGISTRY_MAX_SEGMENTS> segments_intern;
+        // Number of published slots:
+        std::atomic<uint32_t> size_intern;
+        // Only used in nc_register() and nc_evict():
+        std::unordered_map<NCNodeID, uint32_t> node_slots_intern;
+        // Evicted slots and the time of the eviction, oldest first:
+        std::deque<std::pair<uint32_t, std::chrono::steady_clock::time_point>> free_slots_intern;
+        std::chrono::steady_clock::duration reuse_delay_intern;
+        std::mutex register_mutex;
+
+        [[nodiscard]] NCRegistryEntry* nc_get_entry(NCNodeSlot const node_slot) const;
+};
+}
+
+#endif // FILE_NC_NODE_REGISTRY_HPP_INCLUDED
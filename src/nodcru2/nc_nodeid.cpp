@@ -9,6 +9,10 @@
     node ID is send to the server. Each message from the node to the server
     contains this unique node id. If the node ID is unknown to the server,
     it sends an error to the node.
+
+    The server assigns each registered node a slot and a random session token
+    in the InitOK message. All following messages only contain the slot and
+    the token instead of the node ID.
 */
 // STD includes:
 #include <random>
@@ -16,23 +20,48 @@
 
 // Local includes:
 #include "nc_nodeid.hpp"
+#include "nc_util.hpp"
+#include "nc_exceptions.hpp"
 
 namespace nodcru2 {
 const std::string NC_CHARACTERS = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
-std::random_device nc_rd;
-std::mt19937 nc_gen(nc_rd());
-std::uniform_int_distribution nc_dis(0, static_cast<int32_t>(NC_CHARACTERS.size()) - 1);
+
+// One generator per thread, the server creates session tokens from many threads:
+thread_local std::mt19937_64 nc_gen(std::random_device{}());
 
 NCNodeID::NCNodeID(): id(gen_id()) {}
 
 [[nodiscard]] std::string NCNodeID::gen_id() {
+    std::uniform_int_distribution<size_t> dis(0, NC_CHARACTERS.size() - 1);
     std::string result;
     result.reserve(NC_NODEID_LENGTH);
 
     for (size_t i = 0; i < NC_NODEID_LENGTH; i++) {
-        result += NC_CHARACTERS[static_cast<size_t>(nc_dis(nc_gen))];
+        result += NC_CHARACTERS[dis(nc_gen)];
+    }
+
+    return result;
+}
+
+[[nodiscard]] uint64_t nc_gen_session_token() {
+    std::uniform_int_distribution<uint64_t> dis(1, UINT64_MAX);
+    return dis(nc_gen);
+}
+
+void nc_encode_node_slot(NCNodeSlot const node_slot, std::span<uint8_t> bytes) noexcept {
+    nc_to_big_endian_bytes(node_slot.slot, bytes.subspan(0, 4));
+    nc_to_big_endian_bytes64(node_slot.token, bytes.subspan(4, 8));
+}
+
+[[nodiscard]] NCNodeSlot nc_decode_node_slot(std::span<const uint8_t> const bytes) {
+    if (bytes.size() < NC_NODE_SLOT_LENGTH) {
+        throw NCMessageException("Node slot too short.");
     }
 
+    NCNodeSlot result;
+    result.slot = nc_from_big_endian_bytes(bytes.subspan(0, 4));
+    result.token = nc_from_big_endian_bytes64(bytes.subspan(4, 8));
+
     return result;
 }
 }
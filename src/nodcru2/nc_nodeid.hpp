@@ -9,14 +9,19 @@
     node ID is send to the server. Each message from the node to the server
     contains this unique node id. If the node ID is unknown to the server,
     it sends an error to the node.
+
+    The server assigns each registered node a slot and a random session token
+    in the InitOK message. All following messages only contain the slot and
+    the token instead of the node ID.
 */
 
 #ifndef FILE_NC_NODEID_HPP_INCLUDED
 #define FILE_NC_NODEID_HPP_INCLUDED
 
 // STD includes:
+#include <cstdint>
 #include <string>
-#include <random>
+#include <span>
 
 // External includes:
 #include <spdlog/spdlog.h>
@@ -33,6 +38,27 @@ class NCNodeID {
     private:
         std::string gen_id();
 };
+
+// No slot assigned yet:
+uint32_t const NC_INVALID_SLOT = UINT32_MAX;
+// Slot (4 bytes), session token (8 bytes):
+size_t const NC_NODE_SLOT_LENGTH = 4 + 8;
+
+struct NCNodeSlot {
+    // Index into the node table of the server:
+    uint32_t slot = NC_INVALID_SLOT;
+    // Random, so that an old or forged slot is rejected:
+    uint64_t token = 0;
+
+    bool operator==(const NCNodeSlot&) const = default;
+};
+
+// Never returns zero:
+[[nodiscard]] uint64_t nc_gen_session_token();
+
+void nc_encode_node_slot(NCNodeSlot const node_slot, std::span<uint8_t> bytes) noexcept;
+
+[[nodiscard]] NCNodeSlot nc_decode_node_slot(std::span<const uint8_t> const bytes);
 }
 
 // From cpp ref: https://en.cppreference.com/w/cpp/utility/hash.html
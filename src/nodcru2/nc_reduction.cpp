@@ -0,0 +1,28 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines the reduction processor for the server.
+*/
+
+// STD includes:
+#include <atomic>
+
+// Local includes:
+#include "nc_reduction.hpp"
+
+namespace nodcru2 {
+[[nodiscard]] size_t nc_worker_index() noexcept {
+    /*
+    Each thread gets the next index when it calls this for the first time.
+
+    The server threads are long lived, so the indices stay small.
+    */
+
+    static std::atomic<size_t> next_index = 0;
+    thread_local size_t const index = next_index.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+}
@@ -0,0 +1,207 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines the reduction processor for the server.
+
+    Many jobs only reduce the results (sums, histograms, minimum / maximum).
+    The reduction processor folds each result into a partial accumulator
+    of the current server thread, so the results are reduced in parallel
+    without a global lock. The partial accumulators are combined when the
+    server saves the data.
+*/
+
+#ifndef FILE_NC_REDUCTION_HPP_INCLUDED
+#define FILE_NC_REDUCTION_HPP_INCLUDED
+
+// STD includes:
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <span>
+#include <mutex>
+#include <optional>
+#include <functional>
+#include <algorithm>
+#include <thread>
+#include <type_traits>
+
+// Local includes:
+#include "nc_server.hpp"
+#include "nc_exceptions.hpp"
+#include "nc_buffer_pool.hpp"
+
+namespace nodcru2 {
+// Small dense index of the calling thread, used to pick its partial accumulator:
+[[nodiscard]] size_t nc_worker_index() noexcept;
+
+template <typename AccT>
+struct alignas(64) NCPartialAccumulator {
+    std::mutex partial_mutex;
+    std::optional<AccT> value;
+};
+
+template <typename AccT>
+class NCReductionServerProcessor: public NCServerDataProcessor {
+    public:
+        // Constructor:
+        NCReductionServerProcessor():
+            NCServerDataProcessor(),
+            partials_intern(std::max(std::thread::hardware_concurrency(), 1u))
+            {}
+
+        // Destructor:
+        virtual ~NCReductionServerProcessor() = default;
+
+        // Disable all other special member functions:
+        NCReductionServerProcessor(NCReductionServerProcessor&&) = delete;
+        NCReductionServerProcessor(const NCReductionServerProcessor&) = delete;
+        NCReductionServerProcessor& operator=(const NCReductionServerProcessor&) = delete;
+        NCReductionServerProcessor& operator=(NCReductionServerProcessor&&) = delete;
+
+        // Must be implemented by the user:
+        [[nodiscard]] virtual AccT nc_identity() = 0;
+        // Called in parallel, but never for the same partial accumulator at the same time:
+        virtual void nc_fold_result(AccT& partial, NCNodeID node_id, std::span<const uint8_t> const result) = 0;
+        virtual void nc_combine(AccT& total, AccT const& partial) = 0;
+        virtual void nc_save_reduction(AccT const& total) = 0;
+
+        // Called by the server:
+        void nc_process_result(NCNodeID node_id, std::vector<uint8_t> result) final {
+            NCPartialAccumulator<AccT>& partial = partials_intern[nc_worker_index() % partials_intern.size()];
+
+            {
+                // Only contended if there are more server threads than partial accumulators:
+                const std::lock_guard<std::mutex> lock(partial.partial_mutex);
+
+                if (!partial.value) {
+                    partial.value = nc_identity();
+                }
+
+                nc_fold_result(*partial.value, node_id, result);
+            }
+
+            nc_release_buffer(std::move(result));
+        }
+
+        void nc_save_data() final {
+            nc_save_reduction(nc_get_reduction());
+        }
+
+        // Combine all partial accumulators, can also be called while the server is running:
+        [[nodiscard]] AccT nc_get_reduction() {
+            AccT total = nc_identity();
+
+            for (auto& partial: partials_intern) {
+                const std::lock_guard<std::mutex> lock(partial.partial_mutex);
+
+                if (partial.value) {
+                    nc_combine(total, *partial.value);
+                }
+            }
+
+            return total;
+        }
+
+    private:
+        std::vector<NCPartialAccumulator<AccT>> partials_intern;
+};
+
+template <typename T>
+struct NCMinimum {
+    [[nodiscard]] constexpr T operator()(T const a, T const b) const {
+        return std::min(a, b);
+    }
+};
+
+template <typename T>
+struct NCMaximum {
+    [[nodiscard]] constexpr T operator()(T const a, T const b) const {
+        return std::max(a, b);
+    }
+};
+
+template <typename T, typename Op>
+requires std::is_arithmetic_v<T>
+void nc_reduce_array(std::vector<T>& total, std::span<const T> const values, Op const op) {
+    /*
+    Element wise reduction, values beyond the current size are appended.
+
+    The loop has no dependencies between the elements, so the compiler
+    vectorizes it (SIMD) for the built in operations.
+    */
+
+    size_t const common = std::min(total.size(), values.size());
+    T* const target = total.data();
+    T const* const source = values.data();
+
+    for (size_t i = 0; i < common; i++) {
+        target[i] = op(target[i], source[i]);
+    }
+
+    total.insert(total.end(), values.begin() + static_cast<std::ptrdiff_t>(common), values.end());
+}
+
+template <typename T, typename Op>
+requires std::is_arithmetic_v<T>
+void nc_reduce_array(std::vector<T>& total, std::span<const uint8_t> const values, Op const op) {
+    /*
+    The values are a plain array of T in native byte order.
+
+    The buffer may not be aligned for T, so each element is copied.
+    The copies are merged into the vector loads by the compiler.
+    */
+
+    if ((values.size() % sizeof(T)) != 0) {
+        throw NCMessageException("Result size is not a multiple of the element size.");
+    }
+
+    size_t const num_values = values.size() / sizeof(T);
+    size_t const common = std::min(total.size(), num_values);
+    total.resize(std::max(total.size(), num_values));
+    T* const target = total.data();
+    uint8_t const* const source = values.data();
+
+    for (size_t i = 0; i < common; i++) {
+        T value;
+        std::memcpy(&value, source + (i * sizeof(T)), sizeof(T));
+        target[i] = op(target[i], value);
+    }
+
+    if (num_values > common) {
+        std::memcpy(target + common, source + (common * sizeof(T)), (num_values - common) * sizeof(T));
+    }
+}
+
+// Reduces results that are plain arrays of T element wise, e.g. sums or histograms:
+template <typename T, typename Op>
+requires std::is_arithmetic_v<T>
+class NCArrayReductionProcessor: public NCReductionServerProcessor<std::vector<T>> {
+    public:
+        [[nodiscard]] std::vector<T> nc_identity() override {
+            return std::vector<T>();
+        }
+
+        void nc_fold_result(std::vector<T>& partial, [[maybe_unused]] NCNodeID node_id,
+            std::span<const uint8_t> const result) override {
+            nc_reduce_array(partial, result, Op());
+        }
+
+        void nc_combine(std::vector<T>& total, std::vector<T> const& partial) override {
+            nc_reduce_array(total, std::span<const T>(partial), Op());
+        }
+};
+
+template <typename T>
+using NCSumReductionProcessor = NCArrayReductionProcessor<T, std::plus<T>>;
+
+template <typename T>
+using NCMinReductionProcessor = NCArrayReductionProcessor<T, NCMinimum<T>>;
+
+template <typename T>
+using NCMaxReductionProcessor = NCArrayReductionProcessor<T, NCMaximum<T>>;
+}
+
+#endif // FILE_NC_REDUCTION_HPP_INCLUDED
@@ -0,0 +1,95 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines the serialization of work items and results.
+*/
+
+// STD includes:
+#include <bit>
+
+// Local includes:
+#include "nc_serializer.hpp"
+
+namespace nodcru2 {
+// The first byte of each buffer:
+uint8_t const NC_LITTLE_ENDIAN_TAG = 1;
+uint8_t const NC_BIG_ENDIAN_TAG = 2;
+
+[[nodiscard]] static uint8_t nc_native_endian_tag() noexcept {
+    if constexpr (std::endian::native == std::endian::little) {
+        return NC_LITTLE_ENDIAN_TAG;
+    } else {
+        return NC_BIG_ENDIAN_TAG;
+    }
+}
+
+NCBinaryWriter::NCBinaryWriter():
+    data_intern(1, nc_native_endian_tag())
+    {}
+
+NCBinaryWriter::NCBinaryWriter(size_t const capacity):
+    NCBinaryWriter()
+    {
+        data_intern.reserve(capacity + 1);
+    }
+
+[[nodiscard]] std::vector<uint8_t> NCBinaryWriter::nc_get_data() {
+    std::vector<uint8_t> result = std::move(data_intern);
+    data_intern = std::vector<uint8_t>(1, nc_native_endian_tag());
+    return result;
+}
+
+void NCBinaryWriter::nc_align(size_t const alignment) {
+    size_t const padding = (alignment - (data_intern.size() % alignment)) % alignment;
+    data_intern.resize(data_intern.size() + padding, 0);
+}
+
+void NCBinaryWriter::nc_write_bytes(void const* source, size_t const size) {
+    size_t const position = data_intern.size();
+    data_intern.resize(position + size);
+
+    if (size > 0) {
+        std::memcpy(data_intern.data() + position, source, size);
+    }
+}
+
+NCBinaryReader::NCBinaryReader(std::span<const uint8_t> const data):
+    data_intern(data),
+    position_intern(1)
+    {
+        if (data_intern.empty()) {
+            throw NCSerializerException("Empty buffer.");
+        }
+
+        if (data_intern[0] != nc_native_endian_tag()) {
+            throw NCSerializerException("Byte order does not match.");
+        }
+    }
+
+[[nodiscard]] bool NCBinaryReader::nc_at_end() const noexcept {
+    return position_intern >= data_intern.size();
+}
+
+void NCBinaryReader::nc_align(size_t const alignment) {
+    size_t const padding = (alignment - (position_intern % alignment)) % alignment;
+
+    if (padding > data_intern.size() - position_intern) {
+        throw NCSerializerException("Unexpected end of buffer.");
+    }
+
+    position_intern += padding;
+}
+
+[[nodiscard]] std::span<const uint8_t> NCBinaryReader::nc_take(size_t const size) {
+    if (size > data_intern.size() - position_intern) {
+        throw NCSerializerException("Unexpected end of buffer.");
+    }
+
+    std::span<const uint8_t> const result = data_intern.subspan(position_intern, size);
+    position_intern += size;
+    return result;
+}
+}
@@ -0,0 +1,242 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines the serialization of work items and results.
+
+    The built in binary format stores all values in native byte order and
+    aligns each value to its natural alignment inside the buffer. Arrays
+    can then be decoded as views (std::span) into the received buffer
+    without copying them.
+    The first byte of the buffer marks the byte order, so that a node with
+    a different byte order is detected.
+*/
+
+#ifndef FILE_NC_SERIALIZER_HPP_INCLUDED
+#define FILE_NC_SERIALIZER_HPP_INCLUDED
+
+// STD includes:
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <span>
+#include <concepts>
+#include <type_traits>
+
+// Local includes:
+#include "nc_exceptions.hpp"
+
+namespace nodcru2 {
+// A serializer converts a value of type T into bytes and back:
+template <typename S, typename T>
+concept NCSerializer = requires(S const serializer, T const& value, std::span<const uint8_t> const data) {
+    { serializer.nc_serialize(value) } -> std::same_as<std::vector<uint8_t>>;
+    { serializer.nc_deserialize(data) } -> std::convertible_to<T>;
+};
+
+template <typename T>
+concept NCTriviallyCopyable = std::is_trivially_copyable_v<T>;
+
+class NCBinaryWriter {
+    public:
+        template <NCTriviallyCopyable T>
+        void nc_write(T const& value);
+
+        template <NCTriviallyCopyable T, size_t N>
+        void nc_write(std::span<T, N> const values);
+
+        template <NCTriviallyCopyable T>
+        void nc_write(std::vector<T> const& values);
+
+        template <NCTriviallyCopyable T>
+        void nc_write(std::vector<std::vector<T>> const& values);
+
+        // Returns the buffer, the writer is empty afterwards:
+        [[nodiscard]] std::vector<uint8_t> nc_get_data();
+
+        // Constructor:
+        NCBinaryWriter();
+        NCBinaryWriter(size_t const capacity);
+
+        // Default special member functions:
+        NCBinaryWriter(NCBinaryWriter&&) = default;
+        NCBinaryWriter(const NCBinaryWriter&) = default;
+        NCBinaryWriter& operator=(const NCBinaryWriter&) = default;
+        NCBinaryWriter& operator=(NCBinaryWriter&&) = default;
+
+    private:
+        std::vector<uint8_t> data_intern;
+
+        void nc_align(size_t const alignment);
+        void nc_write_bytes(void const* source, size_t const size);
+};
+
+class NCBinaryReader {
+    public:
+        template <NCTriviallyCopyable T>
+        [[nodiscard]] T nc_read();
+
+        // The span points into the buffer given in the constructor:
+        template <NCTriviallyCopyable T>
+        [[nodiscard]] std::span<const T> nc_read_span();
+
+        template <NCTriviallyCopyable T>
+        [[nodiscard]] std::vector<T> nc_read_vector();
+
+        template <NCTriviallyCopyable T>
+        [[nodiscard]] std::vector<std::span<const T>> nc_read_nested();
+
+        [[nodiscard]] bool nc_at_end() const noexcept;
+
+        // Constructor:
+        NCBinaryReader(std::span<const uint8_t> const data);
+
+        // Default special member functions:
+        NCBinaryReader(NCBinaryReader&&) = default;
+        NCBinaryReader(const NCBinaryReader&) = default;
+        NCBinaryReader& operator=(const NCBinaryReader&) = default;
+        NCBinaryReader& operator=(NCBinaryReader&&) = default;
+
+        // Disable all other special member functions:
+        NCBinaryReader() = delete;
+
+    private:
+        std::span<const uint8_t> data_intern;
+        size_t position_intern;
+
+        void nc_align(size_t const alignment);
+        [[nodiscard]] std::span<const uint8_t> nc_take(size_t const size);
+};
+
+// The built in serializer:
+template <typename T>
+struct NCBinarySerializer;
+
+// For trivially copyable types:
+template <NCTriviallyCopyable T>
+struct NCBinarySerializer<T> {
+    [[nodiscard]] std::vector<uint8_t> nc_serialize(T const& value) const {
+        NCBinaryWriter writer(sizeof(T) + alignof(T));
+        writer.nc_write(value);
+        return writer.nc_get_data();
+    }
+
+    [[nodiscard]] T nc_deserialize(std::span<const uint8_t> const data) const {
+        NCBinaryReader reader(data);
+        return reader.nc_read<T>();
+    }
+};
+
+// And for vectors of trivially copyable types:
+template <NCTriviallyCopyable T>
+struct NCBinarySerializer<std::vector<T>> {
+    [[nodiscard]] std::vector<uint8_t> nc_serialize(std::vector<T> const& values) const {
+        NCBinaryWriter writer(sizeof(uint64_t) + (values.size() * sizeof(T)) + alignof(T));
+        writer.nc_write(values);
+        return writer.nc_get_data();
+    }
+
+    [[nodiscard]] std::vector<T> nc_deserialize(std::span<const uint8_t> const data) const {
+        NCBinaryReader reader(data);
+        return reader.nc_read_vector<T>();
+    }
+
+    // Without copy, the data must outlive the returned span:
+    [[nodiscard]] std::span<const T> nc_deserialize_view(std::span<const uint8_t> const data) const {
+        NCBinaryReader reader(data);
+        return reader.nc_read_span<T>();
+    }
+};
+
+template <NCTriviallyCopyable T>
+void NCBinaryWriter::nc_write(T const& value) {
+    nc_align(alignof(T));
+    nc_write_bytes(&value, sizeof(T));
+}
+
+template <NCTriviallyCopyable T, size_t N>
+void NCBinaryWriter::nc_write(std::span<T, N> const values) {
+    nc_write(static_cast<uint64_t>(values.size()));
+    nc_align(alignof(T));
+    nc_write_bytes(values.data(), values.size_bytes());
+}
+
+template <NCTriviallyCopyable T>
+void NCBinaryWriter::nc_write(std::vector<T> const& values) {
+    nc_write(std::span<const T>(values));
+}
+
+template <NCTriviallyCopyable T>
+void NCBinaryWriter::nc_write(std::vector<std::vector<T>> const& values) {
+    nc_write(static_cast<uint64_t>(values.size()));
+
+    for (auto const& inner: values) {
+        nc_write(inner);
+    }
+}
+
+template <NCTriviallyCopyable T>
+[[nodiscard]] T NCBinaryReader::nc_read() {
+    nc_align(alignof(T));
+    std::span<const uint8_t> const bytes = nc_take(sizeof(T));
+
+    T result;
+    std::memcpy(&result, bytes.data(), sizeof(T));
+    return result;
+}
+
+template <NCTriviallyCopyable T>
+[[nodiscard]] std::span<const T> NCBinaryReader::nc_read_span() {
+    /*
+    Return a view into the buffer, no data is copied.
+
+    The writer has aligned the values relative to the start of the buffer,
+    so the buffer itself must be suitably aligned (std::vector is).
+    */
+
+    uint64_t const count = nc_read<uint64_t>();
+    nc_align(alignof(T));
+
+    if (count > (data_intern.size() - position_intern) / sizeof(T)) {
+        throw NCSerializerException("Array too long.");
+    }
+
+    std::span<const uint8_t> const bytes = nc_take(static_cast<size_t>(count) * sizeof(T));
+
+    if (reinterpret_cast<std::uintptr_t>(bytes.data()) % alignof(T) != 0) {
+        throw NCSerializerException("Buffer not aligned.");
+    }
+
+    T const* const begin = static_cast<T const*>(static_cast<void const*>(bytes.data()));
+    return std::span<const T>(begin, static_cast<size_t>(count));
+}
+
+template <NCTriviallyCopyable T>
+[[nodiscard]] std::vector<T> NCBinaryReader::nc_read_vector() {
+    std::span<const T> const values = nc_read_span<T>();
+    return std::vector<T>(values.begin(), values.end());
+}
+
+template <NCTriviallyCopyable T>
+[[nodiscard]] std::vector<std::span<const T>> NCBinaryReader::nc_read_nested() {
+    uint64_t const count = nc_read<uint64_t>();
+
+    // Each inner array needs at least its length:
+    if (count > (data_intern.size() - position_intern) / sizeof(uint64_t)) {
+        throw NCSerializerException("Array too long.");
+    }
+
+    std::vector<std::span<const T>> result;
+    result.reserve(static_cast<size_t>(count));
+
+    for (uint64_t i = 0; i < count; i++) {
+        result.push_back(nc_read_span<T>());
+    }
+
+    return result;
+}
+}
+
+#endif // FILE_NC_SERIALIZER_HPP_INCLUDED
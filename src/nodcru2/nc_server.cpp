@@ -10,7 +10,8 @@
 // STD includes:
 #include <thread>
 #include <chrono>
-#include <queue>
+#include <string_view>
+#include <tuple>
 
 // External includes:
 #include <spdlog/stopwatch.h>
@@ -24,8 +25,181 @@
 #include "nc_server.hpp"
 #include "nc_util.hpp"
 #include "nc_exceptions.hpp"
+#include "nc_buffer_pool.hpp"
 
 namespace nodcru2 {
+NCJobSignal::NCJobSignal():
+    state_intern(NCJobState::Polling),
+    remaining_intern(0)
+    {}
+
+NCJobSignal::NCJobSignal(const NCJobSignal& other):
+    state_intern(other.state_intern.load()),
+    remaining_intern(other.remaining_intern.load())
+    {}
+
+NCJobSignal& NCJobSignal::operator=(const NCJobSignal& other) {
+    state_intern.store(other.state_intern.load());
+    remaining_intern.store(other.remaining_intern.load());
+    return *this;
+}
+
+NCJobSignal::NCJobSignal(NCJobSignal&& other):
+    NCJobSignal(other)
+    {}
+
+NCJobSignal& NCJobSignal::operator=(NCJobSignal&& other) {
+    return *this = other;
+}
+
+void NCJobSignal::nc_enable() noexcept {
+    NCJobState expected = NCJobState::Polling;
+    state_intern.compare_exchange_strong(expected, NCJobState::Running);
+}
+
+void NCJobSignal::nc_mark_done() noexcept {
+    state_intern.store(NCJobState::Done);
+}
+
+void NCJobSignal::nc_set_remaining(uint64_t const remaining) noexcept {
+    remaining_intern.store(remaining);
+    state_intern.store((remaining == 0) ? NCJobState::Done : NCJobState::Running);
+}
+
+void NCJobSignal::nc_work_done(uint64_t const amount) noexcept {
+    /*
+    Count down the remaining work, the job is done when it reaches zero.
+
+    The counter doesn't go below zero, if more work is reported than expected.
+    */
+
+    uint64_t remaining = remaining_intern.load();
+    uint64_t new_remaining = 0;
+
+    do {
+        new_remaining = (remaining > amount) ? (remaining - amount) : 0;
+    } while (!remaining_intern.compare_exchange_weak(remaining, new_remaining));
+
+    if (new_remaining == 0) {
+        state_intern.store(NCJobState::Done);
+    }
+}
+
+[[nodiscard]] uint64_t NCJobSignal::nc_get_remaining() const noexcept {
+    return remaining_intern.load();
+}
+
+[[nodiscard]] NCJobState NCJobSignal::nc_get_state() const noexcept {
+    return state_intern.load(std::memory_order_acquire);
+}
+
+NCCancelRequests::NCCancelRequests():
+    nodes_intern(),
+    size_intern(0),
+    cancel_mutex()
+    {}
+
+NCCancelRequests::NCCancelRequests(const NCCancelRequests& other):
+    NCCancelRequests()
+    {
+        *this = other;
+    }
+
+NCCancelRequests& NCCancelRequests::operator=(const NCCancelRequests& other) {
+    if (this != &other) {
+        std::scoped_lock lock(cancel_mutex, other.cancel_mutex);
+        nodes_intern = other.nodes_intern;
+        size_intern.store(other.size_intern.load());
+    }
+    return *this;
+}
+
+NCCancelRequests::NCCancelRequests(NCCancelRequests&& other):
+    NCCancelRequests(other)
+    {}
+
+NCCancelRequests& NCCancelRequests::operator=(NCCancelRequests&& other) {
+    return *this = other;
+}
+
+void NCCancelRequests::nc_add_node(NCNodeID const& node_id) {
+    /*
+    The node numbers its tasks from zero for each registration, so the count starts again.
+    A pending request of the old registration is dropped, the node has dropped these tasks anyway.
+    */
+
+    const std::lock_guard<std::mutex> lock(cancel_mutex);
+    auto const [item, inserted] = nodes_intern.try_emplace(node_id);
+
+    if (!inserted && (item->second.num_tasks > 0)) {
+        size_intern.fetch_sub(1, std::memory_order_release);
+    }
+
+    item->second = NCNodeCancelState();
+}
+
+void NCCancelRequests::nc_remove_node(NCNodeID const& node_id) {
+    const std::lock_guard<std::mutex> lock(cancel_mutex);
+    auto const item = nodes_intern.find(node_id);
+
+    if (item == nodes_intern.end()) {
+        return;
+    }
+
+    if (item->second.num_tasks > 0) {
+        size_intern.fetch_sub(1, std::memory_order_release);
+    }
+
+    nodes_intern.erase(item);
+}
+
+void NCCancelRequests::nc_tasks_sent(NCNodeID const& node_id, uint64_t const num_tasks) {
+    const std::lock_guard<std::mutex> lock(cancel_mutex);
+
+    if (auto const item = nodes_intern.find(node_id); item != nodes_intern.end()) {
+        item->second.tasks_sent += num_tasks;
+    }
+}
+
+void NCCancelRequests::nc_add(NCNodeID const& node_id) {
+    /*
+    Only the tasks that have been handed out so far are cancelled, not the ones
+    that the node gets before the Cancel message reaches it.
+    Nodes that don't know the Cancel message are not counted and are ignored here.
+    */
+
+    const std::lock_guard<std::mutex> lock(cancel_mutex);
+    auto const item = nodes_intern.find(node_id);
+
+    if ((item == nodes_intern.end()) || (item->second.tasks_sent == 0)) {
+        return;
+    }
+
+    if (item->second.num_tasks == 0) {
+        size_intern.fetch_add(1, std::memory_order_release);
+    }
+
+    item->second.num_tasks = item->second.tasks_sent;
+}
+
+[[nodiscard]] std::optional<uint64_t> NCCancelRequests::nc_take(NCNodeID const& node_id) {
+    if (size_intern.load(std::memory_order_acquire) == 0) {
+        return std::nullopt;
+    }
+
+    const std::lock_guard<std::mutex> lock(cancel_mutex);
+    auto const item = nodes_intern.find(node_id);
+
+    if ((item == nodes_intern.end()) || (item->second.num_tasks == 0)) {
+        return std::nullopt;
+    }
+
+    uint64_t const num_tasks = item->second.num_tasks;
+    item->second.num_tasks = 0;
+    size_intern.fetch_sub(1, std::memory_order_release);
+    return num_tasks;
+}
+
 [[nodiscard]] std::vector<uint8_t> NCServerDataProcessor::nc_get_init_data() {
     return std::vector<uint8_t>();
 }
@@ -40,11 +214,114 @@ void NCServerDataProcessor::nc_save_data() {
 void NCServerDataProcessor::nc_node_timeout([[maybe_unused]] NCNodeID node_id) {
 }
 
+[[nodiscard]] std::vector<std::vector<uint8_t>> NCServerDataProcessor::nc_get_new_data_batch(NCNodeID node_id,
+    [[maybe_unused]] uint32_t const max_tasks) {
+    /*
+    Return up to max_tasks blocks of data for the node, the node processes
+    them in this order and sends back one result for each block.
+
+    Override this method to hand out several tasks at once, this saves
+    one round trip per task. The default returns a single block.
+    */
+
+    std::vector<std::vector<uint8_t>> result;
+    result.push_back(nc_get_new_data(node_id));
+    return result;
+}
+
+void NCServerDataProcessor::nc_process_result_batch(NCNodeID node_id, std::vector<std::vector<uint8_t>> results) {
+    /*
+    The results are in the order the node has processed the tasks.
+
+    The default calls nc_process_result() for each result. Override this
+    method to process all results with one lock.
+    */
+
+    for (auto& result: results) {
+        nc_process_result(node_id, std::move(result));
+    }
+}
+
+void NCServerDataProcessor::nc_tasks_cancelled([[maybe_unused]] NCNodeID node_id,
+    [[maybe_unused]] uint32_t const num_tasks) {
+    /*
+    The node has stopped its oldest num_tasks tasks and sends no result for them.
+
+    Override this method to hand out these tasks again, if they are not done yet.
+    A node that doesn't know the Cancel message finishes its tasks and sends the results as usual.
+    */
+}
+
+void NCServerDataProcessor::nc_node_info([[maybe_unused]] NCNodeID node_id,
+    [[maybe_unused]] NCNodeInfo const& node_info) {
+    /*
+    Override this method to keep the hardware of the node,
+    e.g. to give more work to stronger nodes in nc_get_new_data().
+    */
+}
+
 [[nodiscard]] std::vector<uint8_t> NCServerDataProcessor::nc_get_new_data([[maybe_unused]] NCNodeID node_id) {
     return std::vector<uint8_t>();
 }
 
-void NCServerDataProcessor::nc_process_result([[maybe_unused]] NCNodeID node_id, [[maybe_unused]] std::vector<uint8_t> result) {
+void NCServerDataProcessor::nc_process_result(NCNodeID node_id, std::vector<uint8_t> result) {
+    /*
+    The result is moved into this method, no copy is made.
+
+    Override this method if the result should be kept,
+    otherwise override nc_process_result_view().
+    */
+
+    nc_process_result_view(node_id, result);
+    nc_release_buffer(std::move(result));
+}
+
+void NCServerDataProcessor::nc_process_result_view([[maybe_unused]] NCNodeID node_id,
+    [[maybe_unused]] std::span<const uint8_t> const result) {
+}
+
+void NCServerDataProcessor::nc_use_job_signal() noexcept {
+    job_signal_intern.nc_enable();
+}
+
+void NCServerDataProcessor::nc_mark_job_done() noexcept {
+    job_signal_intern.nc_mark_done();
+}
+
+void NCServerDataProcessor::nc_set_remaining_work(uint64_t const remaining) noexcept {
+    job_signal_intern.nc_set_remaining(remaining);
+}
+
+void NCServerDataProcessor::nc_work_done(uint64_t const amount) noexcept {
+    job_signal_intern.nc_work_done(amount);
+}
+
+[[nodiscard]] uint64_t NCServerDataProcessor::nc_get_remaining_work() const noexcept {
+    return job_signal_intern.nc_get_remaining();
+}
+
+[[nodiscard]] NCJobState NCServerDataProcessor::nc_get_job_state() const noexcept {
+    return job_signal_intern.nc_get_state();
+}
+
+void NCServerDataProcessor::nc_cancel_node_tasks(NCNodeID const& node_id) {
+    cancel_requests_intern.nc_add(node_id);
+}
+
+void NCServerDataProcessor::nc_count_node_tasks(NCNodeID const& node_id, bool const supports_cancel) {
+    if (supports_cancel) {
+        cancel_requests_intern.nc_add_node(node_id);
+    } else {
+        cancel_requests_intern.nc_remove_node(node_id);
+    }
+}
+
+void NCServerDataProcessor::nc_count_tasks_sent(NCNodeID const& node_id, uint64_t const num_tasks) {
+    cancel_requests_intern.nc_tasks_sent(node_id, num_tasks);
+}
+
+[[nodiscard]] std::optional<uint64_t> NCServerDataProcessor::nc_take_cancel_request(NCNodeID const& node_id) {
+    return cancel_requests_intern.nc_take(node_id);
 }
 
 NCServer::NCServer(NCConfiguration config,
@@ -54,12 +331,28 @@ NCServer::NCServer(NCConfiguration config,
     config_intern(config),
     nc_logger(),
     quit(false),
-    all_nodes(),
-    server_mutex(),
+    all_nodes(std::chrono::seconds(config.heartbeat_timeout)),
+    node_timers(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::seconds(config.heartbeat_timeout)) / NC_HEARTBEAT_CHECKS_PER_TIMEOUT),
     message_codec_intern(std::move(message_codec)),
     network_server_intern(std::move(network_server)),
-    data_processor_intern(data_processor)
+    data_processor_intern(data_processor),
+    capabilities_intern(message_codec_intern->nc_get_capabilities()),
+    processor_actor_intern(config.serialize_processor ? std::make_unique<NCActorExecutor>() : nullptr),
+    stage_statistics()
     {
+        // The configuration may not come from a file, so check it here too:
+        if (config_intern.heartbeat_timeout < NC_MIN_HEARTBEAT_TIMEOUT) {
+            throw NCConfigurationException(fmt::format("Invalid heartbeat timeout: {}", config_intern.heartbeat_timeout).c_str());
+        }
+
+        capabilities_intern.preferred_compressor = config_intern.preferred_compressor;
+        capabilities_intern.preferred_encryption = config_intern.preferred_encryption;
+        capabilities_intern.max_frame_size = config_intern.max_frame_size;
+        capabilities_intern.features |= NC_FEATURE_RESULT_WITH_NEW_DATA;
+        capabilities_intern.features |= NC_FEATURE_RESULT_BATCH;
+        capabilities_intern.features |= NC_FEATURE_CANCEL;
+
         spdlog::drop("nc_logger");
 
         if (config_intern.nc_server_log_file.size() > 0) {
@@ -88,7 +381,7 @@ NCServer::NCServer(NCConfiguration config,
     NCServer(config,
         std::move(data_processor),
         std::move(message_codec),
-        std::make_unique<NCNetworkServer>(config.server_port))
+        std::make_unique<NCNetworkServer>(config.server_port, config.max_frame_size))
     {}
 
 NCServer::NCServer(NCConfiguration config,
@@ -105,58 +398,88 @@ NCServer::NCServer(NCConfiguration config,
     NCServer(config,
         data_processor,
         std::make_unique<NCMessageCodecServer>(config.secret_key),
-        std::make_unique<NCNetworkServer>(config.server_port))
+        std::make_unique<NCNetworkServer>(config.server_port, config.max_frame_size))
     {}
 
 void NCServer::nc_run() {
+    /*
+    Start the pipeline and accept connections until the job is done.
+
+    Each message from a node goes through the stages receive, decode, process,
+    encode and send. The stages are connected by bounded queues and each
+    stage has its own threads, see the options io_threads, codec_threads and
+    processor_threads. The order of the stages is the same for every message.
+    */
+
     nc_logger->info("NCServer::nc_run() - starting server");
     spdlog::stopwatch sw;
 
-    // TODO: Make threahsold configurable
-    const uint32_t max_thread_count = 10;
-
     std::unique_ptr<NCNetworkSocketBase> socket;
 
     // Have to use lambda in order to call non-static method:
     std::thread heartbeat_thread([this] () {nc_check_heartbeat();});
 
-    // Keep track of client threads
-    std::queue<std::thread> client_threads;
-    size_t num_of_threads = 0;
-
-    while (!quit.load()) {
+    NCBoundedQueue<NCServerRequest> receive_queue(NC_PIPELINE_QUEUE_SIZE);
+    NCBoundedQueue<NCServerRequest> decode_queue(NC_PIPELINE_QUEUE_SIZE);
+    NCBoundedQueue<NCServerRequest> process_queue(NC_PIPELINE_QUEUE_SIZE);
+    NCBoundedQueue<NCServerRequest> encode_queue(NC_PIPELINE_QUEUE_SIZE);
+    NCBoundedQueue<NCServerRequest> send_queue(NC_PIPELINE_QUEUE_SIZE);
+
+    std::array<std::vector<std::thread>, NC_NUM_PIPELINE_STAGES> stage_threads = {
+        nc_start_stage(NCPipelineStage::Receive, config_intern.io_threads,
+            receive_queue, &decode_queue, &NCServer::nc_receive_request),
+        nc_start_stage(NCPipelineStage::Decode, config_intern.codec_threads,
+            decode_queue, &process_queue, &NCServer::nc_decode_request),
+        nc_start_stage(NCPipelineStage::Process, config_intern.processor_threads,
+            process_queue, &encode_queue, &NCServer::nc_process_request),
+        nc_start_stage(NCPipelineStage::Encode, config_intern.codec_threads,
+            encode_queue, &send_queue, &NCServer::nc_encode_answer),
+        nc_start_stage(NCPipelineStage::Send, config_intern.io_threads,
+            send_queue, nullptr, &NCServer::nc_send_answer)
+    };
+
+    std::array<NCBoundedQueue<NCServerRequest>*, NC_NUM_PIPELINE_STAGES> const stage_queues = {
+        &receive_queue, &decode_queue, &process_queue, &encode_queue, &send_queue
+    };
+
+    bool job_done = false;
+
+    while (!job_done) {
         // Wait for a client to connect
         try {
             socket = network_server_intern->nc_accept();
         } catch (asio::system_error &e) {
             nc_logger->error("Could not accept connection from socket: {}", e.what());
             quit.store(true);
-            continue;
+            break;
         }
 
-        client_threads.emplace([this] (auto sock2) {nc_handle_node(sock2);}, std::move(socket));
+        // Checked before the request is queued, so that the pipeline can't finish the job
+        // in the meantime: the server stops after the first node that connects when the job
+        // is already done, that node gets a quit message.
+        job_done = quit.load();
+        receive_queue.nc_push(NCServerRequest{.socket = std::move(socket)});
+    }
+
+    // All messages that are already in the pipeline are answered (with a quit message),
+    // one stage after the other:
+    for (size_t i = 0; i < NC_NUM_PIPELINE_STAGES; i++) {
+        stage_queues[i]->nc_close();
+        nc_logger->debug("Waiting for pipeline stage {} ({} threads)...", i, stage_threads[i].size());
 
-        if (client_threads.size() > max_thread_count) {
-            client_threads.front().join();
-            client_threads.pop();
+        for (auto& thread: stage_threads[i]) {
+            thread.join();
         }
     }
 
     // Save all data:
     nc_logger->debug("Job done, saving data...");
-    data_processor_intern->nc_save_data();
+    nc_call_processor([this] () {data_processor_intern->nc_save_data();});
 
     nc_logger->debug("Waiting for heartbeat thread...");
     heartbeat_thread.join();
 
-    num_of_threads = client_threads.size();
-    while (num_of_threads > 0) {
-        nc_logger->debug("Waiting for client threads ({})...", num_of_threads);
-        client_threads.front().join();
-        client_threads.pop();
-        num_of_threads = client_threads.size();
-    }
-
+    nc_log_stage_statistics();
     nc_logger->info("Elapsed time: {} sec.", sw);
     nc_logger->info("Will exit now.");
     nc_logger->flush();
@@ -167,97 +490,411 @@ void NCServer::nc_run() {
     std::this_thread::sleep_for(sleep_time);
 }
 
-bool NCServer::nc_valid_node_id(NCNodeID node_id) {
-    const std::lock_guard<std::mutex> lock(server_mutex);
-    if (all_nodes.contains(node_id)) {
-        return true;
-    } else {
-        nc_logger->error("Unknown node id: {}", node_id.id);
-        return false;
+[[nodiscard]] std::vector<std::thread> NCServer::nc_start_stage(NCPipelineStage const stage, uint16_t const num_threads,
+    NCBoundedQueue<NCServerRequest>& input, NCBoundedQueue<NCServerRequest>* output,
+    void (NCServer::*function)(NCServerRequest&)) {
+    /*
+    Start the threads of one pipeline stage.
+
+    Each thread takes a request from the input queue, runs the stage function
+    and puts the request into the output queue. The threads exit when the
+    input queue is closed and empty.
+    */
+
+    NCStageStatistics& statistics = stage_statistics[static_cast<size_t>(stage)];
+    std::vector<std::thread> threads;
+
+    for (uint16_t i = 0; i < num_threads; i++) {
+        threads.emplace_back([this, &statistics, &input, output, function] () {
+            while (auto request = input.nc_pop()) {
+                auto const start_time = std::chrono::steady_clock::now();
+                (this->*function)(*request);
+                auto const busy_time = std::chrono::steady_clock::now() - start_time;
+
+                statistics.num_messages.fetch_add(1, std::memory_order_relaxed);
+                statistics.busy_time.fetch_add(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(busy_time).count()), std::memory_order_relaxed);
+
+                if (output != nullptr) {
+                    output->nc_push(std::move(*request));
+                }
+            }
+        });
     }
+
+    return threads;
 }
 
-void NCServer::nc_register_new_node(NCNodeID node_id) {
-    nc_logger->info("NCServer::nc_register_new_node(), node_id: {}", node_id.id);
+void NCServer::nc_log_stage_statistics() {
+    std::array<std::string_view, NC_NUM_PIPELINE_STAGES> const stage_names = {
+        "receive", "decode", "process", "encode", "send"
+    };
 
-    std::chrono::steady_clock clock;
-    std::chrono::time_point node_time = clock.now();
+    for (size_t i = 0; i < NC_NUM_PIPELINE_STAGES; i++) {
+        uint64_t const num_messages = stage_statistics[i].num_messages.load();
+        double const busy_time = static_cast<double>(stage_statistics[i].busy_time.load()) / 1.0e9;
+        double const average_time = (num_messages > 0) ? (busy_time / static_cast<double>(num_messages)) : 0.0;
 
-    const std::lock_guard<std::mutex> lock(server_mutex);
-    if (all_nodes.contains(node_id)) {
-        nc_logger->debug("Node already registered: {}", node_id.id);
-    } else {
-        all_nodes[node_id] = node_time;
+        nc_logger->info("Stage {}: {} messages, busy: {:.3f} sec., average: {:.6f} sec.",
+            stage_names[i], num_messages, busy_time, average_time);
     }
 }
 
-void NCServer::nc_update_node_time(NCNodeID node_id) {
-    nc_logger->debug("NCServer::nc_update_node_time(), node_id: {}", node_id.id);
+[[nodiscard]] std::optional<NCNodeID> NCServer::nc_find_node(NCNodeSlot const node_slot) {
+    /*
+    Return a copy of the node id for the given slot, if the node is registered.
+
+    The slot is an index into the node registry, the token must match the one
+    that was given to the node in the InitOK message.
+    This does not take a lock. The copy can be used later on (for example on the
+    processor thread), even if the slot has been given to another node in between.
+    */
 
-    std::chrono::steady_clock clock;
-    std::chrono::time_point node_time = clock.now();
+    std::optional<NCNodeID> node_id = all_nodes.nc_find(node_slot);
 
-    const std::lock_guard<std::mutex> lock(server_mutex);
-    all_nodes[node_id] = node_time;
+    if (!node_id) {
+        nc_logger->error("Unknown node slot: {}", node_slot.slot);
+    }
+
+    return node_id;
 }
 
-void NCServer::nc_handle_node(std::unique_ptr<NCNetworkSocketBase> &socket) {
-    nc_logger->debug("NCServer::nc_handle_node(), ip: {}", socket->nc_address());
-    std::vector<uint8_t> message = socket->nc_receive_data();
-    NCDecodedMessageFromNode node_message = message_codec_intern->nc_decode_message_from_node(NCEncodedMessageToServer(message));
-    NCNodeID const node_id = node_message.node_id;
-    NCEncodedMessageToNode msg_to_node;
+[[nodiscard]] NCNodeSlot NCServer::nc_register_new_node(NCNodeID node_id) {
+    nc_logger->info("NCServer::nc_register_new_node(), node_id: {}", node_id.id);
+
+    NCNodeSlot const node_slot = all_nodes.nc_register(node_id);
+    nc_logger->debug("Node slot: {}, number of nodes: {}", node_slot.slot, all_nodes.nc_num_nodes());
+    // Replaces the old timer, if the node was already registered:
+    node_timers.nc_schedule(node_slot.slot,
+        std::chrono::steady_clock::now() + std::chrono::seconds(config_intern.heartbeat_timeout));
 
-    if (quit.load()) {
-        msg_to_node = message_codec_intern->nc_gen_quit_message();
+    return node_slot;
+}
+
+[[nodiscard]] bool NCServer::nc_check_job_done() {
+    /*
+    Called for every message from a node.
+
+    If the data processor signals the end of the job, this is only an atomic load.
+    Otherwise nc_is_job_done() of the data processor is called.
+    */
+
+    switch (data_processor_intern->nc_get_job_state()) {
+        case NCJobState::Done:
+            return true;
+        case NCJobState::Running:
+            return false;
+        default:
+            return nc_call_processor([this] () {return data_processor_intern->nc_is_job_done();});
     }
-    else if (data_processor_intern->nc_is_job_done()) {
-        quit.store(true);
-        msg_to_node = message_codec_intern->nc_gen_quit_message();
-    } else {
-        switch (node_message.msg_type) {
+}
+
+void NCServer::nc_receive_request(NCServerRequest& request) {
+    nc_logger->debug("NCServer::nc_receive_request(), ip: {}", request.socket->nc_address());
+
+    try {
+        // Throws if the message is larger than the maximum frame size:
+        request.message.data = request.socket->nc_receive_data();
+    } catch (std::exception &e) {
+        nc_logger->error("Could not receive message from node: {}", e.what());
+        request.gen_answer = [this] () {return message_codec_intern->nc_gen_unknown_error();};
+    }
+}
+
+void NCServer::nc_decode_request(NCServerRequest& request) {
+    /*
+    Decode the header and decrypt and decompress the payload.
+
+    This also authenticates the header, so the following stages only
+    see valid messages from nodes that know the shared key.
+    The payload is only decoded if it is needed: not after the job is done
+    and not for an unknown node slot.
+    */
+
+    if (request.gen_answer) {
+        return;
+    }
+
+    try {
+        request.header = message_codec_intern->nc_decode_header_from_node(request.message);
+        bool needs_payload = false;
+
+        switch (request.header.msg_type) {
             case NCNodeMessageType::Init:
-                nc_register_new_node(node_id);
-                msg_to_node = message_codec_intern->nc_gen_init_message_ok(data_processor_intern->nc_get_init_data());
-            break;
             case NCNodeMessageType::Heartbeat:
-                if (nc_valid_node_id(node_id)) {
-                    nc_logger->debug("Heartbeat from node: {}", node_id.id);
-                    nc_update_node_time(node_id);
-                    msg_to_node = message_codec_intern->nc_gen_heartbeat_message_ok();
-                } else {
-                    msg_to_node = message_codec_intern->nc_gen_invalid_node_id_error();
-                }
-            break;
             case NCNodeMessageType::NodeNeedsMoreData:
-                if (nc_valid_node_id(node_id)) {
-                    msg_to_node = message_codec_intern->nc_gen_new_data_message(data_processor_intern->nc_get_new_data(node_id));
-                } else {
-                    msg_to_node = message_codec_intern->nc_gen_invalid_node_id_error();
-                }
-            break;
             case NCNodeMessageType::NewResultFromNode:
-                if (nc_valid_node_id(node_id)) {
-                    data_processor_intern->nc_process_result(node_id, node_message.data);
-                    msg_to_node = message_codec_intern->nc_gen_result_ok_message();
-                } else {
-                    msg_to_node = message_codec_intern->nc_gen_invalid_node_id_error();
-                }
+            case NCNodeMessageType::ResultNeedsMoreData:
+            case NCNodeMessageType::NewResultBatchFromNode:
+            case NCNodeMessageType::TasksCancelled:
+                needs_payload = true;
             break;
             default:
-                nc_logger->error("Unexpected message from node: {}", nc_type_to_string(node_message.msg_type));
-                msg_to_node = message_codec_intern->nc_gen_unknown_error();
+                // Answered with an error in the process stage:
+            break;
         }
+
+        // These are answered in the process stage without the payload. Only the atomic job state here,
+        // nc_is_job_done() is called in the process stage for each message:
+        bool const job_done = quit.load() || (data_processor_intern->nc_get_job_state() == NCJobState::Done);
+        bool const unknown_node = (request.header.msg_type != NCNodeMessageType::Init) &&
+            !all_nodes.nc_find(request.header.node_slot);
+
+        if (needs_payload && !job_done && !unknown_node) {
+            request.payload = message_codec_intern->nc_decode_payload_from_node(request.message);
+        }
+    } catch (std::exception &e) {
+        // Invalid message, unsupported codec or authentication failed:
+        nc_logger->error("Could not decode message from node: {}", e.what());
+        request.gen_answer = [this] () {return message_codec_intern->nc_gen_unknown_error();};
+    }
+
+    nc_release_buffer(std::move(request.message.data));
+}
+
+void NCServer::nc_process_request(NCServerRequest& request) {
+    /*
+    Call the data processor and decide the answer for the node.
+
+    Only the payload of the answer is created here, it is compressed and
+    encrypted in the encode stage.
+    */
+
+    if (request.gen_answer) {
+        return;
+    }
+
+    NCNodeSlot const node_slot = request.header.node_slot;
+    // Answer with the same codec that the node has used:
+    NCCodecID const codec = request.header.codec;
+
+    try {
+        if (quit.load()) {
+            request.gen_answer = [this, codec] () {return message_codec_intern->nc_gen_quit_message(codec);};
+        }
+        else if (nc_check_job_done()) {
+            quit.store(true);
+            request.gen_answer = [this, codec] () {return message_codec_intern->nc_gen_quit_message(codec);};
+        } else {
+            switch (request.header.msg_type) {
+                case NCNodeMessageType::Init: {
+                    NCInitRequest const init_request = message_codec_intern->nc_decode_init_request(request.payload);
+                    NCNegotiatedCapabilities const negotiated = nc_negotiate(capabilities_intern, init_request.capabilities);
+                    nc_logger->debug("Negotiated codec for node {}: {}", init_request.node_id.id, nc_codec_to_byte(negotiated.codec));
+                    NCNodeSlot const new_slot = nc_register_new_node(init_request.node_id);
+                    // The node numbers its tasks from zero again:
+                    data_processor_intern->nc_count_node_tasks(init_request.node_id,
+                        (negotiated.features & NC_FEATURE_CANCEL) != 0);
+                    nc_call_processor([this, &init_request] () {
+                        data_processor_intern->nc_node_info(init_request.node_id, init_request.node_info);
+                    });
+                    request.gen_answer = [this, negotiated, new_slot, codec,
+                        init_data = nc_call_processor([this] () {return data_processor_intern->nc_get_init_data();})] () {
+                        return message_codec_intern->nc_gen_init_message_ok(negotiated, new_slot, init_data, codec);
+                    };
+                }
+                break;
+                case NCNodeMessageType::Heartbeat:
+                    if (auto const node_id = nc_find_node(node_slot)) {
+                        nc_logger->debug("Heartbeat from node: {}", node_id->id);
+                        all_nodes.nc_update_time(node_slot);
+
+                        if (!nc_answer_cancel(request, *node_id)) {
+                            request.gen_answer = [this, codec] () {return message_codec_intern->nc_gen_heartbeat_message_ok(codec);};
+                        }
+                    } else {
+                        request.gen_answer = [this, codec] () {return message_codec_intern->nc_gen_invalid_node_id_error(codec);};
+                    }
+                break;
+                case NCNodeMessageType::NodeNeedsMoreData:
+                    if (auto const node_id = nc_find_node(node_slot)) {
+                        uint32_t const max_tasks = message_codec_intern->nc_decode_need_more_data_request(request.payload);
+                        // Also used for the next ResultNeedsMoreData message of this node:
+                        all_nodes.nc_set_batch_size(node_slot, max_tasks);
+
+                        if (!nc_answer_cancel(request, *node_id)) {
+                            nc_answer_new_data(request, *node_id, max_tasks);
+                        }
+                    } else {
+                        request.gen_answer = [this, codec] () {return message_codec_intern->nc_gen_invalid_node_id_error(codec);};
+                    }
+                break;
+                case NCNodeMessageType::NewResultFromNode:
+                    if (auto const node_id = nc_find_node(node_slot)) {
+                        // The result was already decrypted and decompressed in the decode stage:
+                        nc_call_processor([this, node_id, &request] () {
+                            data_processor_intern->nc_process_result(*node_id, std::move(request.payload));
+                        });
+
+                        if (!nc_answer_cancel(request, *node_id)) {
+                            request.gen_answer = [this, codec] () {return message_codec_intern->nc_gen_result_ok_message(codec);};
+                        }
+                    } else {
+                        request.gen_answer = [this, codec] () {return message_codec_intern->nc_gen_invalid_node_id_error(codec);};
+                    }
+                break;
+                case NCNodeMessageType::NewResultBatchFromNode:
+                    if (auto const node_id = nc_find_node(node_slot)) {
+                        // Decoded outside of the processor, it may run on a single thread:
+                        std::vector<std::vector<uint8_t>> results = message_codec_intern->nc_decode_result_batch(request.payload);
+                        nc_call_processor([this, node_id, &results] () {
+                            data_processor_intern->nc_process_result_batch(*node_id, std::move(results));
+                        });
+
+                        if (!nc_answer_cancel(request, *node_id)) {
+                            request.gen_answer = [this, codec] () {return message_codec_intern->nc_gen_result_ok_message(codec);};
+                        }
+                    } else {
+                        request.gen_answer = [this, codec] () {return message_codec_intern->nc_gen_invalid_node_id_error(codec);};
+                    }
+                break;
+                case NCNodeMessageType::TasksCancelled:
+                    if (auto const node_id = nc_find_node(node_slot)) {
+                        uint32_t const num_tasks = message_codec_intern->nc_decode_tasks_cancelled(request.payload);
+                        nc_call_processor([this, node_id, num_tasks] () {
+                            data_processor_intern->nc_tasks_cancelled(*node_id, num_tasks);
+                        });
+
+                        if (!nc_answer_cancel(request, *node_id)) {
+                            request.gen_answer = [this, codec] () {return message_codec_intern->nc_gen_result_ok_message(codec);};
+                        }
+                    } else {
+                        request.gen_answer = [this, codec] () {return message_codec_intern->nc_gen_invalid_node_id_error(codec);};
+                    }
+                break;
+                case NCNodeMessageType::ResultNeedsMoreData:
+                    if (auto const node_id = nc_find_node(node_slot)) {
+                        nc_call_processor([this, node_id, &request] () {
+                            data_processor_intern->nc_process_result(*node_id, std::move(request.payload));
+                        });
+
+                        // This result may have finished the job:
+                        if (nc_check_job_done()) {
+                            quit.store(true);
+                            request.gen_answer = [this, codec] () {return message_codec_intern->nc_gen_quit_message(codec);};
+                        } else if (!nc_answer_cancel(request, *node_id)) {
+                            nc_answer_new_data(request, *node_id, all_nodes.nc_batch_size(node_slot));
+                        }
+                    } else {
+                        request.gen_answer = [this, codec] () {return message_codec_intern->nc_gen_invalid_node_id_error(codec);};
+                    }
+                break;
+                default:
+                    nc_logger->error("Unexpected message from node: {}", nc_type_to_string(request.header.msg_type));
+                    request.gen_answer = [this, codec] () {return message_codec_intern->nc_gen_unknown_error(codec);};
+            }
+        }
+    } catch (std::exception &e) {
+        nc_logger->error("Could not process message from node: {}", e.what());
+        request.gen_answer = [this] () {return message_codec_intern->nc_gen_unknown_error();};
+    }
+
+    nc_release_buffer(std::move(request.payload));
+}
+
+void NCServer::nc_answer_new_data(NCServerRequest& request, NCNodeID const node_id, uint32_t const max_tasks) {
+    /*
+    Get the next data for the node, it is encoded in the encode stage.
+    */
+
+    NCCodecID const codec = request.header.codec;
+
+    if (max_tasks > 1) {
+        std::vector<std::vector<uint8_t>> new_data = nc_call_processor([this, node_id, max_tasks] () {
+            return data_processor_intern->nc_get_new_data_batch(node_id, max_tasks);
+        });
+        // The node numbers its tasks in the same way:
+        data_processor_intern->nc_count_tasks_sent(node_id, new_data.size());
+
+        request.gen_answer = [this, codec, new_data = std::move(new_data)] () mutable {
+            NCEncodedMessageToNode message = message_codec_intern->nc_gen_new_data_batch_message(new_data, codec);
+
+            for (auto& item: new_data) {
+                nc_release_buffer(std::move(item));
+            }
+
+            return message;
+        };
+
+        return;
+    }
+
+    std::vector<uint8_t> new_data = nc_call_processor([this, node_id] () {return data_processor_intern->nc_get_new_data(node_id);});
+    data_processor_intern->nc_count_tasks_sent(node_id, 1);
+
+    request.gen_answer = [this, codec, new_data = std::move(new_data)] () mutable {
+        NCEncodedMessageToNode message = message_codec_intern->nc_gen_new_data_message(new_data, codec);
+        nc_release_buffer(std::move(new_data));
+        return message;
+    };
+}
+
+[[nodiscard]] bool NCServer::nc_answer_cancel(NCServerRequest& request, NCNodeID const& node_id) {
+    /*
+    Answer with a Cancel message if the data processor has cancelled the tasks of the node.
+
+    The Cancel message takes the place of the usual answer (HeartbeatOK, ResultOK or new data),
+    the message of the node has already been handled. So the node learns about the Cancel with
+    its next message of any type. The node then asks again for new data, if it needs any.
+    */
+
+    std::optional<uint64_t> const num_tasks = data_processor_intern->nc_take_cancel_request(node_id);
+
+    if (!num_tasks) {
+        return false;
+    }
+
+    nc_logger->debug("Cancel the first {} tasks of node: {}", *num_tasks, node_id.id);
+    NCCodecID const codec = request.header.codec;
+    request.gen_answer = [this, codec, num_tasks = *num_tasks] () {
+        return message_codec_intern->nc_gen_cancel_message(num_tasks, codec);
+    };
+
+    return true;
+}
+
+void NCServer::nc_encode_answer(NCServerRequest& request) {
+    try {
+        request.answer = request.gen_answer();
+    } catch (std::exception &e) {
+        nc_logger->error("Could not encode answer for node: {}", e.what());
+        request.answer = message_codec_intern->nc_gen_unknown_error();
     }
 
-    // Send answer back to node:
-    socket->nc_send_data(msg_to_node.data);
+    // Release the captured data now:
+    request.gen_answer = nullptr;
+}
+
+void NCServer::nc_send_answer(NCServerRequest& request) {
+    try {
+        request.socket->nc_send_data(request.answer.data);
+    } catch (std::exception &e) {
+        nc_logger->error("Could not send answer to node: {}", e.what());
+    }
+
+    nc_release_buffer(std::move(request.answer.data));
+    request.socket.reset();
 }
 
 void NCServer::nc_check_heartbeat() {
-    std::chrono::steady_clock clock;
-    std::chrono::time_point current_time = clock.now();
-    auto const sleep_time = std::chrono::seconds(config_intern.heartbeat_timeout);
+    /*
+    Evict all nodes that haven't sent a heartbeat within the timeout.
+
+    A node is evicted after the static heartbeat timeout with some slack
+    (NC_HEARTBEAT_TIMEOUT_SLACK), since the node sends a heartbeat only once
+    per timeout and a heartbeat may wait behind a slow message of the node.
+    For a node with irregular heartbeats the timeout is learned from its
+    inter-arrival times (phi accrual failure detector), see the option
+    phi_threshold. The learned timeout is never shorter than the static one.
+
+    The timer of a node is not moved on each heartbeat. When it fires, the
+    last contact of the node is checked and the timer is scheduled again if
+    the node is still alive. So each check only handles the expired timers.
+    An evicted node gets InvalidNodeID as answer and has to register again.
+    */
+
+    auto const timeout = std::chrono::seconds(config_intern.heartbeat_timeout) * NC_HEARTBEAT_TIMEOUT_SLACK;
+    auto const sleep_time = node_timers.nc_get_tick();
 
     while (!quit.load()) {
         std::this_thread::sleep_for(sleep_time);
@@ -267,14 +904,20 @@ void NCServer::nc_check_heartbeat() {
             break;
         }
 
-        current_time = clock.now();
+        auto const current_time = std::chrono::steady_clock::now();
+
+        for (uint32_t const slot: node_timers.nc_advance(current_time)) {
+            auto const deadline = all_nodes.nc_last_contact(slot) +
+                all_nodes.nc_suspect_after(slot, config_intern.phi_threshold, timeout);
 
-        const std::lock_guard<std::mutex> lock(server_mutex);
-        for (const auto& [node_id, node_time]: all_nodes) {
-            auto const time_diff = std::chrono::duration_cast<std::chrono::seconds>(current_time - node_time);
-            if (time_diff > sleep_time) {
-                nc_logger->debug("Node timeout: {}", node_id.id);
-                data_processor_intern->nc_node_timeout(node_id);
+            if (deadline > current_time) {
+                // Node is still alive:
+                node_timers.nc_schedule(slot, deadline);
+            } else if (auto const node_id = all_nodes.nc_evict(slot)) {
+                // No lock is held while the user callback is running:
+                nc_logger->debug("Node timeout: {}, slot: {}", node_id->id, slot);
+                data_processor_intern->nc_count_node_tasks(*node_id, false);
+                nc_call_processor([this, &node_id] () {data_processor_intern->nc_node_timeout(*node_id);});
             }
         }
     }
@@ -15,7 +15,15 @@
 #include <vector>
 #include <string>
 #include <atomic>
+#include <span>
+#include <thread>
+#include <memory>
+#include <type_traits>
+#include <functional>
+#include <array>
 #include <mutex>
+#include <unordered_map>
+#include <optional>
 
 // External includes:
 #include <spdlog/spdlog.h>
@@ -25,8 +33,115 @@
 #include "nc_nodeid.hpp"
 #include "nc_message.hpp"
 #include "nc_network.hpp"
+#include "nc_node_registry.hpp"
+#include "nc_timer_wheel.hpp"
+#include "nc_actor.hpp"
+#include "nc_bounded_queue.hpp"
 
 namespace nodcru2 {
+// Resolution of the heartbeat check, number of checks per heartbeat timeout:
+uint32_t const NC_HEARTBEAT_CHECKS_PER_TIMEOUT = 10;
+// Without enough samples for the failure detector a node is evicted after this many heartbeat timeouts
+// without contact, the node sends its heartbeat every heartbeat timeout:
+uint32_t const NC_HEARTBEAT_TIMEOUT_SLACK = 2;
+// Capacity of the queues between the pipeline stages:
+size_t const NC_PIPELINE_QUEUE_SIZE = 64;
+
+// The stages of the server pipeline, each one has its own threads:
+enum struct NCPipelineStage: uint8_t {
+    Receive = 0,
+    Decode = 1,
+    Process = 2,
+    Encode = 3,
+    Send = 4
+};
+
+size_t const NC_NUM_PIPELINE_STAGES = 5;
+
+// A message from a node on its way through the pipeline:
+struct NCServerRequest {
+    std::unique_ptr<NCNetworkSocketBase> socket = nullptr;
+    NCEncodedMessageToServer message = {};
+    NCMessageHeaderFromNode header = {};
+    // Decrypted and decompressed payload:
+    std::vector<uint8_t> payload = {};
+    // Set by the stage that decides the answer, the following stages until the encode stage skip the request:
+    std::move_only_function<NCEncodedMessageToNode()> gen_answer = {};
+    NCEncodedMessageToNode answer = {};
+};
+
+struct NCStageStatistics {
+    std::atomic<uint64_t> num_messages = 0;
+    // Nanoseconds:
+    std::atomic<uint64_t> busy_time = 0;
+};
+
+// Set by the data processor, so that the server doesn't have to poll nc_is_job_done():
+enum struct NCJobState: uint8_t {
+    // Default, nc_is_job_done() is called for every message:
+    Polling = 0,
+    Running = 1,
+    Done = 2
+};
+
+class NCJobSignal {
+    public:
+        void nc_enable() noexcept;
+        void nc_mark_done() noexcept;
+        void nc_set_remaining(uint64_t const remaining) noexcept;
+        void nc_work_done(uint64_t const amount) noexcept;
+        [[nodiscard]] uint64_t nc_get_remaining() const noexcept;
+        [[nodiscard]] NCJobState nc_get_state() const noexcept;
+
+        // Constructor:
+        NCJobSignal();
+
+        // The state is copied:
+        NCJobSignal(const NCJobSignal&);
+        NCJobSignal& operator=(const NCJobSignal&);
+        NCJobSignal(NCJobSignal&&);
+        NCJobSignal& operator=(NCJobSignal&&);
+
+    private:
+        std::atomic<NCJobState> state_intern;
+        std::atomic<uint64_t> remaining_intern;
+};
+
+// The tasks handed out to a node in its current registration and the pending Cancel:
+struct NCNodeCancelState {
+    uint64_t tasks_sent = 0;
+    // The node drops its first num_tasks tasks, zero if nothing is cancelled:
+    uint64_t num_tasks = 0;
+};
+
+// Nodes whose tasks are not needed anymore, the server tells them with the answer to their next message:
+class NCCancelRequests {
+    public:
+        // Start counting the tasks of the node again, for a node that knows the Cancel message:
+        void nc_add_node(NCNodeID const& node_id);
+        void nc_remove_node(NCNodeID const& node_id);
+        void nc_tasks_sent(NCNodeID const& node_id, uint64_t const num_tasks);
+        // Cancels all tasks that have been handed out to the node so far:
+        void nc_add(NCNodeID const& node_id);
+        // Returns the number of tasks to drop, once for each request:
+        [[nodiscard]] std::optional<uint64_t> nc_take(NCNodeID const& node_id);
+
+        // Constructor:
+        NCCancelRequests();
+
+        // The requests are copied:
+        NCCancelRequests(const NCCancelRequests&);
+        NCCancelRequests& operator=(const NCCancelRequests&);
+        NCCancelRequests(NCCancelRequests&&);
+        NCCancelRequests& operator=(NCCancelRequests&&);
+
+    private:
+        std::unordered_map<NCNodeID, NCNodeCancelState> nodes_intern;
+        // Number of pending requests, checked first so that a message doesn't need the lock if nothing is cancelled:
+        std::atomic<size_t> size_intern;
+        mutable std::mutex cancel_mutex;
+};
+
 class NCServerDataProcessor {
     public:
         // Default special member functions:
@@ -44,6 +159,39 @@ class NCServerDataProcessor {
         virtual void nc_node_timeout(NCNodeID node_id);
         [[nodiscard]] virtual std::vector<uint8_t> nc_get_new_data(NCNodeID node_id);
         virtual void nc_process_result(NCNodeID node_id, std::vector<uint8_t> result);
+        // Optional, called if the node asks for more than one task:
+        [[nodiscard]] virtual std::vector<std::vector<uint8_t>> nc_get_new_data_batch(NCNodeID node_id, uint32_t const max_tasks);
+        // Optional, called for the results of several tasks in one message:
+        virtual void nc_process_result_batch(NCNodeID node_id, std::vector<std::vector<uint8_t>> results);
+        // Optional, called by the default nc_process_result():
+        virtual void nc_process_result_view(NCNodeID node_id, std::span<const uint8_t> const result);
+        // Optional, the hardware of a new node, called before nc_get_init_data():
+        virtual void nc_node_info(NCNodeID node_id, NCNodeInfo const& node_info);
+        // Optional, the node has dropped its oldest num_tasks tasks after nc_cancel_node_tasks().
+        // Called in the order of the results of the node:
+        virtual void nc_tasks_cancelled(NCNodeID node_id, uint32_t const num_tasks);
+
+        // Optional, signal the end of the job instead of implementing nc_is_job_done().
+        // Each of these switches off the polling, they can be called from any thread:
+        void nc_use_job_signal() noexcept;
+        void nc_mark_job_done() noexcept;
+        void nc_set_remaining_work(uint64_t const remaining) noexcept;
+        void nc_work_done(uint64_t const amount = 1) noexcept;
+        [[nodiscard]] uint64_t nc_get_remaining_work() const noexcept;
+        [[nodiscard]] NCJobState nc_get_job_state() const noexcept;
+
+        // Optional, stop the tasks that have been handed out to the node so far, e.g. if another node has
+        // already finished them. The node drops the tasks that are not done yet and reports them with
+        // nc_tasks_cancelled(), can be called from any thread:
+        void nc_cancel_node_tasks(NCNodeID const& node_id);
+        // Used by the server:
+        void nc_count_node_tasks(NCNodeID const& node_id, bool const supports_cancel);
+        void nc_count_tasks_sent(NCNodeID const& node_id, uint64_t const num_tasks);
+        [[nodiscard]] std::optional<uint64_t> nc_take_cancel_request(NCNodeID const& node_id);
+
+    private:
+        NCJobSignal job_signal_intern;
+        NCCancelRequests cancel_requests_intern;
 };
 
 class NCServer {
@@ -82,17 +230,46 @@ class NCServer {
         NCConfiguration config_intern;
         std::shared_ptr<spdlog::logger> nc_logger;
         std::atomic_bool quit;
-        std::unordered_map<NCNodeID, std::chrono::time_point<std::chrono::steady_clock>> all_nodes;
-        std::mutex server_mutex;
+        // Lock free lookup and update, shared by all client threads:
+        NCNodeRegistry all_nodes;
+        // One timer per node slot, fires when the heartbeat timeout has expired:
+        NCTimerWheel node_timers;
         std::unique_ptr<NCMessageCodecServer> message_codec_intern;
         std::unique_ptr<NCNetworkServerBase> network_server_intern;
         std::shared_ptr<NCServerDataProcessor> data_processor_intern;
+        NCCapabilities capabilities_intern;
+        // Only used if the option serialize_processor is set:
+        std::unique_ptr<NCActorExecutor> processor_actor_intern;
+        // Indexed by NCPipelineStage:
+        std::array<NCStageStatistics, NC_NUM_PIPELINE_STAGES> stage_statistics;
+
+        [[nodiscard]] NCNodeSlot nc_register_new_node(NCNodeID node_id);
+        [[nodiscard]] bool nc_check_job_done();
 
-        void nc_register_new_node(NCNodeID node_id);
-        void nc_update_node_time(NCNodeID node_id);
-        void nc_handle_node(std::unique_ptr<NCNetworkSocketBase> &sock);
+        // Pipeline stages:
+        [[nodiscard]] std::vector<std::thread> nc_start_stage(NCPipelineStage const stage, uint16_t const num_threads,
+            NCBoundedQueue<NCServerRequest>& input, NCBoundedQueue<NCServerRequest>* output,
+            void (NCServer::*function)(NCServerRequest&));
+        void nc_receive_request(NCServerRequest& request);
+        void nc_decode_request(NCServerRequest& request);
+        void nc_process_request(NCServerRequest& request);
+        void nc_encode_answer(NCServerRequest& request);
+        void nc_send_answer(NCServerRequest& request);
+        void nc_log_stage_statistics();
         void nc_check_heartbeat();
-        bool nc_valid_node_id(NCNodeID node_id);
+        [[nodiscard]] std::optional<NCNodeID> nc_find_node(NCNodeSlot const node_slot);
+        void nc_answer_new_data(NCServerRequest& request, NCNodeID const node_id, uint32_t const max_tasks);
+        [[nodiscard]] bool nc_answer_cancel(NCServerRequest& request, NCNodeID const& node_id);
+
+        // All calls to the data processor go through here:
+        template<typename F>
+        std::invoke_result_t<F> nc_call_processor(F&& function) {
+            if (processor_actor_intern) {
+                return processor_actor_intern->nc_call(std::forward<F>(function));
+            }
+
+            return function();
+        }
 };
 }
 
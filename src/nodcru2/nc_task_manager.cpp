@@ -0,0 +1,342 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines the task manager for the server data processor.
+*/
+
+// STD includes:
+#include <algorithm>
+#include <tuple>
+
+// Local includes:
+#include "nc_task_manager.hpp"
+
+namespace nodcru2 {
+NCTaskManager::NCTaskManager(uint32_t const num_tasks):
+    states_intern(num_tasks, NCTaskState::Unprocessed),
+    unprocessed_intern(num_tasks),
+    copies_intern(num_tasks, 0),
+    node_tasks_intern(),
+    num_done_intern(0),
+    num_processing_intern(0),
+    num_speculative_intern(0),
+    max_outstanding_intern(0),
+    max_copies_intern(1),
+    task_mutex()
+    {
+        // The first task is handed out first:
+        for (uint32_t i = 0; i < num_tasks; i++) {
+            unprocessed_intern[i] = num_tasks - 1 - i;
+        }
+    }
+
+void NCTaskManager::nc_assign_task(NCNodeID const& node_id, uint32_t const task_id) {
+    copies_intern[task_id]++;
+    node_tasks_intern[node_id].push_back(NCAssignedTask{task_id, std::chrono::steady_clock::now()});
+}
+
+[[nodiscard]] std::optional<uint32_t> NCTaskManager::nc_next_task(NCNodeID const& node_id) {
+    const std::lock_guard<std::mutex> lock(task_mutex);
+    return nc_take_task(node_id);
+}
+
+[[nodiscard]] std::vector<uint32_t> NCTaskManager::nc_next_tasks(NCNodeID const& node_id, uint32_t const max_tasks) {
+    /*
+    Hand out up to max_tasks tasks with one lock.
+
+    The node processes the tasks in the order of the vector, so
+    nc_task_done(node_id) still returns the right task for each result.
+    */
+
+    const std::lock_guard<std::mutex> lock(task_mutex);
+    std::vector<uint32_t> result;
+
+    while (result.size() < max_tasks) {
+        if (auto const task_id = nc_take_task(node_id)) {
+            result.push_back(*task_id);
+        } else {
+            break;
+        }
+    }
+
+    return result;
+}
+
+[[nodiscard]] std::optional<uint32_t> NCTaskManager::nc_take_task(NCNodeID const& node_id) {
+    while (!unprocessed_intern.empty()) {
+        uint32_t const task_id = unprocessed_intern.back();
+        unprocessed_intern.pop_back();
+
+        // The result of a timed out node may have arrived after the task was given back:
+        if (states_intern[task_id] == NCTaskState::Unprocessed) {
+            states_intern[task_id] = NCTaskState::Processing;
+            num_processing_intern++;
+            nc_assign_task(node_id, task_id);
+            return task_id;
+        }
+    }
+
+    if ((num_processing_intern > 0) && (num_processing_intern <= max_outstanding_intern)) {
+        if (auto const task_id = nc_find_straggler(node_id)) {
+            num_speculative_intern++;
+            nc_assign_task(node_id, *task_id);
+            return task_id;
+        }
+    }
+
+    return std::nullopt;
+}
+
+void NCTaskManager::nc_enable_speculation(uint32_t const max_outstanding, uint8_t const max_copies) {
+    const std::lock_guard<std::mutex> lock(task_mutex);
+    max_outstanding_intern = max_outstanding;
+    max_copies_intern = std::max(max_copies, uint8_t(1));
+}
+
+[[nodiscard]] std::optional<uint32_t> NCTaskManager::nc_find_straggler(NCNodeID const& node_id) const {
+    /*
+    Find the task that has been running the longest.
+
+    Only called at the end of the job, when few tasks are outstanding.
+    A node never gets a backup of a task it is already working on.
+    */
+
+    auto const own_tasks = node_tasks_intern.find(node_id);
+    auto const is_own_task = [this, &own_tasks] (uint32_t const task_id) {
+        if (own_tasks == node_tasks_intern.end()) {
+            return false;
+        }
+
+        return std::any_of(own_tasks->second.begin(), own_tasks->second.end(),
+            [task_id] (NCAssignedTask const& task) { return task.task_id == task_id; });
+    };
+
+    std::optional<NCAssignedTask> straggler;
+
+    for (auto const& [other_id, tasks]: node_tasks_intern) {
+        if (other_id == node_id) {
+            continue;
+        }
+
+        for (NCAssignedTask const& task: tasks) {
+            if ((states_intern[task.task_id] != NCTaskState::Processing) ||
+                (copies_intern[task.task_id] >= max_copies_intern) ||
+                is_own_task(task.task_id)) {
+                continue;
+            }
+
+            if (!straggler || (task.start_time < straggler->start_time)) {
+                straggler = task;
+            }
+        }
+    }
+
+    if (straggler) {
+        return straggler->task_id;
+    }
+
+    return std::nullopt;
+}
+
+void NCTaskManager::nc_release_copy(uint32_t const task_id) {
+    if (copies_intern[task_id] > 0) {
+        copies_intern[task_id]--;
+    }
+}
+
+void NCTaskManager::nc_remove_node_task(NCNodeID const& node_id, uint32_t const task_id) {
+    auto const item = node_tasks_intern.find(node_id);
+
+    if (item == node_tasks_intern.end()) {
+        return;
+    }
+
+    std::deque<NCAssignedTask>& tasks = item->second;
+    // A node only holds a few tasks:
+    auto const position = std::find_if(tasks.begin(), tasks.end(),
+        [task_id] (NCAssignedTask const& task) { return task.task_id == task_id; });
+
+    if (position != tasks.end()) {
+        tasks.erase(position);
+        nc_release_copy(task_id);
+    }
+
+    if (tasks.empty()) {
+        node_tasks_intern.erase(item);
+    }
+}
+
+bool NCTaskManager::nc_set_done(uint32_t const task_id) {
+    NCTaskState& state = states_intern[task_id];
+
+    if (state == NCTaskState::Done) {
+        return false;
+    }
+
+    if (state == NCTaskState::Processing) {
+        num_processing_intern--;
+    }
+
+    state = NCTaskState::Done;
+    num_done_intern++;
+    return true;
+}
+
+bool NCTaskManager::nc_task_done(NCNodeID const& node_id, uint32_t const task_id) {
+    /*
+    Mark the task as done.
+
+    A result is also accepted from a node that has timed out in the meantime,
+    if no other node has finished the task yet.
+    With speculation the first result of all copies wins.
+    */
+
+    const std::lock_guard<std::mutex> lock(task_mutex);
+
+    if (task_id >= states_intern.size()) {
+        return false;
+    }
+
+    nc_remove_node_task(node_id, task_id);
+    return nc_set_done(task_id);
+}
+
+std::optional<uint32_t> NCTaskManager::nc_task_done(NCNodeID const& node_id) {
+    const std::lock_guard<std::mutex> lock(task_mutex);
+    auto const item = node_tasks_intern.find(node_id);
+
+    if (item == node_tasks_intern.end()) {
+        return std::nullopt;
+    }
+
+    uint32_t const task_id = item->second.front().task_id;
+    item->second.pop_front();
+    nc_release_copy(task_id);
+
+    if (item->second.empty()) {
+        node_tasks_intern.erase(item);
+    }
+
+    if (nc_set_done(task_id)) {
+        return task_id;
+    }
+
+    return std::nullopt;
+}
+
+size_t NCTaskManager::nc_node_timeout(NCNodeID const& node_id) {
+    const std::lock_guard<std::mutex> lock(task_mutex);
+    auto const item = node_tasks_intern.find(node_id);
+
+    if (item == node_tasks_intern.end()) {
+        return 0;
+    }
+
+    size_t num_requeued = 0;
+
+    for (NCAssignedTask const& task: item->second) {
+        uint32_t const task_id = task.task_id;
+        nc_release_copy(task_id);
+
+        if (nc_requeue_task(task_id)) {
+            num_requeued++;
+        }
+    }
+
+    node_tasks_intern.erase(item);
+    return num_requeued;
+}
+
+std::optional<uint32_t> NCTaskManager::nc_task_cancelled(NCNodeID const& node_id) {
+    /*
+    The node drops its tasks in the order they were handed out,
+    the same way it sends the results.
+    */
+
+    const std::lock_guard<std::mutex> lock(task_mutex);
+    auto const item = node_tasks_intern.find(node_id);
+
+    if (item == node_tasks_intern.end()) {
+        return std::nullopt;
+    }
+
+    uint32_t const task_id = item->second.front().task_id;
+    item->second.pop_front();
+    nc_release_copy(task_id);
+
+    if (item->second.empty()) {
+        node_tasks_intern.erase(item);
+    }
+
+    std::ignore = nc_requeue_task(task_id);
+    return task_id;
+}
+
+std::optional<uint32_t> NCTaskManager::nc_task_failed(NCNodeID const& node_id) {
+    /*
+    The result can't be used, e.g. it doesn't deserialize. The task is not
+    done, so it is handed out again like a cancelled task.
+    */
+
+    return nc_task_cancelled(node_id);
+}
+
+[[nodiscard]] std::vector<NCNodeID> NCTaskManager::nc_nodes_working_on(uint32_t const task_id) const {
+    const std::lock_guard<std::mutex> lock(task_mutex);
+    std::vector<NCNodeID> result;
+
+    for (auto const& [node_id, tasks]: node_tasks_intern) {
+        if (std::any_of(tasks.begin(), tasks.end(),
+            [task_id] (NCAssignedTask const& task) { return task.task_id == task_id; })) {
+            result.push_back(node_id);
+        }
+    }
+
+    return result;
+}
+
+bool NCTaskManager::nc_requeue_task(uint32_t const task_id) {
+    // Another node is still working on a backup of this task:
+    if ((states_intern[task_id] == NCTaskState::Processing) && (copies_intern[task_id] == 0)) {
+        states_intern[task_id] = NCTaskState::Unprocessed;
+        num_processing_intern--;
+        // Handed out next:
+        unprocessed_intern.push_back(task_id);
+        return true;
+    }
+
+    return false;
+}
+
+[[nodiscard]] bool NCTaskManager::nc_is_done() const {
+    const std::lock_guard<std::mutex> lock(task_mutex);
+    return num_done_intern == states_intern.size();
+}
+
+[[nodiscard]] NCTaskState NCTaskManager::nc_get_state(uint32_t const task_id) const {
+    const std::lock_guard<std::mutex> lock(task_mutex);
+    return states_intern.at(task_id);
+}
+
+[[nodiscard]] uint32_t NCTaskManager::nc_num_tasks() const noexcept {
+    return static_cast<uint32_t>(states_intern.size());
+}
+
+[[nodiscard]] uint32_t NCTaskManager::nc_num_done() const {
+    const std::lock_guard<std::mutex> lock(task_mutex);
+    return num_done_intern;
+}
+
+[[nodiscard]] uint32_t NCTaskManager::nc_num_processing() const {
+    const std::lock_guard<std::mutex> lock(task_mutex);
+    return num_processing_intern;
+}
+
+[[nodiscard]] uint32_t NCTaskManager::nc_num_speculative() const {
+    const std::lock_guard<std::mutex> lock(task_mutex);
+    return num_speculative_intern;
+}
+}
@@ -0,0 +1,121 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines the task manager for the server data processor.
+
+    The job is split into a fixed number of tasks with the ids 0 .. n - 1.
+    The task manager keeps the state of each task, hands out the next
+    unprocessed task in O(1) from a free list, records which node works on
+    which task and puts the tasks of a node that has timed out back into
+    the free list.
+    Tasks that a node has dropped after a Cancel message are put back as well.
+    Near the end of the job the outstanding tasks can be given to idle
+    nodes as well (speculative backup tasks), the first result wins.
+    All methods are thread safe.
+*/
+
+#ifndef FILE_NC_TASK_MANAGER_HPP_INCLUDED
+#define FILE_NC_TASK_MANAGER_HPP_INCLUDED
+
+// STD includes:
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <chrono>
+
+// Local includes:
+#include "nc_nodeid.hpp"
+
+namespace nodcru2 {
+enum struct NCTaskState: uint8_t {
+    Unprocessed = 0,
+    Processing = 1,
+    Done = 2
+};
+
+struct NCAssignedTask {
+    uint32_t task_id = 0;
+    std::chrono::steady_clock::time_point start_time = {};
+};
+
+class NCTaskManager {
+    public:
+        // Returns the next unprocessed task for the node, nothing if no task is left.
+        // If speculation is enabled, this can also be a backup of a task that another node is working on:
+        [[nodiscard]] std::optional<uint32_t> nc_next_task(NCNodeID const& node_id);
+        // Same as above for up to max_tasks tasks, empty if no task is left:
+        [[nodiscard]] std::vector<uint32_t> nc_next_tasks(NCNodeID const& node_id, uint32_t const max_tasks);
+
+        // Give backup tasks to idle nodes, when all tasks are handed out and at most
+        // max_outstanding tasks are not finished yet. Zero disables the speculation (default):
+        void nc_enable_speculation(uint32_t const max_outstanding, uint8_t const max_copies = 2);
+
+        // Returns true if this is the first result for the task, the result should then be kept.
+        // Results for tasks that are already done are ignored:
+        bool nc_task_done(NCNodeID const& node_id, uint32_t const task_id);
+        // Same as above for the oldest task of the node, if the result doesn't contain the task id.
+        // Returns the task id if this is the first result:
+        std::optional<uint32_t> nc_task_done(NCNodeID const& node_id);
+
+        // All unfinished tasks of the node are given to other nodes, returns the number of these tasks:
+        size_t nc_node_timeout(NCNodeID const& node_id);
+        // The node has dropped its oldest task after a Cancel message, it is given to another node
+        // if it is not done yet. Returns the task id:
+        std::optional<uint32_t> nc_task_cancelled(NCNodeID const& node_id);
+        // Same as above if the result for the oldest task of the node is invalid:
+        std::optional<uint32_t> nc_task_failed(NCNodeID const& node_id);
+        // All nodes that are working on the task, e.g. to cancel the other copies when the first result arrives:
+        [[nodiscard]] std::vector<NCNodeID> nc_nodes_working_on(uint32_t const task_id) const;
+
+        [[nodiscard]] bool nc_is_done() const;
+        [[nodiscard]] NCTaskState nc_get_state(uint32_t const task_id) const;
+        [[nodiscard]] uint32_t nc_num_tasks() const noexcept;
+        [[nodiscard]] uint32_t nc_num_done() const;
+        [[nodiscard]] uint32_t nc_num_processing() const;
+        // Number of backup tasks that have been handed out:
+        [[nodiscard]] uint32_t nc_num_speculative() const;
+
+        // Constructor:
+        NCTaskManager(uint32_t const num_tasks);
+
+        // Disable all other special member functions:
+        NCTaskManager() = delete;
+        NCTaskManager(const NCTaskManager&) = delete;
+        NCTaskManager& operator=(const NCTaskManager&) = delete;
+        NCTaskManager(NCTaskManager&&) = delete;
+        NCTaskManager& operator=(NCTaskManager&&) = delete;
+
+    private:
+        std::vector<NCTaskState> states_intern;
+        // Free list of unprocessed tasks, the next task is at the back.
+        // Tasks that are done in the meantime are skipped:
+        std::vector<uint32_t> unprocessed_intern;
+        // Number of nodes that are working on each task:
+        std::vector<uint8_t> copies_intern;
+        // Tasks of each node, oldest first:
+        std::unordered_map<NCNodeID, std::deque<NCAssignedTask>> node_tasks_intern;
+        uint32_t num_done_intern;
+        uint32_t num_processing_intern;
+        uint32_t num_speculative_intern;
+        uint32_t max_outstanding_intern;
+        uint8_t max_copies_intern;
+        mutable std::mutex task_mutex;
+
+        // The lock must be held:
+        [[nodiscard]] std::optional<uint32_t> nc_take_task(NCNodeID const& node_id);
+        void nc_assign_task(NCNodeID const& node_id, uint32_t const task_id);
+        void nc_release_copy(uint32_t const task_id);
+        bool nc_requeue_task(uint32_t const task_id);
+        void nc_remove_node_task(NCNodeID const& node_id, uint32_t const task_id);
+        bool nc_set_done(uint32_t const task_id);
+        [[nodiscard]] std::optional<uint32_t> nc_find_straggler(NCNodeID const& node_id) const;
+};
+}
+
+#endif // FILE_NC_TASK_MANAGER_HPP_INCLUDED
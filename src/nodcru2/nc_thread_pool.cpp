@@ -0,0 +1,286 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines a work stealing thread pool for parallel loops inside
+    one task.
+*/
+
+// STD includes:
+#include <algorithm>
+#include <exception>
+
+// Local includes:
+#include "nc_thread_pool.hpp"
+
+namespace nodcru2 {
+// The part of the index range that belongs to one slot:
+struct NCParallelRange {
+    std::mutex range_mutex;
+    uint64_t next = 0;
+    uint64_t end = 0;
+};
+
+struct NCParallelJob {
+    explicit NCParallelJob(size_t num_slots):
+        ranges(num_slots)
+    {}
+
+    std::function<void(uint32_t, uint64_t, uint64_t)> const* function = nullptr;
+    uint64_t grain = 1;
+    std::vector<NCParallelRange> ranges;
+    // Next slot for a pool thread, slot zero belongs to the calling thread, guarded by the pool mutex:
+    uint32_t next_slot = 1;
+    // Number of indices that are not done yet, the calling thread waits on it:
+    std::atomic<uint64_t> remaining = 0;
+    std::atomic_bool failed = false;
+    std::mutex exception_mutex;
+    std::exception_ptr exception = nullptr;
+};
+
+namespace {
+// Set by the node, see nc_set_node_workers():
+std::atomic<uint32_t> node_workers(1);
+
+[[nodiscard]] bool nc_steal(NCParallelJob& job, uint32_t const slot) {
+    /*
+    Move the upper half of the largest range of another slot into the (empty) range of this slot.
+
+    Returns false if there is nothing left to steal.
+    */
+
+    while (true) {
+        size_t victim = slot;
+        uint64_t largest = 0;
+
+        for (size_t i = 0; i < job.ranges.size(); i++) {
+            if (i == slot) {
+                continue;
+            }
+
+            NCParallelRange& range = job.ranges[i];
+            std::lock_guard<std::mutex> lock(range.range_mutex);
+            if (range.end - range.next > largest) {
+                largest = range.end - range.next;
+                victim = i;
+            }
+        }
+
+        if (largest == 0) {
+            return false;
+        }
+
+        NCParallelRange& own = job.ranges[slot];
+        NCParallelRange& other = job.ranges[victim];
+        std::scoped_lock lock(own.range_mutex, other.range_mutex);
+
+        if (other.next < other.end) {
+            // Take everything if only one index is left:
+            uint64_t const middle = other.next + ((other.end - other.next) / 2);
+            own.next = middle;
+            own.end = other.end;
+            other.end = middle;
+            return true;
+        }
+        // Someone else was faster, look again.
+    }
+}
+
+[[nodiscard]] bool nc_take_range(NCParallelJob& job, uint32_t const slot, uint64_t& range_begin, uint64_t& range_end) {
+    /*
+    Take the next piece of the own range, steal from another slot if it is empty.
+    */
+
+    NCParallelRange& own = job.ranges[slot];
+
+    do {
+        std::lock_guard<std::mutex> lock(own.range_mutex);
+        if (own.next < own.end) {
+            range_begin = own.next;
+            range_end = std::min(own.end, own.next + job.grain);
+            own.next = range_end;
+            return true;
+        }
+    } while (nc_steal(job, slot));
+
+    return false;
+}
+
+void nc_work(NCParallelJob& job, uint32_t const slot) {
+    uint64_t range_begin = 0;
+    uint64_t range_end = 0;
+
+    while (nc_take_range(job, slot, range_begin, range_end)) {
+        // After an exception the rest is only counted:
+        if (!job.failed.load(std::memory_order_acquire)) {
+            try {
+                (*job.function)(slot, range_begin, range_end);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(job.exception_mutex);
+                if (!job.exception) {
+                    job.exception = std::current_exception();
+                }
+                job.failed.store(true, std::memory_order_release);
+            }
+        }
+
+        uint64_t const count = range_end - range_begin;
+        if (job.remaining.fetch_sub(count, std::memory_order_acq_rel) == count) {
+            job.remaining.notify_all();
+        }
+    }
+}
+}
+
+NCThreadPool::NCThreadPool(uint32_t num_threads):
+    pool_mutex(),
+    pool_condition(),
+    jobs_intern(),
+    num_users_intern(1),
+    running_intern(true),
+    threads_intern()
+    {
+        for (uint32_t i = 0; i < num_threads; i++) {
+            threads_intern.emplace_back([this] () {nc_run();});
+        }
+    }
+
+NCThreadPool::~NCThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        running_intern = false;
+    }
+    pool_condition.notify_all();
+
+    for (std::thread& thread: threads_intern) {
+        thread.join();
+    }
+}
+
+void NCThreadPool::nc_run_ranges(uint64_t begin, uint64_t end, uint64_t grain,
+    std::function<void(uint32_t, uint64_t, uint64_t)> const& function) {
+    /*
+    Run the function over all ranges, the calling thread takes part in the work.
+
+    Each call only uses its share of the pool threads, so that all users of the
+    pool together don't run on more threads than there are in the pool (plus the users).
+    Nested calls from inside function are allowed, the calling thread never waits
+    for work that nobody is doing.
+    */
+
+    if (begin >= end) {
+        return;
+    }
+
+    uint64_t const count = end - begin;
+    uint32_t const num_threads = nc_num_threads();
+    uint32_t const num_users = std::max(num_users_intern.load(std::memory_order_relaxed), uint32_t(1));
+    uint64_t num_helpers = std::min(num_threads, std::max((num_threads + 1) / num_users, uint32_t(1)) - 1);
+
+    if (grain == 0) {
+        // A few pieces per thread, so that the work can be balanced:
+        grain = std::max(count / ((num_helpers + 1) * 8), uint64_t(1));
+    }
+
+    num_helpers = std::min(num_helpers, ((count + grain - 1) / grain) - 1);
+
+    if (num_helpers == 0) {
+        function(0, begin, end);
+        return;
+    }
+
+    const std::shared_ptr<NCParallelJob> job = std::make_shared<NCParallelJob>(num_helpers + 1);
+    job->function = &function;
+    job->grain = grain;
+    job->remaining.store(count, std::memory_order_relaxed);
+
+    uint64_t const part = count / job->ranges.size();
+    uint64_t const extra = count % job->ranges.size();
+    uint64_t next = begin;
+
+    for (size_t i = 0; i < job->ranges.size(); i++) {
+        job->ranges[i].next = next;
+        next += part + ((i < extra) ? 1 : 0);
+        job->ranges[i].end = next;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        jobs_intern.push_back(job);
+    }
+    pool_condition.notify_all();
+
+    nc_work(*job, 0);
+
+    // The rest is being processed by other threads:
+    uint64_t remaining = job->remaining.load(std::memory_order_acquire);
+    while (remaining != 0) {
+        job->remaining.wait(remaining, std::memory_order_acquire);
+        remaining = job->remaining.load(std::memory_order_acquire);
+    }
+
+    {
+        // Not all slots were taken if the pool threads were busy:
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        std::erase(jobs_intern, job);
+    }
+
+    if (job->exception) {
+        std::rethrow_exception(job->exception);
+    }
+}
+
+void NCThreadPool::nc_set_num_users(uint32_t num_users) {
+    num_users_intern.store(num_users, std::memory_order_relaxed);
+}
+
+[[nodiscard]] uint32_t NCThreadPool::nc_num_threads() const {
+    return static_cast<uint32_t>(threads_intern.size());
+}
+
+[[nodiscard]] uint32_t NCThreadPool::nc_max_slots() const {
+    return nc_num_threads() + 1;
+}
+
+void NCThreadPool::nc_run() {
+    while (true) {
+        std::shared_ptr<NCParallelJob> job;
+        uint32_t slot = 0;
+
+        {
+            std::unique_lock<std::mutex> lock(pool_mutex);
+            pool_condition.wait(lock, [this] () {return !running_intern || !jobs_intern.empty();});
+
+            if (!running_intern) {
+                return;
+            }
+
+            job = jobs_intern.front();
+            slot = job->next_slot;
+            job->next_slot++;
+
+            if (job->next_slot >= job->ranges.size()) {
+                jobs_intern.pop_front();
+            }
+        }
+
+        nc_work(*job, slot);
+    }
+}
+
+[[nodiscard]] NCThreadPool& nc_node_thread_pool() {
+    /*
+    One thread less than cores, the calling worker is the last one.
+    */
+
+    static NCThreadPool node_pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    node_pool.nc_set_num_users(node_workers.load(std::memory_order_relaxed));
+    return node_pool;
+}
+
+void nc_set_node_workers(uint32_t num_workers) {
+    node_workers.store(num_workers, std::memory_order_relaxed);
+}
+}
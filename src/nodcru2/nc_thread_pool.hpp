@@ -0,0 +1,122 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines a work stealing thread pool for parallel loops inside
+    one task.
+
+    The index range of a loop is split into one part per thread, the calling
+    thread works on the first part. A thread that is done with its part steals
+    the upper half of the largest remaining part from another thread.
+    The node wide pool knows the number of workers of the node (num_workers),
+    so the workers and the pool together don't use more threads than cores.
+*/
+
+#ifndef FILE_NC_THREAD_POOL_HPP_INCLUDED
+#define FILE_NC_THREAD_POOL_HPP_INCLUDED
+
+// STD includes:
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <utility>
+
+namespace nodcru2 {
+struct NCParallelJob;
+
+class NCThreadPool {
+    public:
+        // Call function(i) for all i in [begin, end), grain is the number of
+        // indices that are processed in one piece, zero: choose automatically.
+        // The first exception is thrown again in the calling thread:
+        template<typename F>
+        void nc_parallel_for(uint64_t begin, uint64_t end, F&& function, uint64_t grain = 0) {
+            nc_run_ranges(begin, end, grain, [&function] (uint32_t, uint64_t range_begin, uint64_t range_end) {
+                for (uint64_t i = range_begin; i < range_end; i++) {
+                    function(i);
+                }
+            });
+        }
+
+        // Call fold(value, i) for all i in [begin, end), each thread folds into its own value
+        // that starts with identity. At the end all values are merged with combine(result, value):
+        template<typename T, typename Fold, typename Combine>
+        [[nodiscard]] T nc_parallel_reduce(uint64_t begin, uint64_t end, T identity, Fold&& fold,
+            Combine&& combine, uint64_t grain = 0) {
+            std::vector<T> values(nc_max_slots(), identity);
+
+            nc_run_ranges(begin, end, grain, [&values, &fold] (uint32_t slot, uint64_t range_begin, uint64_t range_end) {
+                for (uint64_t i = range_begin; i < range_end; i++) {
+                    fold(values[slot], i);
+                }
+            });
+
+            T result = std::move(identity);
+            for (T const& value: values) {
+                combine(result, value);
+            }
+            return result;
+        }
+
+        // Split [begin, end) into ranges and call function(slot, range_begin, range_end) for each of them.
+        // A slot is used by only one thread at a time and is smaller than nc_max_slots():
+        void nc_run_ranges(uint64_t begin, uint64_t end, uint64_t grain,
+            std::function<void(uint32_t, uint64_t, uint64_t)> const& function);
+        // Number of threads that share the pool at the same time, each call uses only its part of the threads:
+        void nc_set_num_users(uint32_t num_users);
+        [[nodiscard]] uint32_t nc_num_threads() const;
+        [[nodiscard]] uint32_t nc_max_slots() const;
+
+        // Constructor:
+        explicit NCThreadPool(uint32_t num_threads);
+
+        // Destructor, waits for all threads:
+        ~NCThreadPool();
+
+        // Disable all other special member functions:
+        NCThreadPool() = delete;
+        NCThreadPool(const NCThreadPool&) = delete;
+        NCThreadPool& operator=(const NCThreadPool&) = delete;
+        NCThreadPool(NCThreadPool&&) = delete;
+        NCThreadPool& operator=(NCThreadPool&&) = delete;
+
+    private:
+        std::mutex pool_mutex;
+        std::condition_variable pool_condition;
+        // Jobs that still have a free slot for a pool thread:
+        std::deque<std::shared_ptr<NCParallelJob>> jobs_intern;
+        std::atomic<uint32_t> num_users_intern;
+        bool running_intern;
+        std::vector<std::thread> threads_intern;
+
+        void nc_run();
+};
+
+// The pool that is shared by all workers of the node, it is created on the first call:
+[[nodiscard]] NCThreadPool& nc_node_thread_pool();
+// Called by the node with the configuration option num_workers:
+void nc_set_node_workers(uint32_t num_workers);
+
+// Parallel loops on the node wide pool, can be used inside NCNodeDataProcessor::nc_process_data():
+template<typename F>
+void nc_parallel_for(uint64_t begin, uint64_t end, F&& function, uint64_t grain = 0) {
+    nc_node_thread_pool().nc_parallel_for(begin, end, std::forward<F>(function), grain);
+}
+
+template<typename T, typename Fold, typename Combine>
+[[nodiscard]] T nc_parallel_reduce(uint64_t begin, uint64_t end, T identity, Fold&& fold,
+    Combine&& combine, uint64_t grain = 0) {
+    return nc_node_thread_pool().nc_parallel_reduce(begin, end, std::move(identity),
+        std::forward<Fold>(fold), std::forward<Combine>(combine), grain);
+}
+}
+
+#endif // FILE_NC_THREAD_POOL_HPP_INCLUDED
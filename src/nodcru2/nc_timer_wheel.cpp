@@ -0,0 +1,105 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines a hashed timer wheel.
+*/
+
+// STD includes:
+#include <algorithm>
+
+// Local includes:
+#include "nc_timer_wheel.hpp"
+
+namespace nodcru2 {
+NCTimerWheel::NCTimerWheel(std::chrono::steady_clock::duration const tick):
+    start_intern(std::chrono::steady_clock::now()),
+    tick_intern(std::max(tick, std::chrono::steady_clock::duration(1))),
+    current_tick_intern(0),
+    buckets_intern(),
+    deadlines_intern(),
+    wheel_mutex()
+    {}
+
+[[nodiscard]] uint64_t NCTimerWheel::nc_to_tick(std::chrono::steady_clock::time_point const time_point) const noexcept {
+    if (time_point <= start_intern) {
+        return 0;
+    }
+
+    // Round up, a timer never fires too early:
+    auto const elapsed = time_point - start_intern;
+    return static_cast<uint64_t>((elapsed + tick_intern - std::chrono::steady_clock::duration(1)) / tick_intern);
+}
+
+void NCTimerWheel::nc_schedule(uint32_t const id, std::chrono::steady_clock::time_point const deadline) {
+    const std::lock_guard<std::mutex> lock(wheel_mutex);
+    // A timer in the past fires with the next tick:
+    uint64_t const tick = std::max(nc_to_tick(deadline), current_tick_intern + 1);
+
+    if (id >= deadlines_intern.size()) {
+        deadlines_intern.resize(static_cast<size_t>(id) + 1, 0);
+    }
+
+    deadlines_intern[id] = tick;
+    buckets_intern[tick % NC_TIMER_WHEEL_SIZE].push_back(NCTimer{id, tick});
+}
+
+void NCTimerWheel::nc_cancel(uint32_t const id) {
+    const std::lock_guard<std::mutex> lock(wheel_mutex);
+
+    if (id < deadlines_intern.size()) {
+        // The entry in the bucket is removed when it is processed:
+        deadlines_intern[id] = 0;
+    }
+}
+
+[[nodiscard]] std::vector<uint32_t> NCTimerWheel::nc_advance(std::chrono::steady_clock::time_point const current_time) {
+    /*
+    Process all buckets between the last call and the current time.
+
+    Entries that have been scheduled again or cancelled are removed,
+    entries for a later round of the wheel stay in the bucket.
+    */
+
+    std::vector<uint32_t> result;
+
+    const std::lock_guard<std::mutex> lock(wheel_mutex);
+    // Only whole ticks that have passed completely:
+    uint64_t const target_tick = static_cast<uint64_t>((current_time - start_intern) / tick_intern);
+
+    if (current_time <= start_intern || target_tick <= current_tick_intern) {
+        return result;
+    }
+
+    // Each bucket has to be processed only once, even if more time has passed:
+    uint64_t const num_ticks = std::min(target_tick - current_tick_intern, uint64_t(NC_TIMER_WHEEL_SIZE));
+
+    for (uint64_t i = 1; i <= num_ticks; i++) {
+        std::vector<NCTimer>& bucket = buckets_intern[(current_tick_intern + i) % NC_TIMER_WHEEL_SIZE];
+
+        std::erase_if(bucket, [this, target_tick, &result](NCTimer const& timer) {
+            if (deadlines_intern[timer.id] != timer.deadline) {
+                // Scheduled again or cancelled:
+                return true;
+            }
+
+            if (timer.deadline <= target_tick) {
+                deadlines_intern[timer.id] = 0;
+                result.push_back(timer.id);
+                return true;
+            }
+
+            return false;
+        });
+    }
+
+    current_tick_intern = target_tick;
+    return result;
+}
+
+[[nodiscard]] std::chrono::steady_clock::duration NCTimerWheel::nc_get_tick() const noexcept {
+    return tick_intern;
+}
+}
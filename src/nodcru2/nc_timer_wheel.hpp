@@ -0,0 +1,69 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines a hashed timer wheel.
+
+    Each timer belongs to a small dense id (the node slot). A timer can be
+    scheduled again at any time, the old entry is then ignored when its
+    bucket is processed. Advancing the wheel only touches the buckets of
+    the elapsed ticks, so the cost depends on the number of expired timers
+    and not on the number of all timers.
+*/
+
+#ifndef FILE_NC_TIMER_WHEEL_HPP_INCLUDED
+#define FILE_NC_TIMER_WHEEL_HPP_INCLUDED
+
+// STD includes:
+#include <cstdint>
+#include <vector>
+#include <array>
+#include <mutex>
+#include <chrono>
+
+namespace nodcru2 {
+// Number of buckets, timers further in the future stay in their bucket for more rounds:
+size_t const NC_TIMER_WHEEL_SIZE = 256;
+
+struct NCTimer {
+    uint32_t id = 0;
+    uint64_t deadline = 0;
+};
+
+class NCTimerWheel {
+    public:
+        // Schedule the timer for the given id, an existing timer is replaced:
+        void nc_schedule(uint32_t const id, std::chrono::steady_clock::time_point const deadline);
+        void nc_cancel(uint32_t const id);
+        // Returns all ids whose timer has expired, each timer fires only once:
+        [[nodiscard]] std::vector<uint32_t> nc_advance(std::chrono::steady_clock::time_point const current_time);
+
+        [[nodiscard]] std::chrono::steady_clock::duration nc_get_tick() const noexcept;
+
+        // Constructor:
+        NCTimerWheel(std::chrono::steady_clock::duration const tick);
+
+        // Disable all other special member functions:
+        NCTimerWheel() = delete;
+        NCTimerWheel(const NCTimerWheel&) = delete;
+        NCTimerWheel& operator=(const NCTimerWheel&) = delete;
+        NCTimerWheel(NCTimerWheel&&) = delete;
+        NCTimerWheel& operator=(NCTimerWheel&&) = delete;
+
+    private:
+        std::chrono::steady_clock::time_point start_intern;
+        std::chrono::steady_clock::duration tick_intern;
+        // All ticks up to this one have been processed:
+        uint64_t current_tick_intern;
+        std::array<std::vector<NCTimer>, NC_TIMER_WHEEL_SIZE> buckets_intern;
+        // Current deadline for each id, zero if no timer is scheduled:
+        std::vector<uint64_t> deadlines_intern;
+        std::mutex wheel_mutex;
+
+        [[nodiscard]] uint64_t nc_to_tick(std::chrono::steady_clock::time_point const time_point) const noexcept;
+};
+}
+
+#endif // FILE_NC_TIMER_WHEEL_HPP_INCLUDED
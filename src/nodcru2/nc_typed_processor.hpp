@@ -0,0 +1,103 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file defines the typed data processors for the server and the node.
+
+    The user works with the types InitT, TaskT and ResultT directly, the
+    data is serialized and deserialized with the given serializers.
+    The typed processors can be used everywhere where NCServerDataProcessor
+    and NCNodeDataProcessor are expected.
+*/
+
+#ifndef FILE_NC_TYPED_PROCESSOR_HPP_INCLUDED
+#define FILE_NC_TYPED_PROCESSOR_HPP_INCLUDED
+
+// STD includes:
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+// Local includes:
+#include "nc_serializer.hpp"
+#include "nc_server.hpp"
+#include "nc_node.hpp"
+
+namespace nodcru2 {
+template <typename InitT, typename TaskT, typename ResultT,
+    typename InitS = NCBinarySerializer<InitT>,
+    typename TaskS = NCBinarySerializer<TaskT>,
+    typename ResultS = NCBinarySerializer<ResultT>>
+requires NCSerializer<InitS, InitT> && NCSerializer<TaskS, TaskT> && NCSerializer<ResultS, ResultT>
+class NCTypedServerProcessor: public NCServerDataProcessor {
+    public:
+        // Default special member functions:
+        NCTypedServerProcessor() = default;
+        virtual ~NCTypedServerProcessor() = default;
+        NCTypedServerProcessor(NCTypedServerProcessor&&) = default;
+        NCTypedServerProcessor(const NCTypedServerProcessor&) = default;
+        NCTypedServerProcessor& operator=(const NCTypedServerProcessor&) = default;
+        NCTypedServerProcessor& operator=(NCTypedServerProcessor&&) = default;
+
+        // Must be implemented by the user:
+        [[nodiscard]] virtual InitT nc_get_typed_init_data() = 0;
+        [[nodiscard]] virtual TaskT nc_get_typed_new_data(NCNodeID node_id) = 0;
+        virtual void nc_process_typed_result(NCNodeID node_id, ResultT result) = 0;
+
+        // Called by the server:
+        [[nodiscard]] std::vector<uint8_t> nc_get_init_data() final {
+            return init_serializer_intern.nc_serialize(nc_get_typed_init_data());
+        }
+
+        [[nodiscard]] std::vector<uint8_t> nc_get_new_data(NCNodeID node_id) final {
+            return task_serializer_intern.nc_serialize(nc_get_typed_new_data(node_id));
+        }
+
+        void nc_process_result(NCNodeID node_id, std::vector<uint8_t> result) final {
+            nc_process_typed_result(node_id, result_serializer_intern.nc_deserialize(result));
+        }
+
+    private:
+        InitS init_serializer_intern;
+        TaskS task_serializer_intern;
+        ResultS result_serializer_intern;
+};
+
+template <typename InitT, typename TaskT, typename ResultT,
+    typename InitS = NCBinarySerializer<InitT>,
+    typename TaskS = NCBinarySerializer<TaskT>,
+    typename ResultS = NCBinarySerializer<ResultT>>
+requires NCSerializer<InitS, InitT> && NCSerializer<TaskS, TaskT> && NCSerializer<ResultS, ResultT>
+class NCTypedNodeProcessor: public NCNodeDataProcessor {
+    public:
+        // Default special member functions:
+        NCTypedNodeProcessor() = default;
+        virtual ~NCTypedNodeProcessor() = default;
+        NCTypedNodeProcessor(NCTypedNodeProcessor&&) = default;
+        NCTypedNodeProcessor(const NCTypedNodeProcessor&) = default;
+        NCTypedNodeProcessor& operator=(const NCTypedNodeProcessor&) = default;
+        NCTypedNodeProcessor& operator=(NCTypedNodeProcessor&&) = default;
+
+        // Must be implemented by the user:
+        virtual void nc_typed_init(InitT init_data, NCNodeID node_id) = 0;
+        [[nodiscard]] virtual ResultT nc_process_typed_data(TaskT data) = 0;
+
+        // Called by the node:
+        void nc_init(std::vector<uint8_t> data, NCNodeID node_id) final {
+            nc_typed_init(init_serializer_intern.nc_deserialize(data), node_id);
+        }
+
+        [[nodiscard]] std::vector<uint8_t> nc_process_data(std::vector<uint8_t> data) final {
+            return result_serializer_intern.nc_serialize(nc_process_typed_data(task_serializer_intern.nc_deserialize(data)));
+        }
+
+    private:
+        InitS init_serializer_intern;
+        TaskS task_serializer_intern;
+        ResultS result_serializer_intern;
+};
+}
+
+#endif // FILE_NC_TYPED_PROCESSOR_HPP_INCLUDED
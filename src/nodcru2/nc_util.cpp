@@ -36,6 +36,60 @@ void nc_to_big_endian_bytes(uint32_t const value, std::span<uint8_t> bytes) noex
     return result;
 }
 
+void nc_to_big_endian_bytes16(uint16_t const value, std::span<uint8_t> bytes) noexcept {
+    uint16_t final_value = value;
+
+    if (std::endian::native == std::endian::little) {
+        final_value = std::byteswap(value);
+    }
+
+    std::memcpy(bytes.data(), &final_value, sizeof(uint16_t));
+}
+
+[[nodiscard]] uint16_t nc_from_big_endian_bytes16(std::span<const uint8_t> const bytes) {
+    uint16_t result;
+
+    std::memcpy(&result, bytes.data(), sizeof(uint16_t));
+
+    if (std::endian::native == std::endian::little) {
+        result = std::byteswap(result);
+    }
+
+    return result;
+}
+
+void nc_to_big_endian_bytes64(uint64_t const value, std::span<uint8_t> bytes) noexcept {
+    uint64_t final_value = value;
+
+    if (std::endian::native == std::endian::little) {
+        final_value = std::byteswap(value);
+    }
+
+    std::memcpy(bytes.data(), &final_value, sizeof(uint64_t));
+}
+
+[[nodiscard]] uint64_t nc_from_big_endian_bytes64(std::span<const uint8_t> const bytes) {
+    uint64_t result;
+
+    std::memcpy(&result, bytes.data(), sizeof(uint64_t));
+
+    if (std::endian::native == std::endian::little) {
+        result = std::byteswap(result);
+    }
+
+    return result;
+}
+
+[[nodiscard]] uint8_t nc_codec_to_byte(NCCodecID const codec) noexcept {
+    // Upper four bits: encryption, lower four bits: compressor
+    return static_cast<uint8_t>((static_cast<uint8_t>(codec.encryption) << 4) |
+        (static_cast<uint8_t>(codec.compressor) & 0x0Fu));
+}
+
+[[nodiscard]] NCCodecID nc_codec_from_byte(uint8_t const value) noexcept {
+    return NCCodecID{static_cast<NCCompressorID>(value & 0x0Fu), static_cast<NCEncryptionID>(value >> 4)};
+}
+
 [[nodiscard]] std::string nc_type_to_string(NCNodeMessageType const& msg_type) {
     std::string result = "Unknown type";
 
@@ -52,6 +106,15 @@ void nc_to_big_endian_bytes(uint32_t const value, std::span<uint8_t> bytes) noex
         case NCNodeMessageType::NodeNeedsMoreData:
             result = "NodeNeedsMoreData";
         break;
+        case NCNodeMessageType::ResultNeedsMoreData:
+            result = "ResultNeedsMoreData";
+        break;
+        case NCNodeMessageType::NewResultBatchFromNode:
+            result = "NewResultBatchFromNode";
+        break;
+        case NCNodeMessageType::TasksCancelled:
+            result = "TasksCancelled";
+        break;
     }
 
     return result;
@@ -82,6 +145,12 @@ void nc_to_big_endian_bytes(uint32_t const value, std::span<uint8_t> bytes) noex
         case NCServerMessageType::Quit:
             result = "Quit";
         break;
+        case NCServerMessageType::NewDataBatchFromServer:
+            result = "NewDataBatchFromServer";
+        break;
+        case NCServerMessageType::Cancel:
+            result = "Cancel";
+        break;
     }
 
     return result;
@@ -25,6 +25,18 @@ void nc_to_big_endian_bytes(uint32_t const, std::span<uint8_t>) noexcept;
 
 [[nodiscard]] uint32_t nc_from_big_endian_bytes(std::span<const uint8_t> const);
 
+void nc_to_big_endian_bytes16(uint16_t const, std::span<uint8_t>) noexcept;
+
+[[nodiscard]] uint16_t nc_from_big_endian_bytes16(std::span<const uint8_t> const);
+
+void nc_to_big_endian_bytes64(uint64_t const, std::span<uint8_t>) noexcept;
+
+[[nodiscard]] uint64_t nc_from_big_endian_bytes64(std::span<const uint8_t> const);
+
+[[nodiscard]] uint8_t nc_codec_to_byte(NCCodecID const) noexcept;
+
+[[nodiscard]] NCCodecID nc_codec_from_byte(uint8_t const) noexcept;
+
 [[nodiscard]] std::string nc_type_to_string(NCNodeMessageType const&);
 
 [[nodiscard]] std::string nc_type_to_string(NCServerMessageType const&);
@@ -0,0 +1,63 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file contains the tests for the actor executor.
+
+    Run only actor tests:
+    xmake run -w ./ nc_test [actor]
+*/
+
+// STD includes:
+#include <thread>
+#include <vector>
+#include <stdexcept>
+
+// External includes:
+#include <snitch/snitch.hpp>
+
+// Local includes:
+#include "nodcru2/nc_actor.hpp"
+
+using namespace nodcru2;
+
+TEST_CASE("Call a function on the actor thread", "[actor]" ) {
+    NCActorExecutor actor;
+
+    REQUIRE(actor.nc_call([] () {return 42;}) == 42);
+    REQUIRE(actor.nc_call([] () {return std::this_thread::get_id();}) != std::this_thread::get_id());
+
+    // Nested calls run directly:
+    REQUIRE(actor.nc_call([&actor] () {return actor.nc_call([] () {return 7;});}) == 7);
+}
+
+TEST_CASE("Exception in actor function", "[actor]" ) {
+    NCActorExecutor actor;
+
+    REQUIRE_THROWS_AS(actor.nc_call([] () {throw std::runtime_error("Actor error");}), std::runtime_error);
+    // The actor thread is still running:
+    REQUIRE(actor.nc_call([] () {return 1;}) == 1);
+}
+
+TEST_CASE("Call from many threads", "[actor]" ) {
+    NCActorExecutor actor;
+    // Not synchronized, only changed on the actor thread:
+    uint64_t counter = 0;
+    std::vector<std::thread> threads;
+
+    for (uint32_t i = 0; i < 8; i++) {
+        threads.emplace_back([&actor, &counter] () {
+            for (uint32_t j = 0; j < 1000; j++) {
+                actor.nc_call([&counter] () {counter++;});
+            }
+        });
+    }
+
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    REQUIRE(actor.nc_call([&counter] () {return counter;}) == 8000);
+}
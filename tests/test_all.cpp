@@ -12,12 +12,25 @@
     List all tests: xmake run -w ./ nc_test -l
 */
 
+#include "test_actor.hpp"
+#include "test_bounded_queue.hpp"
+#include "test_buffer_pool.hpp"
+#include "test_capability.hpp"
+#include "test_chunk_scheduler.hpp"
 #include "test_compression.hpp"
 #include "test_encryption.hpp"
 #include "test_config.hpp"
+#include "test_failure_detector.hpp"
 #include "test_message.hpp"
 #include "test_node.hpp"
+#include "test_node_registry.hpp"
 #include "test_nodeid.hpp"
+#include "test_reduction.hpp"
+#include "test_serializer.hpp"
 #include "test_server_node.hpp"
 #include "test_server.hpp"
+#include "test_task_manager.hpp"
+#include "test_thread_pool.hpp"
+#include "test_timer_wheel.hpp"
+#include "test_typed_processor.hpp"
 #include "test_util.hpp"
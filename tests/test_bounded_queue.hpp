@@ -0,0 +1,114 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file contains the tests for the bounded queue.
+
+    Run only bounded queue tests:
+    xmake run -w ./ nc_test [bounded_queue]
+*/
+
+// STD includes:
+#include <thread>
+#include <vector>
+#include <atomic>
+
+// External includes:
+#include <snitch/snitch.hpp>
+
+// Local includes:
+#include "nodcru2/nc_bounded_queue.hpp"
+
+using namespace nodcru2;
+
+TEST_CASE("Push and pop in order", "[bounded_queue]" ) {
+    NCBoundedQueue<uint32_t> queue(4);
+
+    REQUIRE(queue.nc_push(1));
+    REQUIRE(queue.nc_push(2));
+    REQUIRE(queue.nc_push(3));
+    REQUIRE(queue.nc_size() == 3);
+
+    REQUIRE(*queue.nc_pop() == 1);
+    REQUIRE(*queue.nc_pop() == 2);
+
+    // Remaining items can be popped after close:
+    queue.nc_close();
+    REQUIRE(!queue.nc_push(4));
+    REQUIRE(*queue.nc_pop() == 3);
+    REQUIRE(!queue.nc_pop().has_value());
+}
+
+TEST_CASE("Pop without waiting", "[bounded_queue]" ) {
+    NCBoundedQueue<uint32_t> queue(2);
+
+    REQUIRE(!queue.nc_try_pop().has_value());
+    REQUIRE(queue.nc_push(1));
+    REQUIRE(queue.nc_push(2));
+    REQUIRE(*queue.nc_try_pop() == 1);
+
+    // There is room again:
+    REQUIRE(queue.nc_push(3));
+    REQUIRE(*queue.nc_try_pop() == 2);
+    REQUIRE(*queue.nc_try_pop() == 3);
+    REQUIRE(!queue.nc_try_pop().has_value());
+}
+
+TEST_CASE("Full queue blocks the producer", "[bounded_queue]" ) {
+    NCBoundedQueue<uint32_t> queue(2);
+    std::atomic<uint32_t> pushed = 0;
+
+    std::thread producer([&queue, &pushed] () {
+        for (uint32_t i = 0; i < 10; i++) {
+            queue.nc_push(i);
+            pushed++;
+        }
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    REQUIRE(pushed.load() == 2);
+
+    for (uint32_t i = 0; i < 10; i++) {
+        REQUIRE(*queue.nc_pop() == i);
+    }
+
+    producer.join();
+    REQUIRE(pushed.load() == 10);
+}
+
+TEST_CASE("Many producers and consumers", "[bounded_queue]" ) {
+    NCBoundedQueue<uint64_t> queue(8);
+    std::atomic<uint64_t> sum = 0;
+    std::vector<std::thread> producers;
+    std::vector<std::thread> consumers;
+
+    for (uint32_t i = 0; i < 4; i++) {
+        consumers.emplace_back([&queue, &sum] () {
+            while (auto item = queue.nc_pop()) {
+                sum += *item;
+            }
+        });
+    }
+
+    for (uint32_t i = 0; i < 4; i++) {
+        producers.emplace_back([&queue] () {
+            for (uint64_t j = 1; j <= 1000; j++) {
+                queue.nc_push(j);
+            }
+        });
+    }
+
+    for (auto& thread: producers) {
+        thread.join();
+    }
+
+    queue.nc_close();
+
+    for (auto& thread: consumers) {
+        thread.join();
+    }
+
+    REQUIRE(sum.load() == 4 * 500500);
+}
@@ -0,0 +1,58 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file contains the tests for the buffer pool.
+
+    Run only buffer pool tests:
+    xmake run -w ./ nc_test [buffer_pool]
+*/
+
+// STD includes:
+#include <vector>
+
+// External includes:
+#include <snitch/snitch.hpp>
+
+// Local includes:
+#include "nodcru2/nc_buffer_pool.hpp"
+
+using namespace nodcru2;
+
+TEST_CASE("Acquire buffer", "[buffer_pool]" ) {
+    std::vector<uint8_t> buffer1 = nc_acquire_buffer(1000);
+    std::vector<uint8_t> buffer2 = nc_acquire_buffer(0);
+
+    REQUIRE(buffer1.size() == 1000);
+    REQUIRE(buffer1.capacity() >= 1024);
+    REQUIRE(buffer2.size() == 0);
+}
+
+TEST_CASE("Reuse released buffer", "[buffer_pool]" ) {
+    std::vector<uint8_t> buffer1 = nc_acquire_buffer(3000);
+    uint8_t const* const data1 = buffer1.data();
+    nc_release_buffer(std::move(buffer1));
+
+    // Same size class, the buffer is reused:
+    std::vector<uint8_t> buffer2 = nc_acquire_buffer(2500);
+
+    REQUIRE(buffer1.capacity() == 0);
+    REQUIRE(buffer2.data() == data1);
+    REQUIRE(buffer2.size() == 2500);
+
+    nc_release_buffer(std::move(buffer2));
+}
+
+TEST_CASE("Large buffer is not pooled", "[buffer_pool]" ) {
+    size_t const size = (size_t(1) << NC_POOL_MAX_SHIFT) + 1;
+    std::vector<uint8_t> buffer1 = nc_acquire_buffer(size);
+
+    REQUIRE(buffer1.size() == size);
+
+    nc_release_buffer(std::move(buffer1));
+    std::vector<uint8_t> buffer2 = nc_acquire_buffer(1 << 20);
+
+    REQUIRE(buffer2.capacity() < size);
+}
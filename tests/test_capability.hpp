@@ -0,0 +1,142 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file contains the tests for the capability negotiation.
+
+    Run only capability tests:
+    xmake run -w ./ nc_test [capability]
+*/
+
+// External includes:
+#include <snitch/snitch.hpp>
+
+// Local includes:
+#include "nodcru2/nc_capability.hpp"
+#include "nodcru2/nc_exceptions.hpp"
+
+using namespace nodcru2;
+
+TEST_CASE("Encode / decode capabilities", "[capability]" ) {
+    NCCapabilities capabilities1;
+    capabilities1.max_frame_size = 1024 * 1024;
+    capabilities1.features = NC_FEATURE_PERSISTENT_CONNECTION;
+    capabilities1.preferred_compressor = NCCompressorID::LZ4HC;
+    capabilities1.preferred_encryption = NCEncryptionID::AES256GCM;
+
+    auto const data = nc_encode_capabilities(capabilities1);
+    REQUIRE(data.size() == NC_CAPABILITIES_LENGTH);
+
+    auto const capabilities2 = nc_decode_capabilities(data);
+    REQUIRE(capabilities2.protocol_version == NC_PROTOCOL_VERSION);
+    REQUIRE(capabilities2.compressors == NC_BUILTIN_COMPRESSORS);
+    REQUIRE(capabilities2.encryptions == NC_BUILTIN_ENCRYPTIONS);
+    REQUIRE(capabilities2.max_frame_size == 1024 * 1024);
+    REQUIRE(capabilities2.features == NC_FEATURE_PERSISTENT_CONNECTION);
+    REQUIRE(capabilities2.preferred_compressor == NCCompressorID::LZ4HC);
+    REQUIRE(capabilities2.preferred_encryption == NCEncryptionID::AES256GCM);
+
+    REQUIRE_THROWS_AS(nc_decode_capabilities(std::vector<uint8_t>{1, 2, 3}), NCMessageException);
+}
+
+TEST_CASE("Decode capabilities with unknown preferences", "[capability]" ) {
+    std::vector<uint8_t> data = nc_encode_capabilities(NCCapabilities());
+    data[11] = 200;
+    data[12] = 16;
+
+    auto const capabilities = nc_decode_capabilities(data);
+    REQUIRE(capabilities.preferred_compressor == NCCompressorID::Default);
+    REQUIRE(capabilities.preferred_encryption == NCEncryptionID::Default);
+
+    // No preference, the common defaults are used:
+    auto const negotiated = nc_negotiate(NCCapabilities(), capabilities);
+    REQUIRE(negotiated.codec.compressor == NCCompressorID::LZ4);
+    REQUIRE(negotiated.codec.encryption == NCEncryptionID::ChaCha20Poly1305);
+
+    REQUIRE(nc_compressor_mask(static_cast<NCCompressorID>(200)) == 0);
+    REQUIRE(nc_encryption_mask(static_cast<NCEncryptionID>(32)) == 0);
+}
+
+TEST_CASE("Encode / decode node info", "[capability]" ) {
+    NCNodeInfo node_info1;
+    node_info1.num_cores = 128;
+    node_info1.memory = 512ull * 1024 * 1024 * 1024;
+    node_info1.cpu_features = NC_CPU_AVX2 | NC_CPU_FMA;
+    node_info1.benchmark_score = 12345;
+
+    auto const data = nc_encode_node_info(node_info1);
+    REQUIRE(data.size() == NC_NODE_INFO_LENGTH);
+
+    auto const node_info2 = nc_decode_node_info(data);
+    REQUIRE(node_info2.num_cores == 128);
+    REQUIRE(node_info2.memory == 512ull * 1024 * 1024 * 1024);
+    REQUIRE(node_info2.cpu_features == (NC_CPU_AVX2 | NC_CPU_FMA));
+    REQUIRE(node_info2.benchmark_score == 12345);
+
+    REQUIRE_THROWS_AS(nc_decode_node_info(std::vector<uint8_t>{1, 2, 3}), NCMessageException);
+}
+
+TEST_CASE("Node weight", "[capability]" ) {
+    NCNodeInfo node_info = nc_detect_node_info();
+    REQUIRE(node_info.num_cores > 0);
+    REQUIRE(nc_node_weight(node_info) == static_cast<double>(node_info.num_cores));
+
+    node_info.benchmark_score = 500;
+    REQUIRE(nc_node_weight(node_info) == 500.0);
+
+    REQUIRE(nc_node_weight(NCNodeInfo()) == 1.0);
+}
+
+TEST_CASE("Negotiate preferred codec", "[capability]" ) {
+    NCCapabilities server;
+    server.preferred_encryption = NCEncryptionID::AES256GCM;
+    server.max_frame_size = 4096;
+
+    NCCapabilities node;
+    node.preferred_compressor = NCCompressorID::None;
+
+    auto const negotiated = nc_negotiate(server, node);
+    REQUIRE(negotiated.codec.compressor == NCCompressorID::None);
+    REQUIRE(negotiated.codec.encryption == NCEncryptionID::AES256GCM);
+    REQUIRE(negotiated.max_frame_size == 4096);
+    REQUIRE(negotiated.features == 0);
+}
+
+TEST_CASE("Negotiate common codec", "[capability]" ) {
+    NCCapabilities server;
+    server.compressors = nc_compressor_mask(NCCompressorID::LZ4HC);
+    server.encryptions = nc_encryption_mask(NCEncryptionID::ChaCha20Poly1305);
+
+    NCCapabilities node;
+    node.preferred_encryption = NCEncryptionID::AES256GCM;
+
+    auto const negotiated = nc_negotiate(server, node);
+    REQUIRE(negotiated.codec.compressor == NCCompressorID::LZ4HC);
+    REQUIRE(negotiated.codec.encryption == NCEncryptionID::ChaCha20Poly1305);
+
+    node.encryptions = nc_encryption_mask(NCEncryptionID::AES256GCM);
+    REQUIRE_THROWS_AS(nc_negotiate(server, node), NCMessageException);
+}
+
+TEST_CASE("Encode / decode negotiated capabilities", "[capability]" ) {
+    NCNegotiatedCapabilities negotiated1;
+    negotiated1.codec = NCCodecID{NCCompressorID::LZ4HC, NCEncryptionID::AES256GCM};
+    negotiated1.max_frame_size = 12345;
+
+    auto const data = nc_encode_negotiated(negotiated1);
+    REQUIRE(data.size() == NC_NEGOTIATED_LENGTH);
+
+    auto const negotiated2 = nc_decode_negotiated(data);
+    REQUIRE(negotiated2.protocol_version == NC_PROTOCOL_VERSION);
+    REQUIRE(negotiated2.codec == negotiated1.codec);
+    REQUIRE(negotiated2.max_frame_size == 12345);
+}
+
+TEST_CASE("Codec names", "[capability]" ) {
+    REQUIRE(nc_compressor_from_string("lz4hc") == NCCompressorID::LZ4HC);
+    REQUIRE(nc_encryption_from_string("aes-256-gcm") == NCEncryptionID::AES256GCM);
+    REQUIRE_THROWS_AS(nc_compressor_from_string("zip"), NCConfigurationException);
+    REQUIRE_THROWS_AS(nc_encryption_from_string("rot13"), NCConfigurationException);
+}
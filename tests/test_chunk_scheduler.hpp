@@ -0,0 +1,170 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file contains the tests for the chunk scheduler.
+
+    Run only chunk scheduler tests:
+    xmake run -w ./ nc_test [chunk_scheduler]
+*/
+
+// STD includes:
+#include <chrono>
+#include <vector>
+
+// External includes:
+#include <snitch/snitch.hpp>
+
+// Local includes:
+#include "nodcru2/nc_chunk_scheduler.hpp"
+
+using namespace nodcru2;
+
+class TestChunkServerProcessor: public NCChunkServerProcessor {
+    public:
+        TestChunkServerProcessor(uint64_t const num_items):
+            NCChunkServerProcessor(num_items)
+            {}
+
+        void nc_process_chunk_result([[maybe_unused]] NCNodeID node_id, NCChunk const chunk,
+            std::span<const uint8_t> const result) override {
+            for (uint64_t i = 0; i < chunk.nc_size(); i++) {
+                items[chunk.begin + i] = result[i];
+            }
+        }
+
+        std::vector<uint8_t> items = std::vector<uint8_t>(100, 0);
+};
+
+class TestChunkNodeProcessor: public NCChunkNodeProcessor {
+    public:
+        [[nodiscard]] std::vector<uint8_t> nc_process_chunk(NCChunk const chunk,
+            [[maybe_unused]] std::span<const uint8_t> const data) override {
+            return std::vector<uint8_t>(chunk.nc_size(), 1);
+        }
+};
+
+TEST_CASE("Chunk sizes shrink towards the end", "[chunk_scheduler]" ) {
+    NCChunkScheduler scheduler(1000);
+    NCNodeID const node_id1;
+    uint64_t expected_begin = 0;
+    uint64_t last_size = 1000;
+
+    REQUIRE(scheduler.nc_next_chunk(node_id1) == NCChunk{0, 500});
+    REQUIRE(scheduler.nc_next_chunk(node_id1) == NCChunk{500, 750});
+    expected_begin = 750;
+    last_size = 250;
+
+    while (auto const chunk = scheduler.nc_next_chunk(node_id1)) {
+        REQUIRE(chunk->begin == expected_begin);
+        REQUIRE(chunk->nc_size() <= last_size);
+        REQUIRE(chunk->nc_size() > 0);
+        expected_begin = chunk->end;
+        last_size = chunk->nc_size();
+    }
+
+    REQUIRE(expected_begin == 1000);
+    REQUIRE(last_size == 1);
+    REQUIRE(scheduler.nc_num_unassigned() == 0);
+    REQUIRE(!scheduler.nc_is_done());
+}
+
+TEST_CASE("Minimum and maximum chunk size", "[chunk_scheduler]" ) {
+    NCChunkScheduler scheduler(1000, 100, 300);
+    NCNodeID const node_id1;
+
+    REQUIRE(scheduler.nc_next_chunk(node_id1) == NCChunk{0, 300});
+    REQUIRE(scheduler.nc_next_chunk(node_id1) == NCChunk{300, 600});
+    REQUIRE(scheduler.nc_next_chunk(node_id1) == NCChunk{600, 800});
+    REQUIRE(scheduler.nc_next_chunk(node_id1) == NCChunk{800, 900});
+    REQUIRE(scheduler.nc_next_chunk(node_id1) == NCChunk{900, 1000});
+    REQUIRE(!scheduler.nc_next_chunk(node_id1).has_value());
+}
+
+TEST_CASE("Faster nodes get larger chunks", "[chunk_scheduler]" ) {
+    NCChunkScheduler scheduler(100000);
+    NCNodeID const node_id1, node_id2;
+    auto const start = std::chrono::steady_clock::now();
+
+    auto const chunk1 = scheduler.nc_next_chunk(node_id1, start);
+    auto const chunk2 = scheduler.nc_next_chunk(node_id2, start);
+    REQUIRE(chunk1.has_value());
+    REQUIRE(chunk2.has_value());
+
+    // Node 1 is four times faster than node 2:
+    REQUIRE(scheduler.nc_chunk_done(node_id1, *chunk1, start + std::chrono::seconds(1)));
+    REQUIRE(scheduler.nc_chunk_done(node_id2, *chunk2, start + std::chrono::seconds(4)));
+    REQUIRE(scheduler.nc_get_throughput(node_id1) > scheduler.nc_get_throughput(node_id2));
+
+    auto const chunk3 = scheduler.nc_next_chunk(node_id1);
+    auto const chunk4 = scheduler.nc_next_chunk(node_id2);
+    REQUIRE(chunk3->nc_size() > 2 * chunk4->nc_size());
+
+    // Duplicate results are ignored:
+    REQUIRE(!scheduler.nc_chunk_done(node_id1, *chunk1));
+}
+
+TEST_CASE("Stronger nodes get larger chunks", "[chunk_scheduler]" ) {
+    NCChunkScheduler scheduler(100000);
+    NCNodeID const node_id1, node_id2;
+    NCNodeInfo node_info1, node_info2;
+    node_info1.num_cores = 128;
+    node_info2.num_cores = 8;
+
+    scheduler.nc_set_node_weight(node_id1, nc_node_weight(node_info1));
+    scheduler.nc_set_node_weight(node_id2, nc_node_weight(node_info2));
+
+    // No result yet, only the weights are known:
+    auto const chunk1 = scheduler.nc_next_chunk(node_id1);
+    auto const chunk2 = scheduler.nc_next_chunk(node_id2);
+    REQUIRE(chunk1->nc_size() > 4 * chunk2->nc_size());
+}
+
+TEST_CASE("Requeue chunks of a timed out node", "[chunk_scheduler]" ) {
+    NCChunkScheduler scheduler(100);
+    NCNodeID const node_id1, node_id2;
+
+    auto const chunk1 = scheduler.nc_next_chunk(node_id1);
+    REQUIRE(chunk1 == NCChunk{0, 50});
+    REQUIRE(scheduler.nc_node_timeout(node_id1) == 50);
+    REQUIRE(scheduler.nc_node_timeout(node_id1) == 0);
+    REQUIRE(scheduler.nc_num_unassigned() == 100);
+
+    // The requeued chunk is split and handed out first:
+    REQUIRE(scheduler.nc_next_chunk(node_id2) == NCChunk{0, 50});
+    REQUIRE(scheduler.nc_next_chunk(node_id2) == NCChunk{50, 75});
+
+    // A late result of the timed out node is not accepted:
+    REQUIRE(!scheduler.nc_chunk_done(node_id1, *chunk1));
+}
+
+TEST_CASE("Chunk processors", "[chunk_scheduler]" ) {
+    TestChunkServerProcessor server_processor(100);
+    TestChunkNodeProcessor node_processor;
+    NCNodeID const node_id1;
+    std::vector<uint8_t> result;
+
+    REQUIRE(server_processor.nc_get_remaining_work() == 100);
+
+    while (true) {
+        std::vector<uint8_t> data = server_processor.nc_get_new_data(node_id1);
+
+        if (data.empty()) {
+            break;
+        }
+
+        node_processor.nc_process_data_into(std::move(data), result);
+        server_processor.nc_process_result(node_id1, result);
+    }
+
+    REQUIRE(server_processor.nc_get_remaining_work() == 0);
+    REQUIRE(server_processor.nc_get_job_state() == NCJobState::Done);
+    REQUIRE(server_processor.items == std::vector<uint8_t>(100, 1));
+    REQUIRE(server_processor.nc_get_scheduler().nc_is_done());
+
+    // No chunk left, the node sends back an empty result:
+    node_processor.nc_process_data_into(std::vector<uint8_t>(), result);
+    REQUIRE(result.empty());
+}
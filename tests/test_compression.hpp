@@ -19,6 +19,7 @@
 // Local includes:
 #include "nodcru2/nc_compression.hpp"
 #include "nodcru2/nc_util.hpp"
+#include "nodcru2/nc_exceptions.hpp"
 
 using namespace nodcru2;
 
@@ -63,3 +64,16 @@ TEST_CASE("NonCompressor", "[compression]" ) {
     std::string msg2(decompressed_message1.data.begin(), decompressed_message1.data.end());
     REQUIRE(msg2 == msg1);
 }
+
+TEST_CASE("NonCompressor with invalid size", "[compression]" ) {
+    NCNonCompressor non_compressor;
+
+    // Too short for the size header:
+    REQUIRE_THROWS_AS(non_compressor.nc_decompress_message(NCCompressedMessage({0, 0, 0})), NCDecompressionException);
+    // Size header larger than the data:
+    REQUIRE_THROWS_AS(non_compressor.nc_decompress_message(NCCompressedMessage({0, 0, 1, 0, 1, 2})), NCDecompressionException);
+    // Size header smaller than the data:
+    REQUIRE_THROWS_AS(non_compressor.nc_decompress_message(NCCompressedMessage({0, 0, 0, 1, 1, 2})), NCDecompressionException);
+
+    REQUIRE(non_compressor.nc_decompress_message(NCCompressedMessage({0, 0, 0, 2, 1, 2})).data == std::vector<uint8_t>({1, 2}));
+}
@@ -105,3 +105,96 @@ TEST_CASE("Invalid heartbeat timeout", "[configuration]") {
     std::string input1{R"({"secret_key": "123456789012345678901234567890A7", "heartbeat_timeout": 0})"};
     REQUIRE_THROWS_AS(nc_config_from_string(input1), NCConfigurationException);
 }
+
+TEST_CASE("Codec options", "[configuration]") {
+    std::string input1{R"({"secret_key": "123456789012345678901234567890A8", "preferred_compressor": "none", "preferred_encryption": "aes-256-gcm", "max_frame_size": 65536})"};
+    auto config1 = nc_config_from_string(input1);
+
+    REQUIRE(config1.preferred_compressor == NCCompressorID::None);
+    REQUIRE(config1.preferred_encryption == NCEncryptionID::AES256GCM);
+    REQUIRE(config1.max_frame_size == 65536);
+
+    std::string input2{R"({"secret_key": "123456789012345678901234567890A9", "preferred_compressor": "zip"})"};
+    REQUIRE_THROWS_AS(nc_config_from_string(input2), NCConfigurationException);
+}
+
+TEST_CASE("Phi threshold", "[configuration]") {
+    std::string input1{R"({"secret_key": "123456789012345678901234567890B0", "phi_threshold": 12.5})"};
+    auto config1 = nc_config_from_string(input1);
+
+    REQUIRE(config1.phi_threshold == 12.5);
+
+    std::string input2{R"({"secret_key": "123456789012345678901234567890B1", "phi_threshold": -1.0})"};
+    REQUIRE_THROWS_AS(nc_config_from_string(input2), NCConfigurationException);
+}
+
+TEST_CASE("Serialize processor", "[configuration]") {
+    std::string input1{R"({"secret_key": "123456789012345678901234567890B2"})"};
+    auto config1 = nc_config_from_string(input1);
+
+    REQUIRE(!config1.serialize_processor);
+
+    std::string input2{R"({"secret_key": "123456789012345678901234567890B3", "serialize_processor": true})"};
+    auto config2 = nc_config_from_string(input2);
+
+    REQUIRE(config2.serialize_processor);
+}
+
+TEST_CASE("Pipeline threads", "[configuration]") {
+    std::string input1{R"({"secret_key": "123456789012345678901234567890B4", "io_threads": 2, "codec_threads": 8, "processor_threads": 1})"};
+    auto config1 = nc_config_from_string(input1);
+
+    REQUIRE(config1.io_threads == 2);
+    REQUIRE(config1.codec_threads == 8);
+    REQUIRE(config1.processor_threads == 1);
+
+    std::string input2{R"({"secret_key": "123456789012345678901234567890B5", "codec_threads": 0})"};
+    REQUIRE_THROWS_AS(nc_config_from_string(input2), NCConfigurationException);
+}
+
+TEST_CASE("Batch size", "[configuration]") {
+    std::string input1{R"({"secret_key": "123456789012345678901234567890B6", "batch_size": 16})"};
+    auto config1 = nc_config_from_string(input1);
+
+    REQUIRE(config1.batch_size == 16);
+
+    std::string input2{R"({"secret_key": "123456789012345678901234567890B7", "batch_size": 0})"};
+    REQUIRE_THROWS_AS(nc_config_from_string(input2), NCConfigurationException);
+}
+
+TEST_CASE("Result batch", "[configuration]") {
+    std::string input1{R"({"secret_key": "123456789012345678901234567890B8", "result_batch_size": 32,
+        "result_batch_bytes": 4096, "result_batch_time": 250})"};
+    auto config1 = nc_config_from_string(input1);
+
+    REQUIRE(config1.result_batch_size == 32);
+    REQUIRE(config1.result_batch_bytes == 4096);
+    REQUIRE(config1.result_batch_time == 250);
+
+    std::string input2{R"({"secret_key": "123456789012345678901234567890B9", "result_batch_size": 0})"};
+    REQUIRE_THROWS_AS(nc_config_from_string(input2), NCConfigurationException);
+
+    std::string input3{R"({"secret_key": "123456789012345678901234567890C0", "result_batch_bytes": 0})"};
+    REQUIRE_THROWS_AS(nc_config_from_string(input3), NCConfigurationException);
+}
+
+TEST_CASE("Prefetch depth", "[configuration]") {
+    NCConfiguration config1 = NCConfiguration("12345678901234567890123456789012");
+    REQUIRE(config1.prefetch_depth == 0);
+
+    std::string input2{R"({"secret_key": "123456789012345678901234567890C1", "prefetch_depth": 2})"};
+    auto config2 = nc_config_from_string(input2);
+    REQUIRE(config2.prefetch_depth == 2);
+}
+
+TEST_CASE("Number of workers", "[configuration]") {
+    NCConfiguration config1 = NCConfiguration("12345678901234567890123456789012");
+    REQUIRE(config1.num_workers == 1);
+
+    std::string input2{R"({"secret_key": "123456789012345678901234567890C2", "num_workers": 8})"};
+    auto config2 = nc_config_from_string(input2);
+    REQUIRE(config2.num_workers == 8);
+
+    std::string input3{R"({"secret_key": "123456789012345678901234567890C3", "num_workers": 0})"};
+    REQUIRE_THROWS_AS(nc_config_from_string(input3), NCConfigurationException);
+}
@@ -0,0 +1,116 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file contains the tests for the phi accrual failure detector.
+
+    Run only failure detector tests:
+    xmake run -w ./ nc_test [failure_detector]
+*/
+
+// STD includes:
+#include <chrono>
+
+// External includes:
+#include <snitch/snitch.hpp>
+
+// Local includes:
+#include "nodcru2/nc_failure_detector.hpp"
+
+using namespace nodcru2;
+
+TEST_CASE("Phi to deviations", "[failure_detector]" ) {
+    REQUIRE(nc_phi_to_deviations(0.30103) < 0.001);
+    REQUIRE(nc_phi_to_deviations(0.30103) > -0.001);
+    REQUIRE(nc_phi_to_deviations(8.0) > 5.5);
+    REQUIRE(nc_phi_to_deviations(8.0) < 5.7);
+    REQUIRE(nc_phi_to_deviations(12.0) > nc_phi_to_deviations(8.0));
+}
+
+TEST_CASE("Not enough samples", "[failure_detector]" ) {
+    NCPhiAccrualDetector detector;
+    auto const start = std::chrono::steady_clock::now();
+    auto const interval = std::chrono::seconds(1);
+
+    detector.nc_reset(start);
+    detector.nc_heartbeat(start + interval);
+    detector.nc_heartbeat(start + (interval * 2));
+
+    REQUIRE(detector.nc_num_samples() == 2);
+    REQUIRE(detector.nc_phi(start + (interval * 100)) == 0.0);
+    REQUIRE(!detector.nc_suspect_after(8.0).has_value());
+}
+
+TEST_CASE("Regular heartbeats", "[failure_detector]" ) {
+    NCPhiAccrualDetector detector;
+    auto const start = std::chrono::steady_clock::now();
+    auto const interval = std::chrono::seconds(1);
+
+    detector.nc_reset(start);
+
+    for (uint32_t i = 1; i <= 20; i++) {
+        detector.nc_heartbeat(start + (interval * i));
+    }
+
+    auto const last = start + (interval * 20);
+
+    REQUIRE(detector.nc_num_samples() == 20);
+    // Next heartbeat on time, low suspicion:
+    REQUIRE(detector.nc_phi(last + interval) < 1.0);
+    // Long silence, high suspicion:
+    REQUIRE(detector.nc_phi(last + (interval * 3)) > 8.0);
+    REQUIRE(detector.nc_phi(last + (interval * 3)) > detector.nc_phi(last + (interval * 2)));
+
+    auto const suspect_after = detector.nc_suspect_after(8.0);
+    REQUIRE(suspect_after.has_value());
+    REQUIRE(*suspect_after > interval);
+    REQUIRE(*suspect_after < (interval * 2));
+
+    detector.nc_reset(last);
+    REQUIRE(detector.nc_num_samples() == 0);
+}
+
+TEST_CASE("Jittery heartbeats", "[failure_detector]" ) {
+    NCPhiAccrualDetector regular;
+    NCPhiAccrualDetector jittery;
+    auto const start = std::chrono::steady_clock::now();
+    auto time1 = start;
+    auto time2 = start;
+
+    regular.nc_reset(start);
+    jittery.nc_reset(start);
+
+    for (uint32_t i = 0; i < 20; i++) {
+        time1 += std::chrono::seconds(1);
+        regular.nc_heartbeat(time1);
+        time2 += (i % 2 == 0) ? std::chrono::milliseconds(200) : std::chrono::milliseconds(1800);
+        jittery.nc_heartbeat(time2);
+    }
+
+    // Same mean interval, but the jittery node gets more time:
+    REQUIRE(*jittery.nc_suspect_after(8.0) > *regular.nc_suspect_after(8.0));
+    REQUIRE(jittery.nc_phi(time2 + std::chrono::seconds(2)) < regular.nc_phi(time1 + std::chrono::seconds(2)));
+}
+
+TEST_CASE("Window size", "[failure_detector]" ) {
+    NCPhiAccrualDetector detector;
+    auto time1 = std::chrono::steady_clock::now();
+
+    detector.nc_reset(time1);
+
+    for (size_t i = 0; i < NC_PHI_WINDOW_SIZE; i++) {
+        time1 += std::chrono::seconds(10);
+        detector.nc_heartbeat(time1);
+    }
+
+    // The old intervals are replaced by the new ones:
+    for (size_t i = 0; i < NC_PHI_WINDOW_SIZE; i++) {
+        time1 += std::chrono::seconds(1);
+        detector.nc_heartbeat(time1);
+    }
+
+    REQUIRE(detector.nc_num_samples() == NC_PHI_WINDOW_SIZE);
+    REQUIRE(*detector.nc_suspect_after(8.0) < std::chrono::seconds(2));
+}
@@ -18,25 +18,26 @@
 
 // Local includes:
 #include "nodcru2/nc_message.hpp"
+#include "nodcru2/nc_exceptions.hpp"
 
 using namespace nodcru2;
 
 TEST_CASE("Encode / decode a message to the server", "[message]" ) {
     NCNodeMessageType const message_type = NCNodeMessageType::Init;
-    NCNodeID const node_id = NCNodeID();
+    NCNodeSlot const node_slot{3, nc_gen_session_token()};
     std::string const msg1 = "Hello world, this is a test for encoding a message. Add some more content: test, test, test, test, test, test, test, test.";
     std::vector<uint8_t> const data(msg1.begin(), msg1.end());
     std::string const key1 = "12345678901234567890123456789012";
     NCMessageCodecNode node_codec(key1);
     NCMessageCodecServer server_codec(key1);
 
-    auto const encoded_message1 = node_codec.nc_encode_message_to_server(message_type, data, node_id);
-    REQUIRE(encoded_message1.data.size() == 186);
+    auto const encoded_message1 = node_codec.nc_encode_message_to_server(message_type, data, node_slot);
+    REQUIRE(encoded_message1.data.size() == 139);
 
     auto const decoded_message1 = server_codec.nc_decode_message_from_node(encoded_message1);
     REQUIRE(decoded_message1.data.size() == msg1.size());
     REQUIRE(decoded_message1.msg_type == message_type);
-    REQUIRE(decoded_message1.node_id.id == node_id.id);
+    REQUIRE(decoded_message1.node_slot == node_slot);
 
     std::string const msg2(decoded_message1.data.begin(), decoded_message1.data.end());
     REQUIRE(msg2 == msg1);
@@ -44,32 +45,32 @@ TEST_CASE("Encode / decode a message to the server", "[message]" ) {
 
 TEST_CASE("Encode / decode an empty message to the server", "[message]" ) {
     NCNodeMessageType const message_type = NCNodeMessageType::Init;
-    NCNodeID const node_id = NCNodeID();
+    NCNodeSlot const node_slot{3, nc_gen_session_token()};
     std::vector<uint8_t> const data;
     std::string const key1 = "12345678901234567890123456789012";
     NCMessageCodecNode node_codec(key1);
     NCMessageCodecServer server_codec(key1);
 
-    auto const encoded_message1 = node_codec.nc_encode_message_to_server(message_type, data, node_id);
-    REQUIRE(encoded_message1.data.size() == 99);
+    auto const encoded_message1 = node_codec.nc_encode_message_to_server(message_type, data, node_slot);
+    REQUIRE(encoded_message1.data.size() == 51);
 
     auto const decoded_message1 = server_codec.nc_decode_message_from_node(encoded_message1);
     REQUIRE(decoded_message1.data.size() == 0);
     REQUIRE(decoded_message1.msg_type == message_type);
-    REQUIRE(decoded_message1.node_id.id == node_id.id);
+    REQUIRE(decoded_message1.node_slot == node_slot);
 }
 
 TEST_CASE("Encode / decode a message to the node", "[message]" ) {
     NCNodeMessageType const message_type = NCNodeMessageType::Heartbeat;
-    NCNodeID const node_id = NCNodeID();
+    NCNodeSlot const node_slot{3, nc_gen_session_token()};
     std::string const msg1 = "Hello world, this is a test for encoding a message. Add some more content: test, test, test, test, test, test, test, test.";
     std::vector<uint8_t> const data(msg1.begin(), msg1.end());
     std::string const key1 = "12345678901234567890123456789012";
     NCMessageCodecNode node_codec(key1);
     NCMessageCodecServer server_codec(key1);
 
-    auto const encoded_message1 = node_codec.nc_encode_message_to_server(message_type, data, node_id);
-    REQUIRE(encoded_message1.data.size() == 186);
+    auto const encoded_message1 = node_codec.nc_encode_message_to_server(message_type, data, node_slot);
+    REQUIRE(encoded_message1.data.size() == 139);
 
     auto const decoded_message1 = server_codec.nc_decode_message_from_node(encoded_message1);
     REQUIRE(decoded_message1.data.size() == msg1.size());
@@ -81,31 +82,100 @@ TEST_CASE("Encode / decode a message to the node", "[message]" ) {
 
 TEST_CASE("Encode / decode an empty message to the node", "[message]" ) {
     NCNodeMessageType const message_type = NCNodeMessageType::NewResultFromNode;
-    NCNodeID const node_id = NCNodeID();
+    NCNodeSlot const node_slot{3, nc_gen_session_token()};
     std::vector<uint8_t> const data;
     std::string const key1 = "12345678901234567890123456789012";
     NCMessageCodecNode node_codec(key1);
     NCMessageCodecServer server_codec(key1);
 
-    auto const encoded_message1 = node_codec.nc_encode_message_to_server(message_type, data, node_id);
-    REQUIRE(encoded_message1.data.size() == 99);
+    auto const encoded_message1 = node_codec.nc_encode_message_to_server(message_type, data, node_slot);
+    REQUIRE(encoded_message1.data.size() == 51);
 
     auto const decoded_message1 = server_codec.nc_decode_message_from_node(encoded_message1);
     REQUIRE(decoded_message1.data.size() == 0);
     REQUIRE(decoded_message1.msg_type == message_type);
 }
 
+TEST_CASE("Decode only the header of a message to the server", "[message]" ) {
+    NCNodeSlot const node_slot{3, nc_gen_session_token()};
+    std::vector<uint8_t> const data = {6, 7, 8, 9};
+    std::string const key1 = "12345678901234567890123456789012";
+    NCMessageCodecNode node_codec(key1);
+    NCMessageCodecServer server_codec(key1);
+
+    auto const encoded_message1 = node_codec.nc_gen_result_message(data, node_slot);
+    auto const header1 = server_codec.nc_decode_header_from_node(encoded_message1);
+
+    REQUIRE(header1.msg_type == NCNodeMessageType::NewResultFromNode);
+    REQUIRE(header1.node_slot == node_slot);
+    REQUIRE(header1.payload_length + NC_HEADER_TO_SERVER_LENGTH + NC_NONCE_LENGTH + NC_GCM_TAG_LENGTH == encoded_message1.data.size());
+
+    auto const payload1 = server_codec.nc_decode_payload_from_node(encoded_message1);
+    REQUIRE(payload1 == data);
+}
+
+TEST_CASE("Modified header is rejected", "[message]" ) {
+    NCNodeSlot const node_slot{3, nc_gen_session_token()};
+    std::string const key1 = "12345678901234567890123456789012";
+    NCMessageCodecNode node_codec(key1);
+    NCMessageCodecServer server_codec(key1);
+
+    auto encoded_message1 = node_codec.nc_gen_heartbeat_message(node_slot);
+    // Change the message type in the clear text header:
+    encoded_message1.data[0] = static_cast<uint8_t>(NCNodeMessageType::NodeNeedsMoreData);
+
+    auto const header1 = server_codec.nc_decode_header_from_node(encoded_message1);
+    REQUIRE(header1.msg_type == NCNodeMessageType::NodeNeedsMoreData);
+
+    REQUIRE_THROWS_AS(server_codec.nc_decode_payload_from_node(encoded_message1), NCEncryptionException);
+}
+
+TEST_CASE("Encode / decode with a different codec", "[message]" ) {
+    std::string const key = "12345678901234567890123456789012";
+    NCNodeSlot const node_slot{3, nc_gen_session_token()};
+    std::vector<uint8_t> const data = {6, 7, 8, 9};
+    NCCodecID const codec{NCCompressorID::LZ4HC, NCEncryptionID::AES256GCM};
+    NCMessageCodecNode node_codec(key);
+    NCMessageCodecServer server_codec(key);
+
+    node_codec.nc_set_codec(codec);
+    REQUIRE(node_codec.nc_get_codec() == codec);
+
+    auto const message1 = node_codec.nc_gen_result_message(data, node_slot);
+    auto const header1 = server_codec.nc_decode_header_from_node(message1);
+    REQUIRE(header1.codec == codec);
+    REQUIRE(server_codec.nc_decode_payload_from_node(message1) == data);
+
+    // The server answers with the codec used by the node:
+    auto const message2 = server_codec.nc_gen_new_data_message(data, header1.codec);
+    REQUIRE(node_codec.nc_decode_header_from_server(message2).codec == codec);
+    REQUIRE(node_codec.nc_decode_payload_from_server(message2) == data);
+}
+
+TEST_CASE("Unsupported codec is rejected", "[message]" ) {
+    std::string const key = "12345678901234567890123456789012";
+    NCNodeSlot const node_slot{3, nc_gen_session_token()};
+    NCMessageCodecNode node_codec(key);
+    NCMessageCodecServer server_codec(std::make_unique<NCCompressor>(), std::make_unique<NCEncryption>(key));
+
+    REQUIRE_THROWS_AS(node_codec.nc_set_codec(NCCodecID{NCCompressorID::LZ4, NCEncryptionID::None}), NCMessageException);
+
+    node_codec.nc_set_codec(NCCodecID{NCCompressorID::None, NCEncryptionID::ChaCha20Poly1305});
+    auto const message1 = node_codec.nc_gen_heartbeat_message(node_slot);
+    REQUIRE_THROWS_AS(server_codec.nc_decode_payload_from_node(message1), NCMessageException);
+}
+
 TEST_CASE("Generate heartbeat message", "[message]" ) {
     std::string const key = "12345678901234567890123456789012";
-    NCNodeID const node_id = NCNodeID();
+    NCNodeSlot const node_slot{3, nc_gen_session_token()};
     NCMessageCodecNode node_codec(key);
     NCMessageCodecServer server_codec(key);
 
-    auto const message1 = node_codec.nc_gen_heartbeat_message(node_id);
+    auto const message1 = node_codec.nc_gen_heartbeat_message(node_slot);
     auto const message2 = server_codec.nc_decode_message_from_node(message1);
 
     REQUIRE(message2.msg_type == NCNodeMessageType::Heartbeat);
-    REQUIRE(message2.node_id.id == node_id.id);
+    REQUIRE(message2.node_slot == node_slot);
     REQUIRE(message2.data.size() == 0);
 }
 
@@ -128,57 +198,144 @@ TEST_CASE("Generate init message", "[message]" ) {
     NCMessageCodecNode node_codec(key);
     NCMessageCodecServer server_codec(key);
 
-    auto const message1 = node_codec.nc_gen_init_message(node_id);
+    NCNodeInfo node_info;
+    node_info.num_cores = 8;
+    node_info.benchmark_score = 42;
+
+    auto const message1 = node_codec.nc_gen_init_message(node_id, node_codec.nc_get_capabilities(), node_info);
     auto const message2 = server_codec.nc_decode_message_from_node(message1);
 
     REQUIRE(message2.msg_type == NCNodeMessageType::Init);
-    REQUIRE(message2.node_id.id == node_id.id);
-    REQUIRE(message2.data.size() == 0);
+    // No slot assigned yet:
+    REQUIRE(message2.node_slot == NCNodeSlot());
+    REQUIRE(message2.data.size() == NC_CAPABILITIES_LENGTH + NC_NODEID_LENGTH + NC_NODE_INFO_LENGTH);
+
+    auto const request = server_codec.nc_decode_init_request(message2.data);
+    REQUIRE(request.node_id == node_id);
+    REQUIRE(request.capabilities.protocol_version == NC_PROTOCOL_VERSION);
+    REQUIRE(request.capabilities.compressors == NC_BUILTIN_COMPRESSORS);
+    REQUIRE(request.capabilities.encryptions == NC_BUILTIN_ENCRYPTIONS);
+    REQUIRE(request.node_info.num_cores == 8);
+    REQUIRE(request.node_info.benchmark_score == 42);
+
+    // Older nodes don't send their hardware:
+    std::vector<uint8_t> data = message2.data;
+    data.resize(NC_CAPABILITIES_LENGTH + NC_NODEID_LENGTH);
+    REQUIRE(server_codec.nc_decode_init_request(data).node_info.num_cores == 0);
 }
 
 TEST_CASE("Generate init ok message", "[message]" ) {
     std::string const key = "12345678901234567890123456789012";
     std::vector<uint8_t> const data = {6, 7, 8, 9};
-    NCNodeID const node_id = NCNodeID();
+    NCNodeSlot const node_slot{7, nc_gen_session_token()};
     NCMessageCodecNode node_codec(key);
     NCMessageCodecServer server_codec(key);
 
-    auto const message1 = server_codec.nc_gen_init_message_ok(data);
+    NCNegotiatedCapabilities negotiated;
+    negotiated.codec = NCCodecID{NCCompressorID::None, NCEncryptionID::AES256GCM};
+
+    auto const message1 = server_codec.nc_gen_init_message_ok(negotiated, node_slot, data);
     auto const message2 = node_codec.nc_decode_message_from_server(message1);
 
     REQUIRE(message2.msg_type == NCServerMessageType::InitOK);
-    REQUIRE(message2.data == data);
+    REQUIRE(message2.data.size() == NC_NEGOTIATED_LENGTH + NC_NODE_SLOT_LENGTH + data.size());
+
+    auto const response = node_codec.nc_decode_init_response(message2.data);
+    REQUIRE(response.negotiated.codec == negotiated.codec);
+    REQUIRE(response.node_slot == node_slot);
+    REQUIRE(response.init_data == data);
 }
 
 TEST_CASE("Generate result message", "[message]" ) {
     std::string const key = "12345678901234567890123456789012";
-    NCNodeID const node_id = NCNodeID();
+    NCNodeSlot const node_slot{3, nc_gen_session_token()};
     std::vector<uint8_t> const data = {6, 7, 8, 9};
     NCMessageCodecNode node_codec(key);
     NCMessageCodecServer server_codec(key);
 
-    auto const message1 = node_codec.nc_gen_result_message(data, node_id);
+    auto const message1 = node_codec.nc_gen_result_message(data, node_slot);
     auto const message2 = server_codec.nc_decode_message_from_node(message1);
 
     REQUIRE(message2.msg_type == NCNodeMessageType::NewResultFromNode);
-    REQUIRE(message2.node_id.id == node_id.id);
+    REQUIRE(message2.node_slot == node_slot);
     REQUIRE(message2.data == data);
 }
 
 TEST_CASE("Generate need more data message", "[message]" ) {
     std::string const key = "12345678901234567890123456789012";
-    NCNodeID const node_id = NCNodeID();
+    NCNodeSlot const node_slot{3, nc_gen_session_token()};
     NCMessageCodecNode node_codec(key);
     NCMessageCodecServer server_codec(key);
 
-    auto const message1 = node_codec.nc_gen_need_more_data_message(node_id);
+    auto const message1 = node_codec.nc_gen_need_more_data_message(node_slot);
     auto const message2 = server_codec.nc_decode_message_from_node(message1);
 
     REQUIRE(message2.msg_type == NCNodeMessageType::NodeNeedsMoreData);
-    REQUIRE(message2.node_id.id == node_id.id);
+    REQUIRE(message2.node_slot == node_slot);
     REQUIRE(message2.data.size() == 0);
 }
 
+TEST_CASE("Generate need more data message for several tasks", "[message]" ) {
+    std::string const key = "12345678901234567890123456789012";
+    NCNodeSlot const node_slot{3, nc_gen_session_token()};
+    NCMessageCodecNode node_codec(key);
+    NCMessageCodecServer server_codec(key);
+
+    auto const message1 = node_codec.nc_gen_need_more_data_message(node_slot, 8);
+    auto const message2 = server_codec.nc_decode_message_from_node(message1);
+
+    REQUIRE(message2.msg_type == NCNodeMessageType::NodeNeedsMoreData);
+    REQUIRE(server_codec.nc_decode_need_more_data_request(message2.data) == 8);
+    REQUIRE(server_codec.nc_decode_need_more_data_request({}) == 1);
+    REQUIRE_THROWS_AS(server_codec.nc_decode_need_more_data_request({1, 2}), NCMessageException);
+}
+
+TEST_CASE("Generate result and need more data message", "[message]" ) {
+    std::string const key = "12345678901234567890123456789012";
+    NCNodeSlot const node_slot{3, nc_gen_session_token()};
+    std::vector<uint8_t> const data = {6, 7, 8, 9};
+    NCMessageCodecNode node_codec(key);
+    NCMessageCodecServer server_codec(key);
+
+    auto const message1 = node_codec.nc_gen_result_need_more_data_message(data, node_slot);
+    auto const message2 = server_codec.nc_decode_message_from_node(message1);
+
+    REQUIRE(message2.msg_type == NCNodeMessageType::ResultNeedsMoreData);
+    REQUIRE(message2.node_slot == node_slot);
+    REQUIRE(message2.data == data);
+}
+
+TEST_CASE("Generate result batch message", "[message]" ) {
+    std::string const key = "12345678901234567890123456789012";
+    NCNodeSlot const node_slot{3, nc_gen_session_token()};
+    std::vector<std::vector<uint8_t>> const data = {{6, 7, 8, 9}, {10, 11}, {}};
+    NCMessageCodecNode node_codec(key);
+    NCMessageCodecServer server_codec(key);
+
+    auto const message1 = node_codec.nc_gen_result_batch_message(data, node_slot);
+    auto const message2 = server_codec.nc_decode_message_from_node(message1);
+
+    REQUIRE(message2.msg_type == NCNodeMessageType::NewResultBatchFromNode);
+    REQUIRE(message2.node_slot == node_slot);
+    REQUIRE(server_codec.nc_decode_result_batch(message2.data) == data);
+    REQUIRE_THROWS_AS(server_codec.nc_decode_result_batch({1, 2, 3}), NCMessageException);
+}
+
+TEST_CASE("Generate tasks cancelled message", "[message]" ) {
+    std::string const key = "12345678901234567890123456789012";
+    NCNodeSlot const node_slot{3, nc_gen_session_token()};
+    NCMessageCodecNode node_codec(key);
+    NCMessageCodecServer server_codec(key);
+
+    auto const message1 = node_codec.nc_gen_tasks_cancelled_message(300, node_slot);
+    auto const message2 = server_codec.nc_decode_message_from_node(message1);
+
+    REQUIRE(message2.msg_type == NCNodeMessageType::TasksCancelled);
+    REQUIRE(message2.node_slot == node_slot);
+    REQUIRE(server_codec.nc_decode_tasks_cancelled(message2.data) == 300);
+    REQUIRE_THROWS_AS(server_codec.nc_decode_tasks_cancelled({1, 2, 3}), NCMessageException);
+}
+
 TEST_CASE("Generate new data from server message", "[message]" ) {
     std::string const key = "12345678901234567890123456789012";
     std::vector<uint8_t> const data = {6, 7, 8, 9};
@@ -193,6 +350,20 @@ TEST_CASE("Generate new data from server message", "[message]" ) {
     REQUIRE(message2.data == data);
 }
 
+TEST_CASE("Generate new data batch message", "[message]" ) {
+    std::string const key = "12345678901234567890123456789012";
+    std::vector<std::vector<uint8_t>> const data = {{6, 7, 8, 9}, {}, {10}};
+    NCMessageCodecNode node_codec(key);
+    NCMessageCodecServer server_codec(key);
+
+    auto const message1 = server_codec.nc_gen_new_data_batch_message(data);
+    auto const message2 = node_codec.nc_decode_message_from_server(message1);
+
+    REQUIRE(message2.msg_type == NCServerMessageType::NewDataBatchFromServer);
+    REQUIRE(node_codec.nc_decode_data_batch(message2.data) == data);
+    REQUIRE_THROWS_AS(node_codec.nc_decode_data_batch({1, 2, 3}), NCMessageException);
+}
+
 TEST_CASE("Generate result ok message", "[message]" ) {
     std::string const key = "12345678901234567890123456789012";
     NCNodeID const node_id = NCNodeID();
@@ -219,6 +390,19 @@ TEST_CASE("Generate quit message", "[message]" ) {
     REQUIRE(message2.data.size() == 0);
 }
 
+TEST_CASE("Generate cancel message", "[message]" ) {
+    std::string const key = "12345678901234567890123456789012";
+    NCMessageCodecNode node_codec(key);
+    NCMessageCodecServer server_codec(key);
+
+    auto const message1 = server_codec.nc_gen_cancel_message(5000000000);
+    auto const message2 = node_codec.nc_decode_message_from_server(message1);
+
+    REQUIRE(message2.msg_type == NCServerMessageType::Cancel);
+    REQUIRE(node_codec.nc_decode_cancel(message2.data) == 5000000000);
+    REQUIRE_THROWS_AS(node_codec.nc_decode_cancel({1, 2, 3, 4}), NCMessageException);
+}
+
 TEST_CASE("Generate invalid node id message", "[message]" ) {
     std::string const key = "12345678901234567890123456789012";
     NCNodeID const node_id = NCNodeID();
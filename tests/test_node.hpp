@@ -12,6 +12,8 @@
 
 // STD includes:
 #include <thread>
+#include <algorithm>
+#include <atomic>
 
 // External includes:
 #include <snitch/snitch.hpp>
@@ -33,11 +35,16 @@ class TestNodeDataProcessor: public NCNodeDataProcessor {
 
         std::vector<uint8_t> initial_data;
         NCNodeID test_node_id;
+        // Number of nc_process_data() calls at the same time:
+        std::atomic<uint32_t> active_calls;
+        std::atomic<uint32_t> max_active_calls;
 };
 
 TestNodeDataProcessor::TestNodeDataProcessor():
     NCNodeDataProcessor(),
-    initial_data()
+    initial_data(),
+    active_calls(0),
+    max_active_calls(0)
     {}
 
 void TestNodeDataProcessor::nc_init(std::vector<uint8_t> data, NCNodeID node_id) {
@@ -47,6 +54,11 @@ void TestNodeDataProcessor::nc_init(std::vector<uint8_t> data, NCNodeID node_id)
 
 [[nodiscard]] std::vector<uint8_t> TestNodeDataProcessor::nc_process_data(std::vector<uint8_t> data) {
     std::vector<uint8_t> result;
+    uint32_t const active = ++active_calls;
+    uint32_t max_active = max_active_calls.load();
+
+    while ((active > max_active) && !max_active_calls.compare_exchange_weak(max_active, active)) {
+    }
 
     size_t i, j = 0;
     uint8_t value = 0;
@@ -65,10 +77,31 @@ void TestNodeDataProcessor::nc_init(std::vector<uint8_t> data, NCNodeID node_id)
     // Simulate long computation:
     auto const sleep_time = std::chrono::seconds(2);
     std::this_thread::sleep_for(sleep_time);
+    active_calls--;
 
     return result;
 }
 
+class TestNodeCancelProcessor: public TestNodeDataProcessor {
+    public:
+        void nc_process_data_cancellable(std::vector<uint8_t> data, std::vector<uint8_t>& result,
+            NCCancellationToken const& token) override {
+            // Long computation, stops early if the task is cancelled:
+            for (uint32_t i = 0; i < 300; i++) {
+                if (token.nc_is_cancelled()) {
+                    cancelled_calls++;
+                    return;
+                }
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+
+            result = data;
+        }
+
+        std::atomic<uint32_t> cancelled_calls = 0;
+};
+
 class TestNodeSocketData {
     public:
 
@@ -77,9 +110,21 @@ class TestNodeSocketData {
         NCEncodedMessageToNode msg_to_node;
         NCMessageCodecServer message_codec;
         uint8_t heartbeat_counter;
-        std::vector<NCNodeID> node_ids;
+        std::vector<NCNodeSlot> node_slots;
         std::vector<NCNodeMessageType> node_messages;
         uint8_t test_mode;
+        uint32_t max_tasks;
+        std::vector<std::vector<uint8_t>> result_batch;
+        // First value of each result, in the order the node has sent them:
+        std::vector<uint8_t> result_values;
+        uint8_t data_counter;
+        uint32_t cancelled_tasks;
+        // Number of tasks handed out, the node numbers its tasks in the same way:
+        uint64_t tasks_sent;
+
+        [[nodiscard]] size_t num_results() const {
+            return static_cast<size_t>(std::ranges::count(node_messages, NCNodeMessageType::NewResultFromNode));
+        }
 
         TestNodeSocketData();
 };
@@ -89,15 +134,21 @@ TestNodeSocketData::TestNodeSocketData():
     msg_to_node(),
     message_codec(TEST_NODE_KEY),
     heartbeat_counter(),
-    node_ids(),
+    node_slots(),
     node_messages(),
-    test_mode()
+    test_mode(),
+    max_tasks(),
+    result_batch(),
+    result_values(),
+    data_counter(),
+    cancelled_tasks(),
+    tasks_sent()
     {}
 
 class TestNodeSocket: public NCNetworkSocketBase {
     public:
         // API
-        void nc_send_data(std::vector<uint8_t> const data) override;
+        void nc_send_data(std::vector<uint8_t> const& data) override;
         [[nodiscard]] std::vector<uint8_t> nc_receive_data() override;
         [[nodiscard]] std::string nc_address() override;
 
@@ -112,19 +163,28 @@ TestNodeSocket::TestNodeSocket(std::shared_ptr<TestNodeSocketData> init_data):
     data_intern(init_data)
     {}
 
-void TestNodeSocket::nc_send_data(std::vector<uint8_t> const data) {
+void TestNodeSocket::nc_send_data(std::vector<uint8_t> const& data) {
     NCDecodedMessageFromNode node_message = data_intern->message_codec.nc_decode_message_from_node(NCEncodedMessageToServer(data));
-    NCNodeID const node_id = node_message.node_id;
-
-    data_intern->node_ids.push_back(node_id);
+    data_intern->node_slots.push_back(node_message.node_slot);
     data_intern->node_messages.push_back(node_message.msg_type);
 
     switch (node_message.msg_type) {
         case NCNodeMessageType::Init:
             if (data_intern->test_mode == 10) {
                 data_intern->msg_to_node = data_intern->message_codec.nc_gen_quit_message();
+            } else if ((data_intern->test_mode == 50) || (data_intern->test_mode == 70)) {
+                NCNegotiatedCapabilities negotiated;
+                negotiated.features = (data_intern->test_mode == 50) ? NC_FEATURE_RESULT_WITH_NEW_DATA : NC_FEATURE_RESULT_BATCH;
+                data_intern->msg_to_node = data_intern->message_codec.nc_gen_init_message_ok(negotiated,
+                    NCNodeSlot{0, 1}, data_intern->server_data);
+            } else if (data_intern->test_mode == 110) {
+                // A new session token for each registration:
+                uint64_t const token = static_cast<uint64_t>(std::ranges::count(data_intern->node_messages, NCNodeMessageType::Init));
+                data_intern->msg_to_node = data_intern->message_codec.nc_gen_init_message_ok(NCNegotiatedCapabilities(),
+                    NCNodeSlot{0, token}, data_intern->server_data);
             } else {
-                data_intern->msg_to_node = data_intern->message_codec.nc_gen_init_message_ok(data_intern->server_data);
+                data_intern->msg_to_node = data_intern->message_codec.nc_gen_init_message_ok(NCNegotiatedCapabilities(),
+                    NCNodeSlot{0, 1}, data_intern->server_data);
             }
         break;
         case NCNodeMessageType::Heartbeat:
@@ -132,11 +192,18 @@ void TestNodeSocket::nc_send_data(std::vector<uint8_t> const data) {
 
             if (data_intern->test_mode == 20) {
                 data_intern->msg_to_node = data_intern->message_codec.nc_gen_quit_message();
+            } else if ((data_intern->test_mode == 100) && (data_intern->heartbeat_counter == 1)) {
+                // Cancel all tasks handed out so far:
+                data_intern->msg_to_node = data_intern->message_codec.nc_gen_cancel_message(data_intern->tasks_sent);
+            } else if ((data_intern->test_mode == 110) && (data_intern->heartbeat_counter == 1)) {
+                // The node has been evicted:
+                data_intern->msg_to_node = data_intern->message_codec.nc_gen_invalid_node_id_error();
             } else {
                 data_intern->msg_to_node = data_intern->message_codec.nc_gen_heartbeat_message_ok();
             }
         break;
         case NCNodeMessageType::NewResultFromNode:
+            data_intern->result_values.push_back(node_message.data.at(0));
             data_intern->server_data.clear();
 
             for (uint8_t v: node_message.data) {
@@ -145,17 +212,55 @@ void TestNodeSocket::nc_send_data(std::vector<uint8_t> const data) {
 
             if (data_intern->test_mode == 30) {
                 data_intern->msg_to_node = data_intern->message_codec.nc_gen_quit_message();
+            } else if ((data_intern->test_mode >= 80) && (data_intern->num_results() >= 3)) {
+                // Quit after the third result:
+                data_intern->msg_to_node = data_intern->message_codec.nc_gen_quit_message();
+            } else if ((data_intern->test_mode == 120) && (data_intern->num_results() == 1)) {
+                // Accept the result and cancel the first task, which is already done:
+                data_intern->msg_to_node = data_intern->message_codec.nc_gen_cancel_message(1);
+            } else if ((data_intern->test_mode == 60) && (data_intern->node_messages.size() >= 4)) {
+                // Quit after the second result of the batch:
+                data_intern->msg_to_node = data_intern->message_codec.nc_gen_quit_message();
             } else {
                 data_intern->msg_to_node = data_intern->message_codec.nc_gen_result_ok_message();
             }
         break;
         case NCNodeMessageType::NodeNeedsMoreData:
+            data_intern->tasks_sent += (data_intern->test_mode == 60) ? 2u : 1u;
+
             if (data_intern->test_mode == 40) {
                 data_intern->msg_to_node = data_intern->message_codec.nc_gen_quit_message();
+            } else if (data_intern->test_mode == 90) {
+                // Different data for each task:
+                data_intern->data_counter++;
+                data_intern->msg_to_node = data_intern->message_codec.nc_gen_new_data_message(
+                    std::vector<uint8_t>(5, data_intern->data_counter));
+            } else if (data_intern->test_mode == 60) {
+                data_intern->max_tasks = data_intern->message_codec.nc_decode_need_more_data_request(node_message.data);
+                data_intern->msg_to_node = data_intern->message_codec.nc_gen_new_data_batch_message(
+                    {data_intern->server_data, {1, 1, 1, 1, 1}});
             } else {
                 data_intern->msg_to_node = data_intern->message_codec.nc_gen_new_data_message(data_intern->server_data);
             }
         break;
+        case NCNodeMessageType::ResultNeedsMoreData:
+            data_intern->server_data = node_message.data;
+
+            // Quit after the second result:
+            if (data_intern->node_messages.size() >= 4) {
+                data_intern->msg_to_node = data_intern->message_codec.nc_gen_quit_message();
+            } else {
+                data_intern->msg_to_node = data_intern->message_codec.nc_gen_new_data_message(data_intern->server_data);
+            }
+        break;
+        case NCNodeMessageType::NewResultBatchFromNode:
+            data_intern->result_batch = data_intern->message_codec.nc_decode_result_batch(node_message.data);
+            data_intern->msg_to_node = data_intern->message_codec.nc_gen_quit_message();
+        break;
+        case NCNodeMessageType::TasksCancelled:
+            data_intern->cancelled_tasks += data_intern->message_codec.nc_decode_tasks_cancelled(node_message.data);
+            data_intern->msg_to_node = data_intern->message_codec.nc_gen_quit_message();
+        break;
         default:
             data_intern->msg_to_node = data_intern->message_codec.nc_gen_unknown_error();
     }
@@ -205,7 +310,7 @@ TEST_CASE("Create node, send init message (test mode 10)", "[node]" ) {
     REQUIRE(init_data->server_data[4] == 5);
     NCEncodedMessageToNode expected_message = init_data->message_codec.nc_gen_quit_message();
     REQUIRE(init_data->heartbeat_counter == 0);
-    REQUIRE(init_data->node_ids.size() == 1);
+    REQUIRE(init_data->node_slots.size() == 1);
     REQUIRE(init_data->node_messages.size() == 1);
     REQUIRE(init_data->node_messages[0] == NCNodeMessageType::Init);
     REQUIRE(init_data->test_mode == 10);
@@ -233,7 +338,7 @@ TEST_CASE("Create node, send heartbeat message (test mode 20)", "[node]" ) {
 
     NCEncodedMessageToNode expected_message = init_data->message_codec.nc_gen_quit_message();
     REQUIRE(init_data->heartbeat_counter == 1);
-    REQUIRE(init_data->node_ids.size() == 11);
+    REQUIRE(init_data->node_slots.size() == 11);
 
     REQUIRE(init_data->node_messages.size() == 11);
     REQUIRE(init_data->node_messages[0] == NCNodeMessageType::Init);
@@ -272,7 +377,7 @@ TEST_CASE("Create node, send new result message (test mode 30)", "[node]" ) {
     REQUIRE(init_data->server_data[4] == 15);
 
     NCEncodedMessageToNode expected_message = init_data->message_codec.nc_gen_quit_message();
-    REQUIRE(init_data->node_ids.size() == 3);
+    REQUIRE(init_data->node_slots.size() == 3);
 
     REQUIRE(init_data->node_messages.size() == 3);
     REQUIRE(init_data->node_messages[0] == NCNodeMessageType::Init);
@@ -303,7 +408,7 @@ TEST_CASE("Create node, send node needs data message (test mode 40)", "[node]" )
     REQUIRE(init_data->server_data[4] == 5);
 
     NCEncodedMessageToNode expected_message = init_data->message_codec.nc_gen_quit_message();
-    REQUIRE(init_data->node_ids.size() == 2);
+    REQUIRE(init_data->node_slots.size() == 2);
 
     REQUIRE(init_data->node_messages.size() == 2);
     REQUIRE(init_data->node_messages[0] == NCNodeMessageType::Init);
@@ -312,3 +417,274 @@ TEST_CASE("Create node, send node needs data message (test mode 40)", "[node]" )
     REQUIRE(init_data->test_mode == 40);
     REQUIRE(node1.nc_get_node_id() == data_processor1->test_node_id);
 }
+
+TEST_CASE("Create node, send result and need more data message (test mode 50)", "[node]" ) {
+    NCConfiguration config1 = NCConfiguration(TEST_NODE_KEY);
+    config1.heartbeat_timeout = 10;
+    std::shared_ptr<TestNodeSocketData> init_data = std::make_shared<TestNodeSocketData>();
+    init_data->test_mode = 50;
+    init_data->server_data = {1, 2, 3, 4, 5};
+
+    std::shared_ptr<TestNodeDataProcessor> data_processor1 = std::make_shared<TestNodeDataProcessor>();
+    std::unique_ptr<TestClient> client1 = std::make_unique<TestClient>(init_data);
+    NCNode node1(config1, data_processor1, std::move(client1));
+    node1.nc_run();
+
+    REQUIRE(init_data->server_data.size() == 5);
+    REQUIRE(init_data->server_data != std::vector<uint8_t>({1, 2, 3, 4, 5}));
+
+    // One message per task after the first request:
+    REQUIRE(init_data->node_messages.size() == 4);
+    REQUIRE(init_data->node_messages[0] == NCNodeMessageType::Init);
+    REQUIRE(init_data->node_messages[1] == NCNodeMessageType::NodeNeedsMoreData);
+    REQUIRE(init_data->node_messages[2] == NCNodeMessageType::ResultNeedsMoreData);
+    REQUIRE(init_data->node_messages[3] == NCNodeMessageType::ResultNeedsMoreData);
+
+    REQUIRE(init_data->test_mode == 50);
+}
+
+TEST_CASE("Create node, process a batch of tasks (test mode 60)", "[node]" ) {
+    NCConfiguration config1 = NCConfiguration(TEST_NODE_KEY);
+    config1.heartbeat_timeout = 10;
+    config1.batch_size = 2;
+    std::shared_ptr<TestNodeSocketData> init_data = std::make_shared<TestNodeSocketData>();
+    init_data->test_mode = 60;
+    init_data->server_data = {1, 2, 3, 4, 5};
+
+    std::shared_ptr<TestNodeDataProcessor> data_processor1 = std::make_shared<TestNodeDataProcessor>();
+    std::unique_ptr<TestClient> client1 = std::make_unique<TestClient>(init_data);
+    NCNode node1(config1, data_processor1, std::move(client1));
+    node1.nc_run();
+
+    // Result of the second task:
+    REQUIRE(init_data->server_data == std::vector<uint8_t>({3, 4, 5, 6, 7}));
+    REQUIRE(init_data->max_tasks == 2);
+
+    // One request for both tasks:
+    REQUIRE(init_data->node_messages.size() == 4);
+    REQUIRE(init_data->node_messages[0] == NCNodeMessageType::Init);
+    REQUIRE(init_data->node_messages[1] == NCNodeMessageType::NodeNeedsMoreData);
+    REQUIRE(init_data->node_messages[2] == NCNodeMessageType::NewResultFromNode);
+    REQUIRE(init_data->node_messages[3] == NCNodeMessageType::NewResultFromNode);
+
+    REQUIRE(init_data->test_mode == 60);
+}
+
+TEST_CASE("Create node, send a result batch (test mode 70)", "[node]" ) {
+    NCConfiguration config1 = NCConfiguration(TEST_NODE_KEY);
+    config1.heartbeat_timeout = 10;
+    config1.result_batch_size = 2;
+    config1.result_batch_time = 60 * 1000;
+    std::shared_ptr<TestNodeSocketData> init_data = std::make_shared<TestNodeSocketData>();
+    init_data->test_mode = 70;
+    init_data->server_data = {1, 2, 3, 4, 5};
+
+    std::shared_ptr<TestNodeDataProcessor> data_processor1 = std::make_shared<TestNodeDataProcessor>();
+    std::unique_ptr<TestClient> client1 = std::make_unique<TestClient>(init_data);
+    NCNode node1(config1, data_processor1, std::move(client1));
+    node1.nc_run();
+
+    REQUIRE(init_data->result_batch.size() == 2);
+    REQUIRE(init_data->result_batch[0] == std::vector<uint8_t>({3, 6, 9, 12, 15}));
+    REQUIRE(init_data->result_batch[1] == std::vector<uint8_t>({3, 6, 9, 12, 15}));
+
+    // Both results in one message:
+    REQUIRE(init_data->node_messages.size() == 4);
+    REQUIRE(init_data->node_messages[0] == NCNodeMessageType::Init);
+    REQUIRE(init_data->node_messages[1] == NCNodeMessageType::NodeNeedsMoreData);
+    REQUIRE(init_data->node_messages[2] == NCNodeMessageType::NodeNeedsMoreData);
+    REQUIRE(init_data->node_messages[3] == NCNodeMessageType::NewResultBatchFromNode);
+
+    REQUIRE(init_data->test_mode == 70);
+}
+
+TEST_CASE("Create node, fetch tasks while computing (test mode 80)", "[node]" ) {
+    NCConfiguration config1 = NCConfiguration(TEST_NODE_KEY);
+    config1.heartbeat_timeout = 10;
+    config1.prefetch_depth = 2;
+    std::shared_ptr<TestNodeSocketData> init_data = std::make_shared<TestNodeSocketData>();
+    init_data->test_mode = 80;
+    init_data->server_data = {1, 2, 3, 4, 5};
+
+    std::shared_ptr<TestNodeDataProcessor> data_processor1 = std::make_shared<TestNodeDataProcessor>();
+    std::unique_ptr<TestClient> client1 = std::make_unique<TestClient>(init_data);
+    NCNode node1(config1, data_processor1, std::move(client1));
+    node1.nc_run();
+
+    REQUIRE(init_data->server_data == std::vector<uint8_t>({3, 6, 9, 12, 15}));
+    REQUIRE(init_data->num_results() == 3);
+
+    // The next task is requested before the first result is sent:
+    REQUIRE(init_data->node_messages[0] == NCNodeMessageType::Init);
+    REQUIRE(init_data->node_messages[1] == NCNodeMessageType::NodeNeedsMoreData);
+    REQUIRE(init_data->node_messages[2] == NCNodeMessageType::NodeNeedsMoreData);
+
+    REQUIRE(init_data->test_mode == 80);
+    REQUIRE(node1.nc_get_node_id() == data_processor1->test_node_id);
+}
+
+TEST_CASE("Create node, compute several tasks at the same time (test mode 90)", "[node]" ) {
+    NCConfiguration config1 = NCConfiguration(TEST_NODE_KEY);
+    config1.heartbeat_timeout = 10;
+    config1.num_workers = 2;
+    std::shared_ptr<TestNodeSocketData> init_data = std::make_shared<TestNodeSocketData>();
+    init_data->test_mode = 90;
+    init_data->server_data = {1, 2, 3, 4, 5};
+
+    std::shared_ptr<TestNodeDataProcessor> data_processor1 = std::make_shared<TestNodeDataProcessor>();
+    std::unique_ptr<TestClient> client1 = std::make_unique<TestClient>(init_data);
+    NCNode node1(config1, data_processor1, std::move(client1));
+    node1.nc_run();
+
+    // One registration for both workers:
+    REQUIRE(std::ranges::count(init_data->node_messages, NCNodeMessageType::Init) == 1);
+    REQUIRE(data_processor1->max_active_calls.load() == 2);
+
+    // The results are sent in the order of the tasks, initial data + 2 * task data:
+    REQUIRE(init_data->result_values == std::vector<uint8_t>({3, 5, 7}));
+
+    REQUIRE(init_data->test_mode == 90);
+    REQUIRE(node1.nc_get_node_id() == data_processor1->test_node_id);
+}
+
+TEST_CASE("Create node, cancel the current task (test mode 100)", "[node]" ) {
+    NCConfiguration config1 = NCConfiguration(TEST_NODE_KEY);
+    // The answer to the first heartbeat is cancel:
+    config1.heartbeat_timeout = 1;
+    std::shared_ptr<TestNodeSocketData> init_data = std::make_shared<TestNodeSocketData>();
+    init_data->test_mode = 100;
+    init_data->server_data = {1, 2, 3, 4, 5};
+
+    std::shared_ptr<TestNodeCancelProcessor> data_processor1 = std::make_shared<TestNodeCancelProcessor>();
+    std::unique_ptr<TestClient> client1 = std::make_unique<TestClient>(init_data);
+    NCNode node1(config1, data_processor1, std::move(client1));
+    node1.nc_run();
+
+    REQUIRE(init_data->node_messages[0] == NCNodeMessageType::Init);
+    REQUIRE(init_data->node_messages[1] == NCNodeMessageType::NodeNeedsMoreData);
+    REQUIRE(data_processor1->cancelled_calls.load() == 1);
+    REQUIRE(init_data->cancelled_tasks == 1);
+    // No result for the cancelled task:
+    REQUIRE(init_data->num_results() == 0);
+    REQUIRE(std::ranges::count(init_data->node_messages, NCNodeMessageType::TasksCancelled) == 1);
+}
+
+TEST_CASE("Create node, cancel the tasks of all workers (test mode 100)", "[node]" ) {
+    NCConfiguration config1 = NCConfiguration(TEST_NODE_KEY);
+    config1.heartbeat_timeout = 1;
+    config1.num_workers = 2;
+    std::shared_ptr<TestNodeSocketData> init_data = std::make_shared<TestNodeSocketData>();
+    init_data->test_mode = 100;
+    init_data->server_data = {1, 2, 3, 4, 5};
+
+    std::shared_ptr<TestNodeCancelProcessor> data_processor1 = std::make_shared<TestNodeCancelProcessor>();
+    std::unique_ptr<TestClient> client1 = std::make_unique<TestClient>(init_data);
+    NCNode node1(config1, data_processor1, std::move(client1));
+    node1.nc_run();
+
+    // Both workers stop, the tasks in the queue are dropped as well:
+    REQUIRE(data_processor1->cancelled_calls.load() >= 2);
+    REQUIRE(init_data->cancelled_tasks >= 1);
+    REQUIRE(init_data->num_results() == 0);
+}
+
+TEST_CASE("Create node, cancel only the tasks handed out before (test mode 120)", "[node]" ) {
+    NCConfiguration config1 = NCConfiguration(TEST_NODE_KEY);
+    config1.heartbeat_timeout = 10;
+    std::shared_ptr<TestNodeSocketData> init_data = std::make_shared<TestNodeSocketData>();
+    init_data->test_mode = 120;
+    init_data->server_data = {1, 2, 3, 4, 5};
+
+    std::shared_ptr<TestNodeDataProcessor> data_processor1 = std::make_shared<TestNodeDataProcessor>();
+    std::unique_ptr<TestClient> client1 = std::make_unique<TestClient>(init_data);
+    NCNode node1(config1, data_processor1, std::move(client1));
+    node1.nc_run();
+
+    // The Cancel is the answer to the first result, it is accepted and not sent again:
+    REQUIRE(init_data->node_messages == std::vector<NCNodeMessageType>({
+        NCNodeMessageType::Init,
+        NCNodeMessageType::NodeNeedsMoreData,
+        NCNodeMessageType::NewResultFromNode,
+        NCNodeMessageType::NodeNeedsMoreData,
+        NCNodeMessageType::NewResultFromNode,
+        NCNodeMessageType::NodeNeedsMoreData,
+        NCNodeMessageType::NewResultFromNode}));
+    // The later tasks are not cancelled:
+    REQUIRE(init_data->cancelled_tasks == 0);
+}
+
+TEST_CASE("Create node, cancel only the tasks handed out before with several workers (test mode 120)", "[node]" ) {
+    NCConfiguration config1 = NCConfiguration(TEST_NODE_KEY);
+    config1.heartbeat_timeout = 10;
+    config1.num_workers = 2;
+    std::shared_ptr<TestNodeSocketData> init_data = std::make_shared<TestNodeSocketData>();
+    init_data->test_mode = 120;
+    init_data->server_data = {1, 2, 3, 4, 5};
+
+    std::shared_ptr<TestNodeDataProcessor> data_processor1 = std::make_shared<TestNodeDataProcessor>();
+    std::unique_ptr<TestClient> client1 = std::make_unique<TestClient>(init_data);
+    NCNode node1(config1, data_processor1, std::move(client1));
+    node1.nc_run();
+
+    REQUIRE(init_data->num_results() == 3);
+    REQUIRE(std::ranges::count(init_data->node_messages, NCNodeMessageType::TasksCancelled) == 0);
+}
+
+TEST_CASE("Create node, register again after an eviction (test mode 110)", "[node]" ) {
+    NCConfiguration config1 = NCConfiguration(TEST_NODE_KEY);
+    // The answer to the first heartbeat is InvalidNodeID:
+    config1.heartbeat_timeout = 1;
+    std::shared_ptr<TestNodeSocketData> init_data = std::make_shared<TestNodeSocketData>();
+    init_data->test_mode = 110;
+    init_data->server_data = {1, 2, 3, 4, 5};
+
+    std::shared_ptr<TestNodeCancelProcessor> data_processor1 = std::make_shared<TestNodeCancelProcessor>();
+    std::unique_ptr<TestClient> client1 = std::make_unique<TestClient>(init_data);
+    NCNode node1(config1, data_processor1, std::move(client1));
+    node1.nc_run();
+
+    // The heartbeat thread has registered the node again:
+    REQUIRE(std::ranges::count(init_data->node_messages, NCNodeMessageType::Init) == 2);
+    REQUIRE(init_data->num_results() == 3);
+
+    // The result of the task of the first registration is dropped:
+    for (size_t i = 0; i < init_data->node_messages.size(); i++) {
+        if (init_data->node_messages[i] == NCNodeMessageType::NewResultFromNode) {
+            REQUIRE(init_data->node_slots[i].token == 2);
+        }
+    }
+}
+
+TEST_CASE("Create node, register all workers again after an eviction (test mode 110)", "[node]" ) {
+    NCConfiguration config1 = NCConfiguration(TEST_NODE_KEY);
+    config1.heartbeat_timeout = 1;
+    config1.num_workers = 2;
+    std::shared_ptr<TestNodeSocketData> init_data = std::make_shared<TestNodeSocketData>();
+    init_data->test_mode = 110;
+    init_data->server_data = {1, 2, 3, 4, 5};
+
+    std::shared_ptr<TestNodeCancelProcessor> data_processor1 = std::make_shared<TestNodeCancelProcessor>();
+    std::unique_ptr<TestClient> client1 = std::make_unique<TestClient>(init_data);
+    NCNode node1(config1, data_processor1, std::move(client1));
+    node1.nc_run();
+
+    REQUIRE(std::ranges::count(init_data->node_messages, NCNodeMessageType::Init) == 2);
+    REQUIRE(init_data->num_results() == 3);
+
+    // The queued tasks and the results of the first registration are dropped:
+    for (size_t i = 0; i < init_data->node_messages.size(); i++) {
+        if (init_data->node_messages[i] == NCNodeMessageType::NewResultFromNode) {
+            REQUIRE(init_data->node_slots[i].token == 2);
+        }
+    }
+}
+
+TEST_CASE("Process data into the result buffer", "[node]" ) {
+    TestNodeDataProcessor processor;
+    NCNodeDataProcessor& base = processor;
+    std::vector<uint8_t> result;
+
+    base.nc_init({1, 2}, NCNodeID());
+    base.nc_process_data_into({1, 2, 3}, result);
+    REQUIRE(result == std::vector<uint8_t>({3, 6, 7}));
+}
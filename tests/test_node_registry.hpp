@@ -0,0 +1,239 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file contains the tests for the node registry.
+
+    Run only node registry tests:
+    xmake run -w ./ nc_test [node_registry]
+*/
+
+// STD includes:
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <tuple>
+#include <optional>
+
+// External includes:
+#include <snitch/snitch.hpp>
+
+// Local includes:
+#include "nodcru2/nc_node_registry.hpp"
+
+using namespace nodcru2;
+
+TEST_CASE("Register and find nodes", "[node_registry]" ) {
+    NCNodeRegistry registry(std::chrono::seconds(10));
+    NCNodeID const node_id1, node_id2;
+
+    NCNodeSlot const node_slot1 = registry.nc_register(node_id1);
+    NCNodeSlot const node_slot2 = registry.nc_register(node_id2);
+
+    REQUIRE(registry.nc_size() == 2);
+    REQUIRE(node_slot1.slot == 0);
+    REQUIRE(node_slot2.slot == 1);
+    REQUIRE(*registry.nc_find(node_slot1) == node_id1);
+    REQUIRE(*registry.nc_find(node_slot2) == node_id2);
+
+    // Wrong token and unknown slot:
+    REQUIRE(registry.nc_find(NCNodeSlot{node_slot1.slot, node_slot1.token + 1}) == std::nullopt);
+    REQUIRE(registry.nc_find(NCNodeSlot{2, node_slot1.token}) == std::nullopt);
+    REQUIRE(registry.nc_find(NCNodeSlot()) == std::nullopt);
+    REQUIRE(!registry.nc_update_time(NCNodeSlot()));
+    REQUIRE(registry.nc_update_time(node_slot2));
+}
+
+TEST_CASE("Register a node again", "[node_registry]" ) {
+    NCNodeRegistry registry(std::chrono::seconds(10));
+    NCNodeID const node_id1;
+
+    NCNodeSlot const node_slot1 = registry.nc_register(node_id1);
+    NCNodeSlot const node_slot2 = registry.nc_register(node_id1);
+
+    // Same slot, new token:
+    REQUIRE(registry.nc_size() == 1);
+    REQUIRE(node_slot2.slot == node_slot1.slot);
+    REQUIRE(node_slot2.token != node_slot1.token);
+    REQUIRE(registry.nc_find(node_slot1) == std::nullopt);
+    REQUIRE(*registry.nc_find(node_slot2) == node_id1);
+}
+
+TEST_CASE("Last contact of a node", "[node_registry]" ) {
+    NCNodeRegistry registry(std::chrono::seconds(10));
+    NCNodeID const node_id1;
+
+    NCNodeSlot const node_slot1 = registry.nc_register(node_id1);
+    auto const time1 = registry.nc_last_contact(node_slot1.slot);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(registry.nc_update_time(node_slot1));
+    REQUIRE(registry.nc_last_contact(node_slot1.slot) > time1);
+}
+
+TEST_CASE("Batch size of a node", "[node_registry]" ) {
+    NCNodeRegistry registry(std::chrono::seconds(10));
+    NCNodeID const node_id1;
+
+    NCNodeSlot const node_slot1 = registry.nc_register(node_id1);
+    REQUIRE(registry.nc_batch_size(node_slot1) == 1);
+    REQUIRE(registry.nc_set_batch_size(node_slot1, 4));
+    REQUIRE(registry.nc_batch_size(node_slot1) == 4);
+    REQUIRE(registry.nc_set_batch_size(node_slot1, 0));
+    REQUIRE(registry.nc_batch_size(node_slot1) == 1);
+
+    // A node that registers again starts with one task per request:
+    REQUIRE(registry.nc_set_batch_size(node_slot1, 4));
+    NCNodeSlot const node_slot2 = registry.nc_register(node_id1);
+    REQUIRE(registry.nc_batch_size(node_slot2) == 1);
+}
+
+TEST_CASE("Suspect a node", "[node_registry]" ) {
+    NCNodeRegistry registry(std::chrono::seconds(10));
+    NCNodeID const node_id1;
+    auto const timeout = std::chrono::seconds(20);
+
+    NCNodeSlot const node_slot1 = registry.nc_register(node_id1);
+
+    // Not enough heartbeats, use the static timeout:
+    REQUIRE(registry.nc_suspect_after(node_slot1.slot, 8.0, timeout) == timeout);
+
+    for (size_t i = 0; i < NC_PHI_MIN_SAMPLES; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        REQUIRE(registry.nc_update_time(node_slot1));
+    }
+
+    // Regular heartbeats, the learned time is shorter than the timeout:
+    REQUIRE(registry.nc_suspect_after(node_slot1.slot, 8.0, timeout) == timeout);
+    // Learned from the heartbeat intervals:
+    auto const learned = registry.nc_suspect_after(node_slot1.slot, 8.0, std::chrono::milliseconds(1));
+    REQUIRE(learned > std::chrono::milliseconds(1));
+    REQUIRE(learned < std::chrono::seconds(1));
+    // Detector disabled or unknown slot:
+    REQUIRE(registry.nc_suspect_after(node_slot1.slot, 0.0, timeout) == timeout);
+    REQUIRE(registry.nc_suspect_after(1, 8.0, timeout) == timeout);
+}
+
+TEST_CASE("Don't suspect a node after one late heartbeat", "[node_registry]" ) {
+    NCNodeRegistry registry(std::chrono::seconds(10));
+    NCNodeID const node_id1;
+    auto const interval = std::chrono::milliseconds(20);
+    // The server uses two heartbeat timeouts:
+    auto const timeout = interval * 2;
+
+    NCNodeSlot const node_slot1 = registry.nc_register(node_id1);
+
+    for (size_t i = 0; i < 2 * NC_PHI_MIN_SAMPLES; i++) {
+        std::this_thread::sleep_for(interval);
+        REQUIRE(registry.nc_update_time(node_slot1));
+    }
+
+    // The next heartbeat is late by half an interval:
+    std::this_thread::sleep_for(interval + (interval / 2));
+    auto const deadline = registry.nc_last_contact(node_slot1.slot) +
+        registry.nc_suspect_after(node_slot1.slot, 8.0, timeout);
+    REQUIRE(deadline > std::chrono::steady_clock::now());
+    REQUIRE(registry.nc_update_time(node_slot1));
+}
+
+TEST_CASE("Evict a node", "[node_registry]" ) {
+    NCNodeRegistry registry(std::chrono::milliseconds(50));
+    NCNodeID const node_id1, node_id2, node_id3;
+
+    NCNodeSlot const node_slot1 = registry.nc_register(node_id1);
+    std::ignore = registry.nc_register(node_id2);
+
+    auto const evicted = registry.nc_evict(node_slot1.slot);
+    REQUIRE(evicted.has_value());
+    REQUIRE(*evicted == node_id1);
+    REQUIRE(registry.nc_num_nodes() == 1);
+    REQUIRE(registry.nc_find(node_slot1) == std::nullopt);
+    REQUIRE(!registry.nc_update_time(node_slot1));
+    REQUIRE(registry.nc_find(NCNodeSlot{node_slot1.slot, 0}) == std::nullopt);
+
+    // Only once:
+    REQUIRE(!registry.nc_evict(node_slot1.slot).has_value());
+
+    // The slot is not reused before the delay:
+    NCNodeSlot const node_slot3 = registry.nc_register(node_id3);
+    REQUIRE(node_slot3.slot == 2);
+
+    // The evicted node registers again and gets the old slot:
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    NCNodeSlot const node_slot4 = registry.nc_register(node_id1);
+    REQUIRE(node_slot4.slot == node_slot1.slot);
+    REQUIRE(*registry.nc_find(node_slot4) == node_id1);
+    REQUIRE(registry.nc_size() == 3);
+    REQUIRE(registry.nc_num_nodes() == 3);
+}
+
+TEST_CASE("Register and find nodes from many threads", "[node_registry]" ) {
+    NCNodeRegistry registry(std::chrono::seconds(10));
+    size_t const num_threads = 4;
+    size_t const num_nodes = 1500;
+    std::vector<std::vector<bool>> found(num_threads, std::vector<bool>(num_nodes, false));
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < num_threads; t++) {
+        threads.emplace_back([&registry, &found, t]() {
+            for (size_t i = 0; i < num_nodes; i++) {
+                NCNodeID const node_id;
+                NCNodeSlot const node_slot = registry.nc_register(node_id);
+                std::optional<NCNodeID> const result = registry.nc_find(node_slot);
+                found[t][i] = result.has_value() && (*result == node_id) && registry.nc_update_time(node_slot);
+            }
+        });
+    }
+
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    // More than one segment is used:
+    REQUIRE(registry.nc_size() == num_threads * num_nodes);
+
+    for (auto const& values: found) {
+        for (bool const value: values) {
+            REQUIRE(value);
+        }
+    }
+}
+
+TEST_CASE("Evict and reuse slots from many threads", "[node_registry]" ) {
+    // Reuse the slots immediately, other threads look them up at the same time:
+    NCNodeRegistry registry(std::chrono::seconds(0));
+    size_t const num_threads = 4;
+    size_t const num_nodes = 2000;
+    std::vector<std::vector<bool>> found(num_threads, std::vector<bool>(num_nodes, false));
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < num_threads; t++) {
+        threads.emplace_back([&registry, &found, t]() {
+            for (size_t i = 0; i < num_nodes; i++) {
+                NCNodeID const node_id;
+                NCNodeSlot const node_slot = registry.nc_register(node_id);
+                std::optional<NCNodeID> const result = registry.nc_find(node_slot);
+                std::optional<NCNodeID> const evicted = registry.nc_evict(node_slot.slot);
+                // The slot may be given to another node now, the old token is rejected:
+                found[t][i] = result.has_value() && (*result == node_id) && evicted.has_value() &&
+                    (*evicted == node_id) && !registry.nc_find(node_slot).has_value();
+            }
+        });
+    }
+
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    // Only a few slots are used:
+    REQUIRE(registry.nc_size() <= num_threads);
+    REQUIRE(registry.nc_num_nodes() == 0);
+
+    for (auto const& values: found) {
+        for (bool const value: values) {
+            REQUIRE(value);
+        }
+    }
+}
@@ -13,12 +13,14 @@
 // STD includes:
 #include <iostream>
 #include <unordered_map>
+#include <vector>
 
 // External includes:
 #include <snitch/snitch.hpp>
 
 // Local includes:
 #include "nodcru2/nc_nodeid.hpp"
+#include "nodcru2/nc_exceptions.hpp"
 
 using namespace nodcru2;
 
@@ -51,3 +53,18 @@ TEST_CASE("Hash nodeid", "[nodeid]" ) {
     REQUIRE(map1[nodeid2] == "node 2");
     REQUIRE(map1[nodeid3] == "node 3");
 }
+
+TEST_CASE("Encode / decode node slot", "[nodeid]" ) {
+    NCNodeSlot const node_slot1{42, nc_gen_session_token()};
+    std::vector<uint8_t> bytes(NC_NODE_SLOT_LENGTH);
+
+    nc_encode_node_slot(node_slot1, bytes);
+    NCNodeSlot const node_slot2 = nc_decode_node_slot(bytes);
+
+    REQUIRE(node_slot2 == node_slot1);
+    REQUIRE(node_slot1.token != 0);
+    REQUIRE(NCNodeSlot().slot == NC_INVALID_SLOT);
+
+    bytes.pop_back();
+    REQUIRE_THROWS_AS(nc_decode_node_slot(bytes), NCMessageException);
+}
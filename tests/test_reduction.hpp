@@ -0,0 +1,100 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file contains the tests for the reduction processor.
+
+    Run only reduction tests:
+    xmake run -w ./ nc_test [reduction]
+*/
+
+// STD includes:
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// External includes:
+#include <snitch/snitch.hpp>
+
+// Local includes:
+#include "nodcru2/nc_reduction.hpp"
+
+using namespace nodcru2;
+
+template <typename T>
+std::vector<uint8_t> test_to_bytes(std::vector<T> const& values) {
+    std::vector<uint8_t> result(values.size() * sizeof(T));
+    std::memcpy(result.data(), values.data(), result.size());
+    return result;
+}
+
+class TestSumProcessor: public NCSumReductionProcessor<uint64_t> {
+    public:
+        void nc_save_reduction(std::vector<uint64_t> const& total) override {
+            saved = total;
+        }
+
+        std::vector<uint64_t> saved;
+};
+
+class TestMaxProcessor: public NCMaxReductionProcessor<double> {
+    public:
+        void nc_save_reduction(std::vector<double> const& total) override {
+            saved = total;
+        }
+
+        std::vector<double> saved;
+};
+
+TEST_CASE("Reduce arrays", "[reduction]" ) {
+    std::vector<int32_t> total;
+    nc_reduce_array(total, std::span<const uint8_t>(test_to_bytes<int32_t>({1, 2, 3})), std::plus<int32_t>());
+    nc_reduce_array(total, std::span<const uint8_t>(test_to_bytes<int32_t>({10, 20, 30, 40})), std::plus<int32_t>());
+
+    REQUIRE(total == std::vector<int32_t>{11, 22, 33, 40});
+
+    nc_reduce_array(total, std::span<const int32_t>(std::vector<int32_t>{5, 50}), NCMinimum<int32_t>());
+    REQUIRE(total == std::vector<int32_t>{5, 22, 33, 40});
+
+    std::vector<uint8_t> invalid = {1, 2, 3};
+    REQUIRE_THROWS_AS(nc_reduce_array(total, std::span<const uint8_t>(invalid), std::plus<int32_t>()), NCMessageException);
+}
+
+TEST_CASE("Sum results from many threads", "[reduction]" ) {
+    TestSumProcessor processor;
+    NCServerDataProcessor& base = processor;
+    std::vector<std::thread> threads;
+
+    for (uint32_t i = 0; i < 8; i++) {
+        threads.emplace_back([&base] () {
+            for (uint64_t j = 0; j < 1000; j++) {
+                base.nc_process_result(NCNodeID(), test_to_bytes<uint64_t>({1, j}));
+            }
+        });
+    }
+
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    base.nc_save_data();
+
+    REQUIRE(processor.saved.size() == 2);
+    REQUIRE(processor.saved[0] == 8000);
+    REQUIRE(processor.saved[1] == 8 * 499500);
+}
+
+TEST_CASE("Maximum of results", "[reduction]" ) {
+    TestMaxProcessor processor;
+    NCServerDataProcessor& base = processor;
+
+    base.nc_process_result(NCNodeID(), test_to_bytes<double>({1.5, -2.0}));
+    base.nc_process_result(NCNodeID(), test_to_bytes<double>({0.5, 3.0, 7.0}));
+
+    REQUIRE(processor.nc_get_reduction() == std::vector<double>{1.5, 3.0, 7.0});
+
+    base.nc_save_data();
+    REQUIRE(processor.saved == std::vector<double>{1.5, 3.0, 7.0});
+}
@@ -0,0 +1,124 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file contains the tests for the serialization.
+
+    Run only serializer tests:
+    xmake run -w ./ nc_test [serializer]
+*/
+
+// STD includes:
+#include <array>
+
+// External includes:
+#include <snitch/snitch.hpp>
+
+// Local includes:
+#include "nodcru2/nc_serializer.hpp"
+#include "nodcru2/nc_exceptions.hpp"
+
+using namespace nodcru2;
+
+struct TestWorkItem {
+    double re;
+    double im;
+    uint32_t width;
+    uint8_t flag;
+};
+
+static_assert(NCSerializer<NCBinarySerializer<TestWorkItem>, TestWorkItem>);
+static_assert(NCSerializer<NCBinarySerializer<std::vector<float>>, std::vector<float>>);
+
+TEST_CASE("Write / read trivially copyable values", "[serializer]" ) {
+    TestWorkItem const item1{1.5, -2.5, 1024, 7};
+    NCBinaryWriter writer;
+
+    writer.nc_write(uint8_t{3});
+    writer.nc_write(item1);
+    writer.nc_write(int16_t{-12});
+
+    std::vector<uint8_t> const data = writer.nc_get_data();
+    NCBinaryReader reader(data);
+
+    REQUIRE(reader.nc_read<uint8_t>() == 3);
+    TestWorkItem const item2 = reader.nc_read<TestWorkItem>();
+    REQUIRE(item2.re == 1.5);
+    REQUIRE(item2.im == -2.5);
+    REQUIRE(item2.width == 1024);
+    REQUIRE(item2.flag == 7);
+    REQUIRE(reader.nc_read<int16_t>() == -12);
+    REQUIRE(reader.nc_at_end());
+
+    REQUIRE_THROWS_AS(reader.nc_read<uint32_t>(), NCSerializerException);
+}
+
+TEST_CASE("Read arrays as views", "[serializer]" ) {
+    std::vector<double> const values1 = {1.0, 2.0, 3.0, 4.0};
+    std::array<uint32_t, 3> const values2 = {5, 6, 7};
+    NCBinaryWriter writer;
+
+    writer.nc_write(uint8_t{1});
+    writer.nc_write(values1);
+    writer.nc_write(std::span(values2));
+
+    std::vector<uint8_t> const data = writer.nc_get_data();
+    NCBinaryReader reader(data);
+
+    REQUIRE(reader.nc_read<uint8_t>() == 1);
+
+    std::span<const double> const view1 = reader.nc_read_span<double>();
+    REQUIRE(view1.size() == 4);
+    REQUIRE(view1[3] == 4.0);
+    // No copy, the view points into the buffer:
+    REQUIRE(static_cast<void const*>(view1.data()) >= static_cast<void const*>(data.data()));
+    REQUIRE(static_cast<void const*>(view1.data()) < static_cast<void const*>(data.data() + data.size()));
+
+    std::vector<uint32_t> const values3 = reader.nc_read_vector<uint32_t>();
+    REQUIRE(values3.size() == 3);
+    REQUIRE(values3[0] == 5);
+    REQUIRE(values3[2] == 7);
+}
+
+TEST_CASE("Read nested vectors", "[serializer]" ) {
+    std::vector<std::vector<int32_t>> const values1 = {{1, 2}, {}, {3, 4, 5}};
+    NCBinaryWriter writer;
+    writer.nc_write(values1);
+
+    std::vector<uint8_t> const data = writer.nc_get_data();
+    NCBinaryReader reader(data);
+    std::vector<std::span<const int32_t>> const values2 = reader.nc_read_nested<int32_t>();
+
+    REQUIRE(values2.size() == 3);
+    REQUIRE(values2[0].size() == 2);
+    REQUIRE(values2[1].empty());
+    REQUIRE(values2[2].size() == 3);
+    REQUIRE(values2[2][2] == 5);
+}
+
+TEST_CASE("Binary serializer", "[serializer]" ) {
+    NCBinarySerializer<std::vector<float>> serializer;
+    std::vector<float> const values1 = {0.5f, 1.5f, 2.5f};
+
+    std::vector<uint8_t> const data = serializer.nc_serialize(values1);
+    REQUIRE(serializer.nc_deserialize(data) == values1);
+    REQUIRE(serializer.nc_deserialize_view(data)[1] == 1.5f);
+}
+
+TEST_CASE("Invalid serialized data", "[serializer]" ) {
+    NCBinarySerializer<std::vector<float>> serializer;
+    std::vector<uint8_t> data = serializer.nc_serialize({1.0f, 2.0f});
+
+    // Wrong byte order tag:
+    data[0] = 0;
+    REQUIRE_THROWS_AS(serializer.nc_deserialize(data), NCSerializerException);
+
+    // Truncated:
+    data = serializer.nc_serialize({1.0f, 2.0f});
+    data.pop_back();
+    REQUIRE_THROWS_AS(serializer.nc_deserialize(data), NCSerializerException);
+
+    REQUIRE_THROWS_AS(serializer.nc_deserialize(std::vector<uint8_t>()), NCSerializerException);
+}
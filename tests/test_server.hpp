@@ -33,6 +33,7 @@ class TestServerDataProcessor: public NCServerDataProcessor {
         void nc_node_timeout(NCNodeID node_id) override;
         [[nodiscard]] std::vector<uint8_t> nc_get_new_data(NCNodeID node_id) override;
         void nc_process_result(NCNodeID node_id, std::vector<uint8_t> result) override;
+        void nc_tasks_cancelled(NCNodeID node_id, uint32_t const num_tasks) override;
 
         TestServerDataProcessor(std::vector<uint8_t> data);
 
@@ -43,6 +44,9 @@ class TestServerDataProcessor: public NCServerDataProcessor {
         std::vector<NCNodeID> timeout_nodes;
         std::vector<NCNodeID> data_nodes;
         std::vector<NCNodeID> process_nodes;
+        uint32_t cancelled_tasks;
+        // Cancel the tasks of the node after its first result:
+        bool cancel_after_result;
 };
 
 TestServerDataProcessor::TestServerDataProcessor(std::vector<uint8_t> data):
@@ -53,7 +57,9 @@ TestServerDataProcessor::TestServerDataProcessor(std::vector<uint8_t> data):
     save_data_called(0),
     timeout_nodes(),
     data_nodes(),
-    process_nodes()
+    process_nodes(),
+    cancelled_tasks(0),
+    cancel_after_result(false)
     {}
 
 [[nodiscard]] std::vector<uint8_t> TestServerDataProcessor::nc_get_init_data() {
@@ -81,6 +87,11 @@ void TestServerDataProcessor::nc_node_timeout(NCNodeID node_id) {
 void TestServerDataProcessor::nc_process_result(NCNodeID node_id, std::vector<uint8_t> result) {
     process_nodes.push_back(node_id);
 
+    if (cancel_after_result) {
+        cancel_after_result = false;
+        nc_cancel_node_tasks(node_id);
+    }
+
     size_t i;
 
     for (i = 0; i < result.size(); i++) {
@@ -88,35 +99,55 @@ void TestServerDataProcessor::nc_process_result(NCNodeID node_id, std::vector<ui
     }
 }
 
+void TestServerDataProcessor::nc_tasks_cancelled([[maybe_unused]] NCNodeID node_id, uint32_t const num_tasks) {
+    cancelled_tasks += num_tasks;
+}
+
 class TestServerSocketData {
     public:
 
         // Members used in test cases
         NCNodeID node_id;
+        NCNodeSlot node_slot;
         std::vector<uint8_t> node_data;
         NCEncodedMessageToServer msg_to_server;
         NCMessageCodecNode message_codec;
         std::vector<NCServerMessageType> server_messages;
         uint8_t test_mode;
+        std::vector<size_t> batch_sizes;
+        std::vector<uint64_t> cancelled_tasks;
 
         TestServerSocketData(NCNodeID id, uint8_t mode);
 };
 
 TestServerSocketData::TestServerSocketData(NCNodeID id, uint8_t mode):
     node_id(id),
+    node_slot(),
     node_data(),
     msg_to_server(),
     message_codec(TEST_SERVER_KEY),
     server_messages(),
-    test_mode(mode)
+    test_mode(mode),
+    batch_sizes(),
+    cancelled_tasks()
     {
-        msg_to_server = message_codec.nc_gen_init_message(id);
+        NCCapabilities capabilities;
+
+        if (mode == 50) {
+            capabilities.features = NC_FEATURE_RESULT_WITH_NEW_DATA;
+        } else if (mode == 70) {
+            capabilities.features = NC_FEATURE_RESULT_BATCH;
+        } else if (mode == 80) {
+            capabilities.features = NC_FEATURE_CANCEL;
+        }
+
+        msg_to_server = message_codec.nc_gen_init_message(id, capabilities);
     }
 
 class TestServerSocket: public NCNetworkSocketBase {
     public:
         // API
-        void nc_send_data(std::vector<uint8_t> const data) override;
+        void nc_send_data(std::vector<uint8_t> const& data) override;
         [[nodiscard]] std::vector<uint8_t> nc_receive_data() override;
         [[nodiscard]] std::string nc_address() override;
 
@@ -131,11 +162,12 @@ TestServerSocket::TestServerSocket(std::shared_ptr<TestServerSocketData> init_da
     data_intern(init_data)
     {}
 
-void TestServerSocket::nc_send_data(std::vector<uint8_t> const data) {
+void TestServerSocket::nc_send_data(std::vector<uint8_t> const& data) {
     NCDecodedMessageFromServer server_message = data_intern->message_codec.nc_decode_message_from_server(NCEncodedMessageToNode(data));
     data_intern->server_messages.push_back(server_message.msg_type);
-    NCNodeID new_node_id;
+    NCNodeSlot wrong_slot;
     NCNodeMessageType invalid_message = static_cast<NCNodeMessageType>(100);
+    std::vector<std::vector<uint8_t>> new_data;
 
     switch (server_message.msg_type) {
         case NCServerMessageType::UnknownError:
@@ -146,19 +178,28 @@ void TestServerSocket::nc_send_data(std::vector<uint8_t> const data) {
         break;
         case NCServerMessageType::InitOK:
             spdlog::info("InitOK");
+            data_intern->node_slot = data_intern->message_codec.nc_decode_init_response(server_message.data).node_slot;
+            // Same slot, but an old token:
+            wrong_slot = NCNodeSlot{data_intern->node_slot.slot, data_intern->node_slot.token + 1};
 
             switch (data_intern->test_mode) {
                 case 10: // Node needs more data
-                    data_intern->msg_to_server = data_intern->message_codec.nc_gen_need_more_data_message(data_intern->node_id);
+                case 70: // Node needs more data, then a result batch
+                case 80: // Node needs more data, the answer to the result is cancel
+                case 50: // Node needs more data, then result and need more data
+                    data_intern->msg_to_server = data_intern->message_codec.nc_gen_need_more_data_message(data_intern->node_slot);
+                break;
+                case 60: // Node needs several tasks
+                    data_intern->msg_to_server = data_intern->message_codec.nc_gen_need_more_data_message(data_intern->node_slot, 3);
                 break;
                 case 20: // Heartbeat
-                    data_intern->msg_to_server = data_intern->message_codec.nc_gen_heartbeat_message(data_intern->node_id);
+                    data_intern->msg_to_server = data_intern->message_codec.nc_gen_heartbeat_message(data_intern->node_slot);
                 break;
-                case 30: // Invalid (unknown) node id
-                    data_intern->msg_to_server = data_intern->message_codec.nc_gen_heartbeat_message(new_node_id);
+                case 30: // Invalid (unknown) node slot
+                    data_intern->msg_to_server = data_intern->message_codec.nc_gen_heartbeat_message(wrong_slot);
                 break;
                 default: // Invalid message type
-                    data_intern->msg_to_server = data_intern->message_codec.nc_encode_message_to_server(invalid_message, {}, new_node_id);
+                    data_intern->msg_to_server = data_intern->message_codec.nc_encode_message_to_server(invalid_message, {}, wrong_slot);
             }
         break;
         case NCServerMessageType::NewDataFromServer:
@@ -170,15 +211,48 @@ void TestServerSocket::nc_send_data(std::vector<uint8_t> const data) {
                 data_intern->node_data.push_back(v + 1);
             }
 
-            data_intern->msg_to_server = data_intern->message_codec.nc_gen_result_message(data_intern->node_data, data_intern->node_id);
+            if (data_intern->test_mode == 50) {
+                data_intern->msg_to_server = data_intern->message_codec.nc_gen_result_need_more_data_message(
+                    data_intern->node_data, data_intern->node_slot);
+            } else if (data_intern->test_mode == 70) {
+                data_intern->msg_to_server = data_intern->message_codec.nc_gen_result_batch_message(
+                    {data_intern->node_data, data_intern->node_data}, data_intern->node_slot);
+            } else {
+                data_intern->msg_to_server = data_intern->message_codec.nc_gen_result_message(data_intern->node_data, data_intern->node_slot);
+            }
+        break;
+        case NCServerMessageType::NewDataBatchFromServer:
+            spdlog::info("NewDataBatchFromServer");
+
+            data_intern->node_data.clear();
+            new_data = data_intern->message_codec.nc_decode_data_batch(server_message.data);
+            data_intern->batch_sizes.push_back(new_data.size());
+
+            // The default nc_get_new_data_batch() returns a single task:
+            for (uint8_t v: new_data.at(0)) {
+                data_intern->node_data.push_back(v + 1);
+            }
+
+            data_intern->msg_to_server = data_intern->message_codec.nc_gen_result_message(data_intern->node_data, data_intern->node_slot);
         break;
         case NCServerMessageType::ResultOK:
             spdlog::info("ResultOK");
-            data_intern->msg_to_server = data_intern->message_codec.nc_gen_need_more_data_message(data_intern->node_id);
+
+            if (data_intern->test_mode == 60) {
+                data_intern->msg_to_server = data_intern->message_codec.nc_gen_need_more_data_message(data_intern->node_slot, 3);
+            } else {
+                data_intern->msg_to_server = data_intern->message_codec.nc_gen_need_more_data_message(data_intern->node_slot);
+            }
         break;
         case NCServerMessageType::InvalidNodeID:
             spdlog::info("InvalidNodeID");
         break;
+        case NCServerMessageType::Cancel:
+            spdlog::info("Cancel");
+            data_intern->cancelled_tasks.push_back(data_intern->message_codec.nc_decode_cancel(server_message.data));
+            // The node drops its task:
+            data_intern->msg_to_server = data_intern->message_codec.nc_gen_tasks_cancelled_message(1, data_intern->node_slot);
+        break;
         case NCServerMessageType::Quit:
             spdlog::info("Quit");
         break;
@@ -347,3 +421,255 @@ TEST_CASE("Create server, send invalid message (test mode 40)", "[server]" ) {
     REQUIRE(data_processor1->data_nodes.size() == 0);
     REQUIRE(data_processor1->process_nodes.size() == 0);
 }
+
+TEST_CASE("Create server, serialize processor calls (test mode 10)", "[server]" ) {
+    NCConfiguration config1 = NCConfiguration(TEST_SERVER_KEY);
+    config1.heartbeat_timeout = 20;
+    config1.serialize_processor = true;
+
+    NCNodeID node_id;
+    std::shared_ptr<TestServerSocketData> init_data = std::make_shared<TestServerSocketData>(node_id, 10);
+    std::vector<uint8_t> first_data = {1, 2, 3, 4, 5};
+    std::shared_ptr<TestServerDataProcessor> data_processor1 = std::make_shared<TestServerDataProcessor>(first_data);
+    std::unique_ptr<TestNetworkServer> network_server1 = std::make_unique<TestNetworkServer>(init_data);
+    NCServer server1(config1, data_processor1, std::move(network_server1));
+    server1.nc_run();
+
+    REQUIRE(init_data->node_data.size() == 5);
+    REQUIRE(init_data->node_data[0] == 3);
+    REQUIRE(init_data->node_data[4] == 7);
+
+    REQUIRE(init_data->server_messages.size() == 6);
+    REQUIRE(init_data->server_messages[0] == NCServerMessageType::InitOK);
+    REQUIRE(init_data->server_messages[1] == NCServerMessageType::NewDataFromServer);
+    REQUIRE(init_data->server_messages[2] == NCServerMessageType::ResultOK);
+    REQUIRE(init_data->server_messages[3] == NCServerMessageType::NewDataFromServer);
+    REQUIRE(init_data->server_messages[4] == NCServerMessageType::Quit);
+
+    REQUIRE(data_processor1->job_counter == 5);
+    REQUIRE(data_processor1->save_data_called == 1);
+    REQUIRE(data_processor1->data_nodes.size() == 2);
+    REQUIRE(data_processor1->process_nodes.size() == 1);
+}
+
+TEST_CASE("Create server, send result and need more data message (test mode 50)", "[server]" ) {
+    NCConfiguration config1 = NCConfiguration(TEST_SERVER_KEY);
+    config1.heartbeat_timeout = 20;
+
+    NCNodeID node_id;
+    std::shared_ptr<TestServerSocketData> init_data = std::make_shared<TestServerSocketData>(node_id, 50);
+    std::vector<uint8_t> first_data = {1, 2, 3, 4, 5};
+    std::shared_ptr<TestServerDataProcessor> data_processor1 = std::make_shared<TestServerDataProcessor>(first_data);
+    std::unique_ptr<TestNetworkServer> network_server1 = std::make_unique<TestNetworkServer>(init_data);
+    NCServer server1(config1, data_processor1, std::move(network_server1));
+    server1.nc_run();
+
+    REQUIRE(init_data->node_data.size() == 5);
+    REQUIRE(init_data->node_data[0] == 3);
+    REQUIRE(init_data->node_data[4] == 7);
+
+    // The result is answered with new data directly, no ResultOK:
+    REQUIRE(init_data->server_messages.size() == 5);
+    REQUIRE(init_data->server_messages[0] == NCServerMessageType::InitOK);
+    REQUIRE(init_data->server_messages[1] == NCServerMessageType::NewDataFromServer);
+    REQUIRE(init_data->server_messages[2] == NCServerMessageType::NewDataFromServer);
+    REQUIRE(init_data->server_messages[3] == NCServerMessageType::Quit);
+    REQUIRE(init_data->server_messages[4] == NCServerMessageType::Quit);
+
+    REQUIRE(data_processor1->job_counter == 5);
+    REQUIRE(data_processor1->save_data_called == 1);
+    REQUIRE(data_processor1->data_nodes.size() == 2);
+    REQUIRE(data_processor1->process_nodes.size() == 1);
+}
+
+TEST_CASE("Create server, send need more data message for several tasks (test mode 60)", "[server]" ) {
+    NCConfiguration config1 = NCConfiguration(TEST_SERVER_KEY);
+    config1.heartbeat_timeout = 20;
+
+    NCNodeID node_id;
+    std::shared_ptr<TestServerSocketData> init_data = std::make_shared<TestServerSocketData>(node_id, 60);
+    std::vector<uint8_t> first_data = {1, 2, 3, 4, 5};
+    std::shared_ptr<TestServerDataProcessor> data_processor1 = std::make_shared<TestServerDataProcessor>(first_data);
+    std::unique_ptr<TestNetworkServer> network_server1 = std::make_unique<TestNetworkServer>(init_data);
+    NCServer server1(config1, data_processor1, std::move(network_server1));
+    server1.nc_run();
+
+    REQUIRE(init_data->node_data.size() == 5);
+    REQUIRE(init_data->node_data[0] == 3);
+    REQUIRE(init_data->node_data[4] == 7);
+
+    REQUIRE(init_data->server_messages[0] == NCServerMessageType::InitOK);
+    REQUIRE(init_data->server_messages[1] == NCServerMessageType::NewDataBatchFromServer);
+    REQUIRE(init_data->server_messages[2] == NCServerMessageType::ResultOK);
+    REQUIRE(init_data->server_messages[3] == NCServerMessageType::NewDataBatchFromServer);
+    REQUIRE(init_data->server_messages[4] == NCServerMessageType::Quit);
+    REQUIRE(init_data->batch_sizes == std::vector<size_t>({1, 1}));
+
+    REQUIRE(data_processor1->save_data_called == 1);
+    REQUIRE(data_processor1->data_nodes.size() == 2);
+    REQUIRE(data_processor1->process_nodes.size() == 1);
+}
+
+TEST_CASE("Create server, send result batch message (test mode 70)", "[server]" ) {
+    NCConfiguration config1 = NCConfiguration(TEST_SERVER_KEY);
+    config1.heartbeat_timeout = 20;
+
+    NCNodeID node_id;
+    std::shared_ptr<TestServerSocketData> init_data = std::make_shared<TestServerSocketData>(node_id, 70);
+    std::vector<uint8_t> first_data = {1, 2, 3, 4, 5};
+    std::shared_ptr<TestServerDataProcessor> data_processor1 = std::make_shared<TestServerDataProcessor>(first_data);
+    std::unique_ptr<TestNetworkServer> network_server1 = std::make_unique<TestNetworkServer>(init_data);
+    NCServer server1(config1, data_processor1, std::move(network_server1));
+    server1.nc_run();
+
+    REQUIRE(init_data->node_data.size() == 5);
+    REQUIRE(init_data->node_data[0] == 3);
+    REQUIRE(init_data->node_data[4] == 7);
+
+    REQUIRE(init_data->server_messages[0] == NCServerMessageType::InitOK);
+    REQUIRE(init_data->server_messages[1] == NCServerMessageType::NewDataFromServer);
+    REQUIRE(init_data->server_messages[2] == NCServerMessageType::ResultOK);
+    REQUIRE(init_data->server_messages[3] == NCServerMessageType::NewDataFromServer);
+    REQUIRE(init_data->server_messages[4] == NCServerMessageType::Quit);
+
+    // Each result of the batch is processed:
+    REQUIRE(data_processor1->save_data_called == 1);
+    REQUIRE(data_processor1->data_nodes.size() == 2);
+    REQUIRE(data_processor1->process_nodes.size() == 2);
+}
+
+TEST_CASE("Create server, cancel the tasks of a node (test mode 80)", "[server]" ) {
+    NCConfiguration config1 = NCConfiguration(TEST_SERVER_KEY);
+    config1.heartbeat_timeout = 20;
+
+    NCNodeID node_id;
+    std::shared_ptr<TestServerSocketData> init_data = std::make_shared<TestServerSocketData>(node_id, 80);
+    std::vector<uint8_t> first_data = {1, 2, 3, 4, 5};
+    std::shared_ptr<TestServerDataProcessor> data_processor1 = std::make_shared<TestServerDataProcessor>(first_data);
+    // Not registered yet, nothing to cancel:
+    data_processor1->nc_cancel_node_tasks(node_id);
+    data_processor1->cancel_after_result = true;
+    std::unique_ptr<TestNetworkServer> network_server1 = std::make_unique<TestNetworkServer>(init_data);
+    NCServer server1(config1, data_processor1, std::move(network_server1));
+    server1.nc_run();
+
+    // The Cancel takes the place of ResultOK:
+    REQUIRE(init_data->server_messages.size() == 6);
+    REQUIRE(init_data->server_messages[0] == NCServerMessageType::InitOK);
+    REQUIRE(init_data->server_messages[1] == NCServerMessageType::NewDataFromServer);
+    REQUIRE(init_data->server_messages[2] == NCServerMessageType::Cancel);
+    REQUIRE(init_data->server_messages[3] == NCServerMessageType::ResultOK);
+    REQUIRE(init_data->server_messages[4] == NCServerMessageType::Quit);
+    REQUIRE(init_data->server_messages[5] == NCServerMessageType::Quit);
+
+    // Only the one task that was handed out is cancelled:
+    REQUIRE(init_data->cancelled_tasks == std::vector<uint64_t>({1}));
+    REQUIRE(data_processor1->cancelled_tasks == 1);
+    REQUIRE(data_processor1->data_nodes.size() == 1);
+    REQUIRE(data_processor1->process_nodes.size() == 1);
+}
+
+class TestServerViewProcessor: public NCServerDataProcessor {
+    public:
+        void nc_process_result_view([[maybe_unused]] NCNodeID node_id, std::span<const uint8_t> const result) override {
+            result_sum = 0;
+
+            for (uint8_t v: result) {
+                result_sum += v;
+            }
+        }
+
+        uint32_t result_sum = 0;
+};
+
+TEST_CASE("Create server, invalid heartbeat timeout", "[server]" ) {
+    NCConfiguration config1 = NCConfiguration(TEST_SERVER_KEY);
+    config1.heartbeat_timeout = 5;
+
+    NCNodeID node_id;
+    std::shared_ptr<TestServerSocketData> init_data = std::make_shared<TestServerSocketData>(node_id, 10);
+    std::vector<uint8_t> first_data = {1, 2, 3, 4, 5};
+    std::shared_ptr<TestServerDataProcessor> data_processor1 = std::make_shared<TestServerDataProcessor>(first_data);
+    std::unique_ptr<TestNetworkServer> network_server1 = std::make_unique<TestNetworkServer>(init_data);
+
+    REQUIRE_THROWS_AS(NCServer(config1, data_processor1, std::move(network_server1)), NCConfigurationException);
+}
+
+TEST_CASE("Process result as view", "[server]" ) {
+    TestServerViewProcessor processor;
+    NCServerDataProcessor& base = processor;
+
+    base.nc_process_result(NCNodeID(), {1, 2, 3, 4});
+    REQUIRE(processor.result_sum == 10);
+}
+
+TEST_CASE("Signal job done", "[server]" ) {
+    NCServerDataProcessor processor1;
+
+    REQUIRE(processor1.nc_get_job_state() == NCJobState::Polling);
+
+    processor1.nc_use_job_signal();
+    REQUIRE(processor1.nc_get_job_state() == NCJobState::Running);
+
+    processor1.nc_mark_job_done();
+    REQUIRE(processor1.nc_get_job_state() == NCJobState::Done);
+
+    NCServerDataProcessor processor2;
+    processor2.nc_set_remaining_work(3);
+    processor2.nc_work_done();
+    processor2.nc_work_done();
+
+    REQUIRE(processor2.nc_get_remaining_work() == 1);
+    REQUIRE(processor2.nc_get_job_state() == NCJobState::Running);
+
+    // The state is copied:
+    NCServerDataProcessor processor3(processor2);
+    REQUIRE(processor3.nc_get_remaining_work() == 1);
+
+    // More work than expected:
+    processor2.nc_work_done(5);
+    REQUIRE(processor2.nc_get_remaining_work() == 0);
+    REQUIRE(processor2.nc_get_job_state() == NCJobState::Done);
+    REQUIRE(processor3.nc_get_job_state() == NCJobState::Running);
+}
+
+TEST_CASE("Cancel requests", "[server]" ) {
+    NCServerDataProcessor processor1;
+    NCNodeID const node_id1, node_id2, node_id3;
+
+    processor1.nc_count_node_tasks(node_id1, true);
+    processor1.nc_count_node_tasks(node_id2, true);
+    // Doesn't know the Cancel message:
+    processor1.nc_count_node_tasks(node_id3, false);
+    REQUIRE(!processor1.nc_take_cancel_request(node_id1));
+
+    // No tasks handed out yet:
+    processor1.nc_cancel_node_tasks(node_id1);
+    REQUIRE(!processor1.nc_take_cancel_request(node_id1));
+
+    processor1.nc_count_tasks_sent(node_id1, 3);
+    processor1.nc_count_tasks_sent(node_id3, 3);
+    processor1.nc_cancel_node_tasks(node_id1);
+    processor1.nc_cancel_node_tasks(node_id3);
+    // Handed out after the request, not cancelled:
+    processor1.nc_count_tasks_sent(node_id1, 2);
+    NCServerDataProcessor processor2 = processor1;
+
+    // Each request is taken only once:
+    REQUIRE(!processor1.nc_take_cancel_request(node_id2));
+    REQUIRE(!processor1.nc_take_cancel_request(node_id3));
+    REQUIRE(processor1.nc_take_cancel_request(node_id1) == 3);
+    REQUIRE(!processor1.nc_take_cancel_request(node_id1));
+
+    // The copy has its own requests:
+    REQUIRE(processor2.nc_take_cancel_request(node_id1) == 3);
+
+    // A later request covers all tasks so far:
+    processor1.nc_cancel_node_tasks(node_id1);
+    REQUIRE(processor1.nc_take_cancel_request(node_id1) == 5);
+
+    // The node has registered again, the request of the old registration is dropped:
+    processor1.nc_cancel_node_tasks(node_id1);
+    processor1.nc_count_node_tasks(node_id1, true);
+    REQUIRE(!processor1.nc_take_cancel_request(node_id1));
+}
@@ -0,0 +1,223 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file contains the tests for the task manager.
+
+    Run only task manager tests:
+    xmake run -w ./ nc_test [task_manager]
+*/
+
+// STD includes:
+#include <thread>
+#include <vector>
+#include <atomic>
+
+// External includes:
+#include <snitch/snitch.hpp>
+
+// Local includes:
+#include "nodcru2/nc_task_manager.hpp"
+
+using namespace nodcru2;
+
+TEST_CASE("Hand out all tasks", "[task_manager]" ) {
+    NCTaskManager tasks(3);
+    NCNodeID const node_id1;
+
+    REQUIRE(tasks.nc_num_tasks() == 3);
+    REQUIRE(*tasks.nc_next_task(node_id1) == 0);
+    REQUIRE(*tasks.nc_next_task(node_id1) == 1);
+    REQUIRE(*tasks.nc_next_task(node_id1) == 2);
+    REQUIRE(!tasks.nc_next_task(node_id1).has_value());
+    REQUIRE(tasks.nc_num_processing() == 3);
+    REQUIRE(tasks.nc_get_state(1) == NCTaskState::Processing);
+
+    // Oldest task of the node first:
+    REQUIRE(*tasks.nc_task_done(node_id1) == 0);
+    REQUIRE(tasks.nc_task_done(node_id1, 2));
+    REQUIRE(tasks.nc_task_done(node_id1, 1));
+    REQUIRE(!tasks.nc_task_done(node_id1).has_value());
+    REQUIRE(!tasks.nc_task_done(node_id1, 3));
+
+    REQUIRE(tasks.nc_is_done());
+    REQUIRE(tasks.nc_num_done() == 3);
+    REQUIRE(tasks.nc_num_processing() == 0);
+}
+
+TEST_CASE("Requeue tasks of a timed out node", "[task_manager]" ) {
+    NCTaskManager tasks(4);
+    NCNodeID const node_id1, node_id2;
+
+    REQUIRE(*tasks.nc_next_task(node_id1) == 0);
+    REQUIRE(*tasks.nc_next_task(node_id1) == 1);
+    REQUIRE(*tasks.nc_next_task(node_id2) == 2);
+    REQUIRE(tasks.nc_task_done(node_id1, 1));
+
+    REQUIRE(tasks.nc_node_timeout(node_id1) == 1);
+    REQUIRE(tasks.nc_node_timeout(node_id1) == 0);
+    REQUIRE(tasks.nc_get_state(0) == NCTaskState::Unprocessed);
+
+    // The requeued task is handed out next:
+    REQUIRE(*tasks.nc_next_task(node_id2) == 0);
+    REQUIRE(*tasks.nc_next_task(node_id2) == 3);
+    REQUIRE(!tasks.nc_next_task(node_id2).has_value());
+}
+
+TEST_CASE("Late result of a timed out node", "[task_manager]" ) {
+    NCTaskManager tasks(2);
+    NCNodeID const node_id1, node_id2;
+
+    REQUIRE(*tasks.nc_next_task(node_id1) == 0);
+    REQUIRE(tasks.nc_node_timeout(node_id1) == 1);
+
+    // The result arrives before the task is given to another node:
+    REQUIRE(tasks.nc_task_done(node_id1, 0));
+    REQUIRE(*tasks.nc_next_task(node_id2) == 1);
+    REQUIRE(!tasks.nc_next_task(node_id2).has_value());
+
+    // A duplicate result is ignored:
+    REQUIRE(!tasks.nc_task_done(node_id2, 0));
+    REQUIRE(*tasks.nc_task_done(node_id2) == 1);
+    REQUIRE(tasks.nc_is_done());
+}
+
+TEST_CASE("Hand out several tasks at once", "[task_manager]" ) {
+    NCTaskManager tasks(5);
+    NCNodeID const node_id1, node_id2;
+
+    REQUIRE(tasks.nc_next_tasks(node_id1, 3) == std::vector<uint32_t>{0, 1, 2});
+    REQUIRE(tasks.nc_next_tasks(node_id2, 3) == std::vector<uint32_t>{3, 4});
+    REQUIRE(tasks.nc_next_tasks(node_id2, 3).empty());
+    REQUIRE(tasks.nc_num_processing() == 5);
+
+    // The results arrive in the order of the batch:
+    REQUIRE(*tasks.nc_task_done(node_id1) == 0);
+    REQUIRE(*tasks.nc_task_done(node_id1) == 1);
+    REQUIRE(tasks.nc_node_timeout(node_id1) == 1);
+    REQUIRE(tasks.nc_next_tasks(node_id2, 3) == std::vector<uint32_t>{2});
+}
+
+TEST_CASE("Speculative backup tasks", "[task_manager]" ) {
+    NCTaskManager tasks(3);
+    NCNodeID const node_id1, node_id2, node_id3;
+
+    tasks.nc_enable_speculation(1);
+
+    REQUIRE(*tasks.nc_next_task(node_id1) == 0);
+    REQUIRE(*tasks.nc_next_task(node_id1) == 1);
+    REQUIRE(*tasks.nc_next_task(node_id2) == 2);
+
+    // Too many tasks are outstanding:
+    REQUIRE(!tasks.nc_next_task(node_id3).has_value());
+    REQUIRE(tasks.nc_task_done(node_id1, 0));
+    REQUIRE(tasks.nc_task_done(node_id2, 2));
+
+    // A node never gets a backup of its own task:
+    REQUIRE(!tasks.nc_next_task(node_id1).has_value());
+    REQUIRE(*tasks.nc_next_task(node_id2) == 1);
+    // At most two copies by default:
+    REQUIRE(!tasks.nc_next_task(node_id3).has_value());
+    REQUIRE(tasks.nc_num_speculative() == 1);
+
+    // The first result wins:
+    REQUIRE(tasks.nc_task_done(node_id2, 1));
+    REQUIRE(!tasks.nc_task_done(node_id1, 1));
+    REQUIRE(tasks.nc_is_done());
+    REQUIRE(tasks.nc_num_processing() == 0);
+}
+
+TEST_CASE("Timeout while a backup task is running", "[task_manager]" ) {
+    NCTaskManager tasks(1);
+    NCNodeID const node_id1, node_id2, node_id3;
+
+    tasks.nc_enable_speculation(1, 3);
+
+    REQUIRE(*tasks.nc_next_task(node_id1) == 0);
+    REQUIRE(*tasks.nc_next_task(node_id2) == 0);
+
+    // The backup is still running, so the task is not requeued:
+    REQUIRE(tasks.nc_node_timeout(node_id1) == 0);
+    REQUIRE(tasks.nc_get_state(0) == NCTaskState::Processing);
+    REQUIRE(*tasks.nc_next_task(node_id3) == 0);
+
+    REQUIRE(tasks.nc_node_timeout(node_id2) == 0);
+    REQUIRE(tasks.nc_node_timeout(node_id3) == 1);
+    REQUIRE(tasks.nc_get_state(0) == NCTaskState::Unprocessed);
+
+    REQUIRE(*tasks.nc_next_task(node_id1) == 0);
+    REQUIRE(*tasks.nc_task_done(node_id1) == 0);
+    REQUIRE(tasks.nc_is_done());
+}
+
+TEST_CASE("Cancel the other copies of a task", "[task_manager]" ) {
+    NCTaskManager tasks(2);
+    NCNodeID const node_id1, node_id2;
+
+    tasks.nc_enable_speculation(2);
+
+    REQUIRE(*tasks.nc_next_task(node_id1) == 0);
+    REQUIRE(*tasks.nc_next_task(node_id1) == 1);
+    REQUIRE(*tasks.nc_next_task(node_id2) == 0);
+    REQUIRE(tasks.nc_nodes_working_on(0).size() == 2);
+
+    // Node 2 wins, node 1 drops both of its tasks:
+    REQUIRE(tasks.nc_task_done(node_id2, 0));
+    REQUIRE(tasks.nc_nodes_working_on(0) == std::vector<NCNodeID>{node_id1});
+    REQUIRE(*tasks.nc_task_cancelled(node_id1) == 0);
+    REQUIRE(*tasks.nc_task_cancelled(node_id1) == 1);
+    REQUIRE(!tasks.nc_task_cancelled(node_id1).has_value());
+    REQUIRE(tasks.nc_nodes_working_on(0).empty());
+
+    // Only the unfinished task is handed out again:
+    REQUIRE(tasks.nc_get_state(0) == NCTaskState::Done);
+    REQUIRE(tasks.nc_get_state(1) == NCTaskState::Unprocessed);
+    REQUIRE(*tasks.nc_next_task(node_id2) == 1);
+    REQUIRE(*tasks.nc_task_done(node_id2) == 1);
+    REQUIRE(tasks.nc_is_done());
+}
+
+TEST_CASE("Hand out a task again after an invalid result", "[task_manager]" ) {
+    NCTaskManager tasks(2);
+    NCNodeID const node_id1, node_id2;
+
+    REQUIRE(*tasks.nc_next_task(node_id1) == 0);
+    REQUIRE(*tasks.nc_next_task(node_id1) == 1);
+
+    // The result for task 0 is invalid, the next result is for task 1:
+    REQUIRE(*tasks.nc_task_failed(node_id1) == 0);
+    REQUIRE(tasks.nc_get_state(0) == NCTaskState::Unprocessed);
+    REQUIRE(*tasks.nc_task_done(node_id1) == 1);
+    REQUIRE(!tasks.nc_task_failed(node_id1).has_value());
+
+    REQUIRE(*tasks.nc_next_task(node_id2) == 0);
+    REQUIRE(*tasks.nc_task_done(node_id2) == 0);
+    REQUIRE(tasks.nc_is_done());
+}
+
+TEST_CASE("Tasks from many threads", "[task_manager]" ) {
+    NCTaskManager tasks(10000);
+    std::atomic<uint32_t> num_results = 0;
+    std::vector<std::thread> threads;
+
+    for (uint32_t i = 0; i < 8; i++) {
+        threads.emplace_back([&tasks, &num_results] () {
+            NCNodeID const node_id;
+
+            while (auto const task_id = tasks.nc_next_task(node_id)) {
+                if (tasks.nc_task_done(node_id, *task_id)) {
+                    num_results++;
+                }
+            }
+        });
+    }
+
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    REQUIRE(num_results.load() == 10000);
+    REQUIRE(tasks.nc_is_done());
+}
@@ -0,0 +1,140 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file contains the tests for the work stealing thread pool.
+
+    Run only thread pool tests:
+    xmake run -w ./ nc_test [thread_pool]
+*/
+
+// STD includes:
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <stdexcept>
+
+// External includes:
+#include <snitch/snitch.hpp>
+
+// Local includes:
+#include "nodcru2/nc_thread_pool.hpp"
+
+using namespace nodcru2;
+
+TEST_CASE("Parallel for visits every index once", "[thread_pool]" ) {
+    NCThreadPool pool(3);
+    std::vector<std::atomic<uint32_t>> visited(1000);
+
+    pool.nc_parallel_for(0, 1000, [&visited] (uint64_t i) {visited[i]++;});
+
+    uint32_t wrong = 0;
+    for (auto const& v: visited) {
+        if (v != 1) {
+            wrong++;
+        }
+    }
+    REQUIRE(wrong == 0);
+
+    // Empty range and larger grain:
+    pool.nc_parallel_for(5, 5, [&visited] (uint64_t i) {visited[i]++;});
+    pool.nc_parallel_for(0, 1000, [&visited] (uint64_t i) {visited[i]++;}, 300);
+    REQUIRE(visited[0] == 2);
+    REQUIRE(visited[999] == 2);
+}
+
+TEST_CASE("Parallel reduce", "[thread_pool]" ) {
+    NCThreadPool pool(3);
+
+    uint64_t const sum = pool.nc_parallel_reduce(1, 10001, uint64_t(0),
+        [] (uint64_t& value, uint64_t i) {value += i;},
+        [] (uint64_t& result, uint64_t const& value) {result += value;});
+    REQUIRE(sum == 50005000);
+
+    REQUIRE(pool.nc_max_slots() == 4);
+}
+
+TEST_CASE("Pool without threads", "[thread_pool]" ) {
+    NCThreadPool pool(0);
+    std::thread::id const caller = std::this_thread::get_id();
+    uint32_t other_threads = 0;
+
+    pool.nc_parallel_for(0, 100, [&other_threads, caller] (uint64_t) {
+        if (std::this_thread::get_id() != caller) {
+            other_threads++;
+        }
+    });
+    REQUIRE(other_threads == 0);
+}
+
+TEST_CASE("Work is shared between threads", "[thread_pool]" ) {
+    NCThreadPool pool(3);
+    std::atomic<uint32_t> active = 0;
+    std::atomic<uint32_t> max_active = 0;
+
+    pool.nc_parallel_for(0, 8, [&active, &max_active] (uint64_t) {
+        uint32_t const now = ++active;
+        uint32_t current = max_active;
+        while ((now > current) && !max_active.compare_exchange_weak(current, now)) {}
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        active--;
+    }, 1);
+    REQUIRE(max_active > 1);
+
+    // Only the share of one user, the caller does the rest:
+    pool.nc_set_num_users(4);
+    max_active = 0;
+    pool.nc_parallel_for(0, 8, [&active, &max_active] (uint64_t) {
+        uint32_t const now = ++active;
+        uint32_t current = max_active;
+        while ((now > current) && !max_active.compare_exchange_weak(current, now)) {}
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        active--;
+    }, 1);
+    REQUIRE(max_active == 1);
+}
+
+TEST_CASE("Nested and concurrent parallel loops", "[thread_pool]" ) {
+    NCThreadPool pool(2);
+    std::atomic<uint64_t> total = 0;
+
+    auto outer = [&pool, &total] () {
+        pool.nc_parallel_for(0, 10, [&pool, &total] (uint64_t) {
+            pool.nc_parallel_for(0, 100, [&total] (uint64_t i) {total += i;});
+        }, 1);
+    };
+
+    std::thread other(outer);
+    outer();
+    other.join();
+
+    REQUIRE(total == 2 * 10 * 4950);
+}
+
+TEST_CASE("Exception in parallel loop", "[thread_pool]" ) {
+    NCThreadPool pool(2);
+
+    REQUIRE_THROWS_AS(pool.nc_parallel_for(0, 100, [] (uint64_t i) {
+        if (i == 42) {
+            throw std::runtime_error("Parallel error");
+        }
+    }, 1), std::runtime_error);
+
+    // The pool can still be used:
+    uint64_t const count = pool.nc_parallel_reduce(0, 100, uint64_t(0),
+        [] (uint64_t& value, uint64_t) {value++;},
+        [] (uint64_t& result, uint64_t const& value) {result += value;});
+    REQUIRE(count == 100);
+}
+
+TEST_CASE("Node wide thread pool", "[thread_pool]" ) {
+    uint64_t const sum = nc_parallel_reduce(0, 100, uint64_t(0),
+        [] (uint64_t& value, uint64_t i) {value += i;},
+        [] (uint64_t& result, uint64_t const& value) {result += value;});
+    REQUIRE(sum == 4950);
+    REQUIRE(&nc_node_thread_pool() == &nc_node_thread_pool());
+}
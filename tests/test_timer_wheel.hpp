@@ -0,0 +1,69 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file contains the tests for the timer wheel.
+
+    Run only timer wheel tests:
+    xmake run -w ./ nc_test [timer_wheel]
+*/
+
+// STD includes:
+#include <chrono>
+#include <vector>
+
+// External includes:
+#include <snitch/snitch.hpp>
+
+// Local includes:
+#include "nodcru2/nc_timer_wheel.hpp"
+
+using namespace nodcru2;
+
+TEST_CASE("Timer fires once", "[timer_wheel]" ) {
+    auto const tick = std::chrono::milliseconds(10);
+    NCTimerWheel wheel(tick);
+    auto const start = std::chrono::steady_clock::now();
+
+    wheel.nc_schedule(3, start + (tick * 5));
+    wheel.nc_schedule(7, start + (tick * 20));
+
+    REQUIRE(wheel.nc_advance(start + (tick * 2)).empty());
+    REQUIRE(wheel.nc_advance(start + (tick * 7)) == std::vector<uint32_t>({3}));
+    REQUIRE(wheel.nc_advance(start + (tick * 15)).empty());
+    REQUIRE(wheel.nc_advance(start + (tick * 22)) == std::vector<uint32_t>({7}));
+    REQUIRE(wheel.nc_advance(start + (tick * 50)).empty());
+}
+
+TEST_CASE("Schedule timer again and cancel timer", "[timer_wheel]" ) {
+    auto const tick = std::chrono::milliseconds(10);
+    NCTimerWheel wheel(tick);
+    auto const start = std::chrono::steady_clock::now();
+
+    wheel.nc_schedule(1, start + (tick * 5));
+    wheel.nc_schedule(2, start + (tick * 5));
+    // Moved to a later deadline:
+    wheel.nc_schedule(1, start + (tick * 10));
+    wheel.nc_cancel(2);
+
+    REQUIRE(wheel.nc_advance(start + (tick * 7)).empty());
+    REQUIRE(wheel.nc_advance(start + (tick * 12)) == std::vector<uint32_t>({1}));
+}
+
+TEST_CASE("Timer several rounds in the future", "[timer_wheel]" ) {
+    auto const tick = std::chrono::milliseconds(1);
+    NCTimerWheel wheel(tick);
+    auto const start = std::chrono::steady_clock::now();
+    size_t const rounds = 3;
+
+    wheel.nc_schedule(5, start + (tick * (NC_TIMER_WHEEL_SIZE * rounds)));
+
+    for (size_t i = 1; i < rounds; i++) {
+        REQUIRE(wheel.nc_advance(start + (tick * (NC_TIMER_WHEEL_SIZE * i))).empty());
+    }
+
+    // Skip more than one round at once:
+    REQUIRE(wheel.nc_advance(start + (tick * (NC_TIMER_WHEEL_SIZE * (rounds + 2)))) == std::vector<uint32_t>({5}));
+}
@@ -0,0 +1,90 @@
+/*
+    Node Crunch2
+    SPDX-License-Identifier: MIT
+    Written by Willi Kappler, MIT License
+    https://github.com/willi-kappler/node_crunch2
+
+    This file contains the tests for the typed data processors.
+
+    Run only typed processor tests:
+    xmake run -w ./ nc_test [typed_processor]
+*/
+
+// STD includes:
+#include <numeric>
+
+// External includes:
+#include <snitch/snitch.hpp>
+
+// Local includes:
+#include "nodcru2/nc_typed_processor.hpp"
+
+using namespace nodcru2;
+
+struct TestTypedInit {
+    uint32_t factor;
+    double offset;
+};
+
+class TestTypedServerProcessor: public NCTypedServerProcessor<TestTypedInit, uint32_t, std::vector<double>> {
+    public:
+        [[nodiscard]] TestTypedInit nc_get_typed_init_data() override {
+            return TestTypedInit{3, 0.5};
+        }
+
+        [[nodiscard]] uint32_t nc_get_typed_new_data([[maybe_unused]] NCNodeID node_id) override {
+            return 4;
+        }
+
+        void nc_process_typed_result([[maybe_unused]] NCNodeID node_id, std::vector<double> result) override {
+            sum = std::accumulate(result.cbegin(), result.cend(), 0.0);
+        }
+
+        double sum = 0.0;
+};
+
+class TestTypedNodeProcessor: public NCTypedNodeProcessor<TestTypedInit, uint32_t, std::vector<double>> {
+    public:
+        void nc_typed_init(TestTypedInit init_data, [[maybe_unused]] NCNodeID node_id) override {
+            init_intern = init_data;
+        }
+
+        [[nodiscard]] std::vector<double> nc_process_typed_data(uint32_t data) override {
+            std::vector<double> result(data);
+
+            for (uint32_t i = 0; i < data; i++) {
+                result[i] = (i * init_intern.factor) + init_intern.offset;
+            }
+
+            return result;
+        }
+
+        TestTypedInit init_intern{0, 0.0};
+};
+
+TEST_CASE("Typed server and node processor", "[typed_processor]" ) {
+    NCNodeID const node_id = NCNodeID();
+    TestTypedServerProcessor server_processor;
+    TestTypedNodeProcessor node_processor;
+
+    // Use the untyped interface, as the server and the node do:
+    NCServerDataProcessor& server = server_processor;
+    NCNodeDataProcessor& node = node_processor;
+
+    node.nc_init(server.nc_get_init_data(), node_id);
+    REQUIRE(node_processor.init_intern.factor == 3);
+    REQUIRE(node_processor.init_intern.offset == 0.5);
+
+    std::vector<uint8_t> const result = node.nc_process_data(server.nc_get_new_data(node_id));
+    server.nc_process_result(node_id, result);
+
+    // 0.5 + 3.5 + 6.5 + 9.5:
+    REQUIRE(server_processor.sum == 20.0);
+}
+
+TEST_CASE("Typed processor with invalid data", "[typed_processor]" ) {
+    TestTypedNodeProcessor node_processor;
+    NCNodeDataProcessor& node = node_processor;
+
+    REQUIRE_THROWS_AS(node.nc_process_data({1, 2}), NCSerializerException);
+}